@@ -0,0 +1,136 @@
+//
+// pool of send buffers (see bufpool.h)
+//
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <wlock.h>
+
+#include "bufpool.h"
+
+static const size_t gSizeClasses[] = { 256, 1024, 4096, 16384, 65536 };
+#define NUM_SIZE_CLASSES   (sizeof(gSizeClasses) / sizeof(gSizeClasses[0]))
+
+// precedes each buffer -- padded so the data that follows is suitably aligned
+typedef union zmqBufferHeader_ {
+   struct {
+      union zmqBufferHeader_*    mNext;         // next free buffer in size class
+      int                        mSizeClass;    // -1 if allocated directly from heap
+   } mInfo;
+   long double                   mAlign;
+} zmqBufferHeader;
+
+typedef struct zmqSizeClass_ {
+   wLock                mLock;
+   zmqBufferHeader*     mFree;
+   size_t               mFreeCount;
+} zmqSizeClass;
+
+struct zmqBufferPool_ {
+   zmqSizeClass         mClasses[NUM_SIZE_CLASSES];
+   size_t               mMaxCached;
+   long                 mHeapAllocs;
+};
+
+
+zmqBufferPool* zmqBufferPool_create(size_t maxCached)
+{
+   zmqBufferPool* pool = calloc(1, sizeof(zmqBufferPool));
+   if (pool == NULL) {
+      return NULL;
+   }
+
+   pool->mMaxCached = maxCached;
+   for (size_t i = 0; i < NUM_SIZE_CLASSES; ++i) {
+      pool->mClasses[i].mLock = wlock_create();
+   }
+
+   return pool;
+}
+
+void zmqBufferPool_destroy(zmqBufferPool* pool)
+{
+   if (pool == NULL) {
+      return;
+   }
+
+   for (size_t i = 0; i < NUM_SIZE_CLASSES; ++i) {
+      zmqBufferHeader* header = pool->mClasses[i].mFree;
+      while (header != NULL) {
+         zmqBufferHeader* next = header->mInfo.mNext;
+         free(header);
+         header = next;
+      }
+      wlock_destroy(pool->mClasses[i].mLock);
+   }
+
+   free(pool);
+}
+
+
+void* zmqBufferPool_alloc(zmqBufferPool* pool, size_t size)
+{
+   int sizeClass = -1;
+   if (pool != NULL) {
+      for (size_t i = 0; i < NUM_SIZE_CLASSES; ++i) {
+         if (size <= gSizeClasses[i]) {
+            sizeClass = i;
+            break;
+         }
+      }
+   }
+
+   zmqBufferHeader* header = NULL;
+   if (sizeClass >= 0) {
+      zmqSizeClass* freeList = &pool->mClasses[sizeClass];
+      wlock_lock(freeList->mLock);
+      header = freeList->mFree;
+      if (header != NULL) {
+         freeList->mFree = header->mInfo.mNext;
+         freeList->mFreeCount--;
+      }
+      wlock_unlock(freeList->mLock);
+
+      size = gSizeClasses[sizeClass];
+   }
+
+   if (header == NULL) {
+      header = malloc(sizeof(zmqBufferHeader) + size);
+      if (header == NULL) {
+         return NULL;
+      }
+      header->mInfo.mSizeClass = sizeClass;
+      if (pool != NULL) {
+         __sync_add_and_fetch(&pool->mHeapAllocs, 1);
+      }
+   }
+
+   return header + 1;
+}
+
+void zmqBufferPool_free(void* data, void* hint)
+{
+   zmqBufferPool* pool = (zmqBufferPool*) hint;
+   zmqBufferHeader* header = ((zmqBufferHeader*) data) - 1;
+
+   if ((pool != NULL) && (header->mInfo.mSizeClass >= 0)) {
+      zmqSizeClass* freeList = &pool->mClasses[header->mInfo.mSizeClass];
+      wlock_lock(freeList->mLock);
+      if (freeList->mFreeCount < pool->mMaxCached) {
+         header->mInfo.mNext = freeList->mFree;
+         freeList->mFree = header;
+         freeList->mFreeCount++;
+         header = NULL;
+      }
+      wlock_unlock(freeList->mLock);
+   }
+
+   free(header);
+}
+
+
+long zmqBufferPool_getHeapAllocs(zmqBufferPool* pool)
+{
+   return (pool != NULL) ? pool->mHeapAllocs : 0;
+}
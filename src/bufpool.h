@@ -0,0 +1,25 @@
+#ifndef OPENMAMA_ZMQ_BUFPOOL_H
+#define OPENMAMA_ZMQ_BUFPOOL_H
+
+#include <stddef.h>
+
+// Pool of send buffers in fixed size classes.
+// Buffers are handed off to zmq w/zmq_msg_init_data, and returned to the pool by zmq (from whatever thread
+// releases the msg) via zmqBufferPool_free, so all operations are thread-safe.
+// Buffers bigger than the largest size class are allocated (and freed) directly from the heap.
+typedef struct zmqBufferPool_ zmqBufferPool;
+
+// maxCached is the max number of free buffers kept in each size class
+zmqBufferPool* zmqBufferPool_create(size_t maxCached);
+// all buffers must have been returned to the pool
+void zmqBufferPool_destroy(zmqBufferPool* pool);
+
+// if pool is NULL, the buffer is allocated from the heap
+void* zmqBufferPool_alloc(zmqBufferPool* pool, size_t size);
+// compatible w/zmq_free_fn -- hint is the pool the buffer was allocated from
+void zmqBufferPool_free(void* data, void* hint);
+
+// number of buffers allocated from the heap (i.e., not satisfied from the pool)
+long zmqBufferPool_getHeapAllocs(zmqBufferPool* pool);
+
+#endif
@@ -0,0 +1,66 @@
+//
+// payload compression codecs
+//
+// To add a codec, implement the bound/compress/decompress functions, add a type to zmqCodecType and
+// an entry to gCodecs.
+//
+
+#include <string.h>
+#include <strings.h>
+
+#include <lz4.h>
+
+#include "codec.h"
+
+
+///////////////////////////////////////////////////////////////////////////////
+// lz4
+static size_t lz4Bound(size_t srcSize)
+{
+   return LZ4_compressBound((int) srcSize);
+}
+
+static int lz4Compress(const void* src, size_t srcSize, void* dest, size_t destCapacity)
+{
+   return LZ4_compress_default((const char*) src, (char*) dest, (int) srcSize, (int) destCapacity);
+}
+
+static int lz4Decompress(const void* src, size_t srcSize, void* dest, size_t destCapacity)
+{
+   return LZ4_decompress_safe((const char*) src, (char*) dest, (int) srcSize, (int) destCapacity);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+static const zmqCodec gCodecs[] = {
+   // lz4 can't expand input by more than 255x
+   { ZMQ_CODEC_LZ4, "lz4", lz4Bound, lz4Compress, lz4Decompress, 255 },
+};
+#define NUM_CODECS   (sizeof(gCodecs) / sizeof(gCodecs[0]))
+
+
+const zmqCodec* zmqBridge_getCodecByName(const char* name)
+{
+   if (name == NULL) {
+      return NULL;
+   }
+
+   for (size_t i = 0; i < NUM_CODECS; ++i) {
+      if (strcasecmp(gCodecs[i].mName, name) == 0) {
+         return &gCodecs[i];
+      }
+   }
+
+   return NULL;
+}
+
+const zmqCodec* zmqBridge_getCodecByType(uint8_t type)
+{
+   for (size_t i = 0; i < NUM_CODECS; ++i) {
+      if (gCodecs[i].mType == type) {
+         return &gCodecs[i];
+      }
+   }
+
+   return NULL;
+}
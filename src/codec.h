@@ -0,0 +1,35 @@
+#ifndef OPENMAMA_ZMQ_CODEC_H
+#define OPENMAMA_ZMQ_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Payload compression codecs.
+// The codec type is sent on the wire (see zmqBridgeMamaMsgImpl_serialize), so values must never be re-used.
+typedef enum zmqCodecType_ {
+   ZMQ_CODEC_NONE = 0,
+   ZMQ_CODEC_LZ4  = 1
+} zmqCodecType;
+
+// size of the codec header that precedes a compressed payload: codec type (1) + uncompressed size (4)
+#define ZMQ_CODEC_HEADER_SIZE    (1 + sizeof(uint32_t))
+
+typedef struct zmqCodec_ {
+   uint8_t        mType;
+   const char*    mName;
+   // returns max size of compressed output for given input size
+   size_t         (*mBound)(size_t srcSize);
+   // returns compressed size, or <= 0 on failure
+   int            (*mCompress)(const void* src, size_t srcSize, void* dest, size_t destCapacity);
+   // returns decompressed size, or < 0 on failure
+   int            (*mDecompress)(const void* src, size_t srcSize, void* dest, size_t destCapacity);
+   // max ratio of decompressed to compressed size (bounds the size claimed in the codec header)
+   size_t         mMaxRatio;
+} zmqCodec;
+
+// returns NULL if name is "none" or not a known codec
+const zmqCodec* zmqBridge_getCodecByName(const char* name);
+// returns NULL if type is ZMQ_CODEC_NONE or not a known codec
+const zmqCodec* zmqBridge_getCodecByType(uint8_t type);
+
+#endif
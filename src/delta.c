@@ -0,0 +1,301 @@
+//
+// delta encoding of successive payloads (see delta.h for the format)
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "delta.h"
+
+// a run of unchanged bytes shorter than this is folded into the surrounding literal, since starting a
+// new op costs at least two bytes
+#define MIN_SKIP_RUN    4
+
+// max size of a varint-encoded uint32_t
+#define MAX_VARINT_SIZE 5
+
+
+///////////////////////////////////////////////////////////////////////////////
+// helpers
+static inline uint8_t refByte(const zmqDeltaStream* stream, size_t i)
+{
+   return (i < stream->mRefSize) ? stream->mRef[i] : 0;
+}
+
+static int reserve(uint8_t** buffer, size_t* capacity, size_t size)
+{
+   if (*capacity >= size) {
+      return 1;
+   }
+
+   uint8_t* temp = realloc(*buffer, size);
+   if (temp == NULL) {
+      return 0;
+   }
+   *buffer = temp;
+   *capacity = size;
+   return 1;
+}
+
+static uint8_t* putVarint(uint8_t* p, uint32_t value)
+{
+   while (value >= 0x80) {
+      *p++ = (uint8_t) (value | 0x80);
+      value >>= 7;
+   }
+   *p++ = (uint8_t) value;
+   return p;
+}
+
+static const uint8_t* getVarint(const uint8_t* p, const uint8_t* end, uint32_t* value)
+{
+   uint32_t result = 0;
+   for (int shift = 0; (p < end) && (shift < 35); shift += 7) {
+      uint8_t b = *p++;
+      result |= (uint32_t) (b & 0x7f) << shift;
+      if ((b & 0x80) == 0) {
+         *value = result;
+         return p;
+      }
+   }
+   return NULL;
+}
+
+static uint8_t* putHeader(uint8_t* p, uint8_t kind, uint32_t streamId, uint32_t seq)
+{
+   *p++ = kind;
+   uint32_t temp = htonl(streamId);
+   memcpy(p, &temp, sizeof(temp));
+   p += sizeof(temp);
+   temp = htonl(seq);
+   memcpy(p, &temp, sizeof(temp));
+   p += sizeof(temp);
+   return p;
+}
+
+static uint32_t getUint32(const uint8_t* p)
+{
+   uint32_t temp;
+   memcpy(&temp, p, sizeof(temp));
+   return ntohl(temp);
+}
+
+static int setRef(zmqDeltaStream* stream, const void* payload, size_t size)
+{
+   if (!reserve(&stream->mRef, &stream->mRefCapacity, size)) {
+      return 0;
+   }
+   memcpy(stream->mRef, payload, size);
+   stream->mRefSize = size;
+   return 1;
+}
+
+// returns size of encoded delta frame, or 0 if the delta is no smaller than the payload
+static size_t encodeDelta(zmqDeltaStream* stream, const uint8_t* payload, size_t size)
+{
+   uint8_t* out = stream->mEncoded + ZMQ_DELTA_HEADER_SIZE;
+   // stop as soon as the delta is as big as a key frame would be
+   uint8_t* limit = stream->mEncoded + ZMQ_DELTA_HEADER_SIZE + size;
+
+   uint32_t temp = htonl((uint32_t) size);
+   memcpy(out, &temp, sizeof(temp));
+   out += sizeof(temp);
+
+   size_t i = 0;
+   while (i < size) {
+      // skip unchanged bytes
+      size_t litStart = i;
+      while ((litStart < size) && (payload[litStart] == refByte(stream, litStart))) {
+         ++litStart;
+      }
+      if (litStart == size) {
+         break;               // rest of payload is unchanged
+      }
+
+      // extend literal until we hit a long enough run of unchanged bytes
+      size_t litEnd = litStart;
+      size_t same = 0;
+      for (size_t j = litStart; j < size; ++j) {
+         if (payload[j] == refByte(stream, j)) {
+            if (++same == MIN_SKIP_RUN) {
+               break;
+            }
+         }
+         else {
+            same = 0;
+            litEnd = j + 1;
+         }
+      }
+
+      size_t litSize = litEnd - litStart;
+      if (out + (2 * MAX_VARINT_SIZE) + litSize > limit) {
+         return 0;
+      }
+      out = putVarint(out, (uint32_t) (litStart - i));
+      out = putVarint(out, (uint32_t) litSize);
+      for (size_t j = litStart; j < litEnd; ++j) {
+         *out++ = payload[j] ^ refByte(stream, j);
+      }
+
+      i = litEnd;
+   }
+
+   return out - stream->mEncoded;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+zmqDeltaStream* zmqDeltaStream_create(uint32_t streamId)
+{
+   zmqDeltaStream* stream = calloc(1, sizeof(zmqDeltaStream));
+   if (stream != NULL) {
+      stream->mStreamId = streamId;
+   }
+   return stream;
+}
+
+void zmqDeltaStream_destroy(zmqDeltaStream* stream)
+{
+   if (stream == NULL) {
+      return;
+   }
+
+   free(stream->mRef);
+   free(stream->mEncoded);
+   free(stream);
+}
+
+
+void zmqDeltaStream_reset(zmqDeltaStream* stream)
+{
+   stream->mSeq = 0;
+}
+
+
+zmqDeltaStatus zmqDeltaStream_encode(zmqDeltaStream* stream, const void* payload, size_t size, uint32_t keyInterval,
+   const void** encoded, size_t* encodedSize)
+{
+   // room for a key frame (delta frames are never bigger)
+   if (!reserve(&stream->mEncoded, &stream->mEncodedCapacity, ZMQ_DELTA_HEADER_SIZE + size + sizeof(uint32_t))) {
+      return ZMQ_DELTA_NOMEM;
+   }
+
+   ++stream->mSeq;
+
+   size_t frameSize = 0;
+   if ((stream->mSeq > 1) && (stream->mSinceKey < keyInterval)) {
+      frameSize = encodeDelta(stream, (const uint8_t*) payload, size);
+   }
+
+   if (frameSize > 0) {
+      putHeader(stream->mEncoded, ZMQ_DELTA_DELTA_FRAME, stream->mStreamId, stream->mSeq);
+      ++stream->mSinceKey;
+   }
+   else {
+      uint8_t* p = putHeader(stream->mEncoded, ZMQ_DELTA_KEY_FRAME, stream->mStreamId, stream->mSeq);
+      memcpy(p, payload, size);
+      frameSize = ZMQ_DELTA_HEADER_SIZE + size;
+      stream->mSinceKey = 0;
+   }
+
+   if (!setRef(stream, payload, size)) {
+      // force a key frame next time
+      stream->mSeq = 0;
+      return ZMQ_DELTA_NOMEM;
+   }
+
+   *encoded = stream->mEncoded;
+   *encodedSize = frameSize;
+   return ZMQ_DELTA_OK;
+}
+
+
+uint32_t zmqDeltaStream_getStreamId(const void* encoded, size_t encodedSize)
+{
+   if (encodedSize < ZMQ_DELTA_HEADER_SIZE) {
+      return 0;
+   }
+   return getUint32((const uint8_t*) encoded + 1);
+}
+
+
+zmqDeltaStatus zmqDeltaStream_decode(zmqDeltaStream* stream, const void* encoded, size_t encodedSize, size_t maxSize,
+   const void** payload, size_t* payloadSize)
+{
+   const uint8_t* p = (const uint8_t*) encoded;
+   const uint8_t* end = p + encodedSize;
+
+   if (encodedSize < ZMQ_DELTA_HEADER_SIZE) {
+      stream->mIsSynced = 0;
+      return ZMQ_DELTA_CORRUPT;
+   }
+   uint8_t kind = p[0];
+   uint32_t streamId = getUint32(p + 1);
+   uint32_t seq = getUint32(p + 1 + sizeof(uint32_t));
+   p += ZMQ_DELTA_HEADER_SIZE;
+
+   if (kind == ZMQ_DELTA_KEY_FRAME) {
+      if (!setRef(stream, p, end - p)) {
+         stream->mIsSynced = 0;
+         return ZMQ_DELTA_NOMEM;
+      }
+   }
+   else if (kind == ZMQ_DELTA_DELTA_FRAME) {
+      // must be the next frame from the same publisher
+      if ((stream->mIsSynced == 0) || (streamId != stream->mStreamId) || (seq != stream->mSeq + 1)) {
+         stream->mIsSynced = 0;
+         return ZMQ_DELTA_NOT_SYNCED;
+      }
+
+      if (end - p < (ptrdiff_t) sizeof(uint32_t)) {
+         stream->mIsSynced = 0;
+         return ZMQ_DELTA_CORRUPT;
+      }
+      size_t size = getUint32(p);
+      p += sizeof(uint32_t);
+      if (size > maxSize) {
+         stream->mIsSynced = 0;
+         return ZMQ_DELTA_CORRUPT;
+      }
+
+      // apply delta in place -- bytes past the end of the previous payload start out as zero
+      if (!reserve(&stream->mRef, &stream->mRefCapacity, size)) {
+         stream->mIsSynced = 0;
+         return ZMQ_DELTA_NOMEM;
+      }
+      if (size > stream->mRefSize) {
+         memset(stream->mRef + stream->mRefSize, 0, size - stream->mRefSize);
+      }
+      stream->mRefSize = size;
+
+      size_t i = 0;
+      while (p < end) {
+         uint32_t skip, litSize;
+         p = getVarint(p, end, &skip);
+         if (p != NULL) {
+            p = getVarint(p, end, &litSize);
+         }
+         if ((p == NULL) || ((size_t) (end - p) < litSize) || (i + skip + litSize > size)) {
+            stream->mIsSynced = 0;
+            return ZMQ_DELTA_CORRUPT;
+         }
+         i += skip;
+         for (uint32_t j = 0; j < litSize; ++j) {
+            stream->mRef[i++] ^= *p++;
+         }
+      }
+   }
+   else {
+      stream->mIsSynced = 0;
+      return ZMQ_DELTA_CORRUPT;
+   }
+
+   stream->mStreamId = streamId;
+   stream->mSeq = seq;
+   stream->mIsSynced = 1;
+
+   *payload = stream->mRef;
+   *payloadSize = stream->mRefSize;
+   return ZMQ_DELTA_OK;
+}
@@ -0,0 +1,60 @@
+#ifndef OPENMAMA_ZMQ_DELTA_H
+#define OPENMAMA_ZMQ_DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Delta encoding of successive payloads on the same subject.
+//
+// Each encoded payload starts w/a fixed header: kind (1) + stream id (4) + sequence number (4).
+// A key frame ('K') is followed by the full payload.  A delta frame ('D') is followed by the size of the
+// new payload (4) and a series of (skip, length, bytes) ops -- skip and length are varints, and bytes are
+// the XOR of the new payload w/the previous one.  Bytes past the end of the previous payload are treated
+// as zero, and bytes past the last op are unchanged.
+#define ZMQ_DELTA_KEY_FRAME      'K'
+#define ZMQ_DELTA_DELTA_FRAME    'D'
+#define ZMQ_DELTA_HEADER_SIZE    (1 + sizeof(uint32_t) + sizeof(uint32_t))
+
+typedef enum zmqDeltaStatus_ {
+   ZMQ_DELTA_OK = 0,
+   ZMQ_DELTA_NOT_SYNCED,         // delta received w/o matching reference (waiting for key frame)
+   ZMQ_DELTA_CORRUPT,            // malformed frame
+   ZMQ_DELTA_NOMEM
+} zmqDeltaStatus;
+
+// one stream per publisher on the sending side, and one per subject and publisher on the receiving side
+typedef struct zmqDeltaStream_ {
+   uint32_t       mStreamId;           // identifies the publisher
+   uint32_t       mSeq;                // seq of last frame sent/received
+   uint32_t       mSinceKey;           // frames sent since last key frame (sender only)
+   int            mIsSynced;           // reference payload is valid (receiver only)
+   int            mIsActive;           // used since last check for idle streams (receiver only)
+   uint8_t*       mRef;                // reference (i.e., previous) payload
+   size_t         mRefSize;
+   size_t         mRefCapacity;
+   uint8_t*       mEncoded;            // encoded frame (sender only, re-used across msgs)
+   size_t         mEncodedCapacity;
+} zmqDeltaStream;
+
+zmqDeltaStream* zmqDeltaStream_create(uint32_t streamId);
+void zmqDeltaStream_destroy(zmqDeltaStream* stream);
+
+// Forces the next frame encoded to be a key frame (e.g., after a msg was not sent).
+void zmqDeltaStream_reset(zmqDeltaStream* stream);
+
+// Encodes payload against the previous one, sending a key frame every keyInterval frames (or whenever
+// the delta would be no smaller than the payload itself).
+// On return, encoded points to a buffer owned by the stream, which is valid until the next call.
+zmqDeltaStatus zmqDeltaStream_encode(zmqDeltaStream* stream, const void* payload, size_t size, uint32_t keyInterval,
+   const void** encoded, size_t* encodedSize);
+
+// Returns the stream id of an encoded frame (or 0 if it is too short to have one).
+uint32_t zmqDeltaStream_getStreamId(const void* encoded, size_t encodedSize);
+
+// Reconstructs the full payload from an encoded frame -- frames for a payload bigger than maxSize are rejected
+// as corrupt (the size in a delta frame comes from the wire, and is allocated before the ops are checked).
+// On return, payload points to a buffer owned by the stream, which is valid until the next call.
+zmqDeltaStatus zmqDeltaStream_decode(zmqDeltaStream* stream, const void* encoded, size_t encodedSize, size_t maxSize,
+   const void** payload, size_t* payloadSize);
+
+#endif
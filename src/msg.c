@@ -28,6 +28,7 @@
 // system includes
 #include <stdlib.h>
 #include <string.h>
+#include <arpa/inet.h>
 
 // Mama includes
 #include <mama/mama.h>
@@ -103,6 +104,8 @@ mama_status zmqBridgeMamaMsg_destroy(msgBridge msg, int destroyMsg)
       return MAMA_STATUS_NULL_ARG;
    }
 
+   zmqBridgeMsgImpl* impl = (zmqBridgeMsgImpl*) msg;
+   free(impl->mPayloadBuffer);
    free(msg);
    return MAMA_STATUS_OK;
 }
@@ -288,60 +291,191 @@ mama_status zmqBridgeMamaMsgImpl_createMsgOnly(msgBridge* msg)
 
 
 
-mama_status zmqBridgeMamaMsgImpl_serialize(msgBridge msg, mamaMsg source, zmq_msg_t *zmsg)
+mama_status zmqBridgeMamaMsgImpl_serialize(msgBridge msg, mamaMsg source, zmqTransportBridge* transport, zmq_msg_t *zmsg)
 {
    if (NULL == msg) {
       return MAMA_STATUS_NULL_ARG;
    }
    zmqBridgeMsgImpl* impl = (zmqBridgeMsgImpl*) msg;
 
+   zmqMsgHeader header;
+   const char* replyHandle = (impl->mMsgType == ZMQ_MSG_INBOX_REQUEST) ? impl->mReplyHandle : NULL;
+   CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_buildHeader(&header, impl->mSendSubject, impl->mMsgType, replyHandle, NULL));
+
+   return zmqBridgeMamaMsgImpl_serializeWithHeader(&header, source, transport, NULL, zmsg);
+}
+
+
+mama_status zmqBridgeMamaMsgImpl_buildHeader(zmqMsgHeader* header, const char* subject, uint8_t msgType, const char* replyHandle, const char* alias)
+{
+   size_t subjectSize = strlen(subject) + 1;
+   size_t replyHandleSize = (replyHandle != NULL) ? strlen(replyHandle) : 0;
+   size_t aliasSize = (alias != NULL) ? ZMQ_ALIAS_SIZE + 1 : 0;
+   if ((subjectSize > MAX_SUBJECT_LENGTH + 1) || (replyHandleSize > ZMQ_REPLYHANDLE_SIZE)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Could not build header for subject: %s", subject);
+      return MAMA_STATUS_INVALID_ARG;
+   }
+
+   uint8_t* bufferPos = header->mData;
+
+   // Copy across the subject
+   memcpy(bufferPos, subject, subjectSize);
+   bufferPos += subjectSize;
+
+   // Copy across the message type (flags are filled in as needed by serializeWithHeader)
+   header->mTypeOffset = bufferPos - header->mData;
+   *bufferPos = msgType;
+   if (alias != NULL) {
+      *bufferPos |= ZMQ_MSG_FLAG_ALIAS;
+   }
+   bufferPos++;
+
+   // copy reply address (only for request)
+   if (replyHandle != NULL) {
+      memcpy(bufferPos, replyHandle, replyHandleSize);
+      bufferPos += replyHandleSize;
+   }
+   *bufferPos = '\0';   // trailing null for reply handle (even if not present)
+   bufferPos++;
+
+   // copy alias definition
+   if (alias != NULL) {
+      memcpy(bufferPos, alias, aliasSize);
+      bufferPos += aliasSize;
+   }
+
+   header->mSize = bufferPos - header->mData;
+
+   return MAMA_STATUS_OK;
+}
+
+
+mama_status zmqBridgeMamaMsgImpl_serializeWithHeader(const zmqMsgHeader* header, mamaMsg source, zmqTransportBridge* transport, zmqDeltaStream* delta, zmq_msg_t *zmsg)
+{
    // Serialize payload
    const void* payloadBuffer;
    mama_size_t payloadSize;
    CALL_MAMA_FUNC(mamaMsg_getByteBuffer(source, &payloadBuffer, &payloadSize));
 
-   // get size of buffer needed
-   size_t serializedSize = (strlen(impl->mSendSubject) + 1) + sizeof(impl->mMsgType) + payloadSize;
-   if (impl->mMsgType== ZMQ_MSG_INBOX_REQUEST) {
-      serializedSize += strlen(impl->mReplyHandle);
+   // delta-encode payload?
+   uint8_t msgFlags = 0;
+   if (delta != NULL) {
+      const void* encoded;
+      size_t encodedSize;
+      zmqDeltaStatus deltaStatus = zmqDeltaStream_encode(delta, payloadBuffer, payloadSize, transport->mDeltaKeyInterval, &encoded, &encodedSize);
+      if (deltaStatus != ZMQ_DELTA_OK) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to delta-encode payload for %s (%d)", (const char*) header->mData, deltaStatus);
+         return MAMA_STATUS_NOMEM;
+      }
+      if (((const uint8_t*) encoded)[0] == ZMQ_DELTA_DELTA_FRAME) {
+         __sync_add_and_fetch(&transport->mDeltaMessages, 1);
+      }
+      payloadBuffer = encoded;
+      payloadSize = encodedSize;
+      msgFlags |= ZMQ_MSG_FLAG_DELTA;
+   }
+
+   size_t headerSize = header->mSize;
+
+   // compress payload?
+   const zmqCodec* codec = NULL;
+   if ((transport != NULL) && (transport->mCodec != NULL) && (payloadSize >= transport->mCompressThreshold)) {
+      codec = transport->mCodec;
+   }
+
+   // serialize (and compress) directly into a pooled buffer that is handed off to zmq (see below)
+   zmqBufferPool* pool = (transport != NULL) ? transport->mSendPool : NULL;
+   size_t serializedSize = headerSize + payloadSize;
+   size_t bufferSize = (codec != NULL) ? headerSize + ZMQ_CODEC_HEADER_SIZE + codec->mBound(payloadSize) : serializedSize;
+   uint8_t* buffer = zmqBufferPool_alloc(pool, bufferSize);
+   if (buffer == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to allocate send buffer for %zu bytes", bufferSize);
+      return MAMA_STATUS_NOMEM;
+   }
+
+   // Ok great - we have a buffer now of appropriate size, let's populate it
+   memcpy(buffer, header->mData, headerSize);
+   buffer[header->mTypeOffset] |= msgFlags;
+   uint8_t* bufferPos = buffer + headerSize;
+
+   if (codec == NULL) {
+      // Copy across the payload
+      memcpy((void*)bufferPos, payloadBuffer, payloadSize);
+   }
+   else {
+      // compressed payload is preceded by codec type and uncompressed size
+      int compressedSize = codec->mCompress(payloadBuffer, payloadSize, bufferPos + ZMQ_CODEC_HEADER_SIZE, codec->mBound(payloadSize));
+      if ((compressedSize > 0) && (compressedSize + ZMQ_CODEC_HEADER_SIZE < payloadSize)) {
+         uint32_t rawSize = htonl((uint32_t) payloadSize);
+         bufferPos[0] = codec->mType;
+         memcpy(bufferPos + 1, &rawSize, sizeof(rawSize));
+         buffer[header->mTypeOffset] |= ZMQ_MSG_FLAG_COMPRESSED;
+         serializedSize = headerSize + ZMQ_CODEC_HEADER_SIZE + compressedSize;
+         __sync_add_and_fetch(&transport->mCompressedMessages, 1);
+      }
+      else {
+         // payload doesn't compress (or compressor failed) -- send it as is
+         MAMA_LOG(MAMA_LOG_LEVEL_FINEST, "Sending uncompressed payload (size=%zu, compressed=%d)", payloadSize, compressedSize);
+         memcpy((void*)bufferPos, payloadBuffer, payloadSize);
+      }
    }
-   serializedSize++;    // trailing null for reply handle (even if not present)
 
-   int rc =zmq_msg_init_size(zmsg, serializedSize);
+   // zmq owns the buffer from here on
+   int rc = zmq_msg_init_data(zmsg, buffer, serializedSize, zmqBufferPool_free, pool);
    if (0 != rc) {
-      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_init_size failed %d(%s)", zmq_errno (), zmq_strerror (errno));
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_init_data failed %d(%s)", zmq_errno (), zmq_strerror (errno));
+      zmqBufferPool_free(buffer, pool);
       return MAMA_STATUS_PLATFORM;
    }
 
-   // Ok great - we have a buffer now of appropriate size, let's populate it
-   uint8_t* bufferPos = (uint8_t*)zmq_msg_data(zmsg);
+   return MAMA_STATUS_OK;
+}
 
-   // Copy across the subject
-   size_t msgSubjectByteCount = strlen(impl->mSendSubject) + 1;
-   memcpy(bufferPos, impl->mSendSubject, msgSubjectByteCount);
-   bufferPos += msgSubjectByteCount;
 
-   // Copy across the message type
-   memcpy(bufferPos, &impl->mMsgType, sizeof(impl->mMsgType));
-   bufferPos+=sizeof(impl->mMsgType);
+// The payload frame of a multi-part msg starts w/a single byte holding the msg flags that apply to the payload,
+// which are merged into the header by joinParts on receipt.
+mama_status zmqBridgeMamaMsgImpl_serializePayload(mamaMsg source, zmqTransportBridge* transport, zmq_msg_t *zmsg)
+{
+   zmqMsgHeader header;
+   header.mData[0] = 0;
+   header.mSize = 1;
+   header.mTypeOffset = 0;
 
-   // copy reply address (only for request)
-   if (impl->mMsgType == ZMQ_MSG_INBOX_REQUEST) {
-      size_t msgInboxByteCount = strlen(impl->mReplyHandle);
-      memcpy(bufferPos, impl->mReplyHandle, msgInboxByteCount);
-      bufferPos += msgInboxByteCount;
+   return zmqBridgeMamaMsgImpl_serializeWithHeader(&header, source, transport, NULL, zmsg);
+}
+
+
+mama_status zmqBridgeMamaMsgImpl_joinParts(zmq_msg_t *zmsg, zmq_msg_t *payload)
+{
+   const uint8_t* header = (const uint8_t*) zmq_msg_data(zmsg);
+   size_t headerSize = zmq_msg_size(zmsg);
+   const uint8_t* payloadData = (const uint8_t*) zmq_msg_data(payload);
+   size_t payloadSize = zmq_msg_size(payload);
+
+   size_t subjectSize = strnlen((const char*) header, headerSize) + 1;
+   if ((subjectSize >= headerSize) || (payloadSize < 1)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Malformed multi-part msg (header=%zu, payload=%zu)", headerSize, payloadSize);
+      return MAMA_STATUS_SYSTEM_ERROR;
    }
-   *bufferPos = '\0';   // trailing null for reply handle (even if not present)
-   bufferPos++;
 
-   // Copy across the payload
-   memcpy((void*)bufferPos, payloadBuffer, payloadSize);
+   zmq_msg_t fullMsg;
+   if (0 != zmq_msg_init_size(&fullMsg, headerSize + payloadSize - 1)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_init_size failed %d(%s)", zmq_errno(), zmq_strerror(errno));
+      return MAMA_STATUS_NOMEM;
+   }
+   uint8_t* fullData = (uint8_t*) zmq_msg_data(&fullMsg);
+   memcpy(fullData, header, headerSize);
+   fullData[subjectSize] |= payloadData[0];
+   memcpy(fullData + headerSize, payloadData + 1, payloadSize - 1);
+
+   zmq_msg_move(zmsg, &fullMsg);
+   zmq_msg_close(&fullMsg);
 
    return MAMA_STATUS_OK;
 }
 
 
-mama_status zmqBridgeMamaMsgImpl_deserialize(msgBridge msg, zmq_msg_t *zmsg, mamaMsg target)
+mama_status zmqBridgeMamaMsgImpl_deserialize(msgBridge msg, zmq_msg_t *zmsg, zmqTransportBridge* transport, mamaMsg target)
 {
    if (NULL == msg) {
       return MAMA_STATUS_NULL_ARG;
@@ -356,7 +490,8 @@ mama_status zmqBridgeMamaMsgImpl_deserialize(msgBridge msg, zmq_msg_t *zmsg, mam
    bufferPos += strlen((char*)source) + 1;
 
    // Set the message type
-   memcpy(&impl->mMsgType, bufferPos, sizeof(impl->mMsgType));
+   uint8_t msgFlags = *bufferPos & ~ZMQ_MSG_TYPE_MASK;
+   impl->mMsgType = *bufferPos & ZMQ_MSG_TYPE_MASK;
    bufferPos+=sizeof(impl->mMsgType);
 
    // set reply handle
@@ -371,6 +506,11 @@ mama_status zmqBridgeMamaMsgImpl_deserialize(msgBridge msg, zmq_msg_t *zmsg, mam
    }
    bufferPos++;                     // trailing null for reply handle (even if not present)
 
+   // skip alias definition
+   if (msgFlags & ZMQ_MSG_FLAG_ALIAS) {
+      bufferPos += ZMQ_ALIAS_SIZE + 1;
+   }
+
    // Parse the payload into a MAMA Message
    int payloadSize = size - (bufferPos - (uint8_t*)source);
    if (payloadSize < 0) {
@@ -378,17 +518,165 @@ mama_status zmqBridgeMamaMsgImpl_deserialize(msgBridge msg, zmq_msg_t *zmsg, mam
       return MAMA_STATUS_SYSTEM_ERROR;
    }
 
+   if (msgFlags & ZMQ_MSG_FLAG_COMPRESSED) {
+      size_t maxSize = (transport != NULL) ? transport->mMaxMsgSize : (size_t) ZMQ_MAX_MSG_SIZE * 1024 * 1024;
+      CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_decompress(&impl->mPayloadBuffer, &impl->mPayloadBufferSize, &bufferPos, &payloadSize, maxSize));
+   }
+
    MAMA_LOG(MAMA_LOG_LEVEL_FINEST, "Received %zu bytes [payload=%d; type=%d]", size, payloadSize, impl->mMsgType);
    return mamaMsgImpl_setMsgBuffer(target, (void*) bufferPos, payloadSize, *bufferPos);
 }
 
 
+// Decompresses payload into buffer (which is grown as needed), and updates payload/payloadSize to point to it.
+// For deserialize, the buffer is owned by the msg, and remains valid until the next call to deserialize, which is
+// the same guarantee that applies to uncompressed payloads (which point directly into the zmq msg).
+// The uncompressed size comes from the wire, so it is checked against maxSize and the codec's max ratio before the
+// buffer is grown.
+mama_status zmqBridgeMamaMsgImpl_decompress(void** buffer, size_t* bufferSize, uint8_t** payload, int* payloadSize, size_t maxSize)
+{
+   if (*payloadSize < (int) ZMQ_CODEC_HEADER_SIZE) {
+      MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "Compressed payload too small: %d bytes", *payloadSize);
+      return MAMA_STATUS_SYSTEM_ERROR;
+   }
+
+   const zmqCodec* codec = zmqBridge_getCodecByType((*payload)[0]);
+   if (codec == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unknown codec type=%d", (*payload)[0]);
+      return MAMA_STATUS_NOT_IMPLEMENTED;
+   }
+
+   uint32_t rawSize;
+   memcpy(&rawSize, (*payload) + 1, sizeof(rawSize));
+   rawSize = ntohl(rawSize);
+   size_t compressedSize = *payloadSize - ZMQ_CODEC_HEADER_SIZE;
+   if ((rawSize > maxSize) || (rawSize > compressedSize * codec->mMaxRatio)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Discarding %s payload w/invalid size: compressed=%zu uncompressed=%u max=%zu", codec->mName, compressedSize, rawSize, maxSize);
+      return MAMA_STATUS_SYSTEM_ERROR;
+   }
+
+   if (*bufferSize < rawSize) {
+      void* temp = realloc(*buffer, rawSize);
+      if (temp == NULL) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to allocate decompression buffer for %u bytes", rawSize);
+         return MAMA_STATUS_NOMEM;
+      }
+      *buffer = temp;
+      *bufferSize = rawSize;
+   }
+
+   int size = codec->mDecompress((*payload) + ZMQ_CODEC_HEADER_SIZE, *payloadSize - ZMQ_CODEC_HEADER_SIZE, *buffer, rawSize);
+   if (size != (int) rawSize) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "%s decompression failed: expected=%u actual=%d", codec->mName, rawSize, size);
+      return MAMA_STATUS_SYSTEM_ERROR;
+   }
+
+   *payload = *buffer;
+   *payloadSize = size;
+
+   return MAMA_STATUS_OK;
+}
+
+
+// Returns the alias defined by a msg, or NULL if the msg does not define an alias.
+const char* zmqBridgeMamaMsgImpl_getAliasDefinition(zmq_msg_t *zmsg)
+{
+   const char* source = (const char*) zmq_msg_data(zmsg);
+   const uint8_t* bufferPos = (const uint8_t*) source + strlen(source) + 1;
+   if ((*bufferPos & ZMQ_MSG_FLAG_ALIAS) == 0) {
+      return NULL;
+   }
+
+   // skip msg type and reply handle
+   bufferPos++;
+   bufferPos += strlen((const char*) bufferPos) + 1;
+   return (const char*) bufferPos;
+}
+
+
+// Reconstructs the full payload of a delta-encoded msg, and replaces zmsg w/a plain (uncompressed, non-delta)
+// msg containing it.  Msgs that are not delta-encoded are left untouched.
+// Subject is the msg's (un-aliased) subject.
+// Must be called on the dispatch thread, for every msg, in the order received.
+mama_status zmqBridgeMamaMsgImpl_applyDelta(zmqTransportBridge* transport, const char* subject, zmq_msg_t *zmsg)
+{
+   const char* source = (const char*) zmq_msg_data(zmsg);
+   size_t size = zmq_msg_size(zmsg);
+   size_t typeOffset = strlen(source) + 1;
+   uint8_t* bufferPos = (uint8_t*) source + typeOffset;
+   uint8_t msgType = *bufferPos;
+   if ((msgType & ZMQ_MSG_FLAG_DELTA) == 0) {
+      return MAMA_STATUS_OK;
+   }
+
+   // skip msg type, reply handle and alias definition
+   bufferPos++;
+   bufferPos += strlen((char*) bufferPos) + 1;
+   if (msgType & ZMQ_MSG_FLAG_ALIAS) {
+      bufferPos += ZMQ_ALIAS_SIZE + 1;
+   }
+   size_t headerSize = bufferPos - (uint8_t*) source;
+   int payloadSize = size - headerSize;
+   if (payloadSize < 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "Payload size < 0 for message: %zu bytes [payload=%d; type=%d]", size, payloadSize, msgType);
+      return MAMA_STATUS_SYSTEM_ERROR;
+   }
+
+   if (msgType & ZMQ_MSG_FLAG_COMPRESSED) {
+      CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_decompress(&transport->mDeltaBuffer, &transport->mDeltaBufferSize, &bufferPos, &payloadSize, transport->mMaxMsgSize));
+   }
+
+   // each publisher on a subject has its own stream
+   uint32_t streamId = zmqDeltaStream_getStreamId(bufferPos, payloadSize);
+   char key[MAX_SUBJECT_LENGTH + 9];
+   snprintf(key, sizeof(key), "%08x%s", streamId, subject);
+   zmqDeltaStream* stream = wtable_lookup(transport->mDeltaStreams, key);
+   if (stream == NULL) {
+      stream = zmqDeltaStream_create(streamId);
+      if ((stream == NULL) || (wtable_insert(transport->mDeltaStreams, key, stream) < 0)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create delta stream for %s", subject);
+         zmqDeltaStream_destroy(stream);
+         return MAMA_STATUS_NOMEM;
+      }
+   }
+   stream->mIsActive = 1;
+
+   const void* payload;
+   size_t fullSize;
+   zmqDeltaStatus deltaStatus = zmqDeltaStream_decode(stream, bufferPos, payloadSize, transport->mMaxMsgSize, &payload, &fullSize);
+   if (deltaStatus != ZMQ_DELTA_OK) {
+      // can't reconstruct this msg -- drop it and wait for the next key frame
+      transport->mDeltaDropped++;
+      MAMA_LOG(MAMA_LOG_LEVEL_FINER, "Dropping delta msg for %s (%d)", subject, deltaStatus);
+      return MAMA_STATUS_NOT_FOUND;
+   }
+
+   zmq_msg_t fullMsg;
+   int rc = zmq_msg_init_size(&fullMsg, headerSize + fullSize);
+   if (0 != rc) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_init_size failed %d(%s)", zmq_errno (), zmq_strerror (errno));
+      return MAMA_STATUS_PLATFORM;
+   }
+   uint8_t* fullBuffer = (uint8_t*) zmq_msg_data(&fullMsg);
+   memcpy(fullBuffer, source, headerSize);
+   fullBuffer[typeOffset] = msgType & ~(ZMQ_MSG_FLAG_DELTA | ZMQ_MSG_FLAG_COMPRESSED);
+   memcpy(fullBuffer + headerSize, payload, fullSize);
+
+   zmq_msg_move(zmsg, &fullMsg);
+   zmq_msg_close(&fullMsg);
+
+   return MAMA_STATUS_OK;
+}
+
+
 mama_status zmqBridgeMamaMsgImpl_init(zmqBridgeMsgImpl* msg)
 {
    msg->mParent = NULL;
    msg->mMsgType = ZMQ_MSG_PUB_SUB;
    strcpy(msg->mReplyHandle, "");
    strcpy(msg->mSendSubject, "");
+   msg->mPayloadBuffer = NULL;
+   msg->mPayloadBufferSize = 0;
 
    return MAMA_STATUS_OK;
 }
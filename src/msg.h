@@ -79,8 +79,73 @@ zmqBridgeMamaMsgImpl_getSendSubject(msgBridge    msg,
 mama_status zmqBridgeMamaMsgImpl_createMsgOnly(msgBridge*  msg);
 
 
-mama_status zmqBridgeMamaMsgImpl_serialize(msgBridge msg, mamaMsg source, zmq_msg_t *zmsg);
-mama_status zmqBridgeMamaMsgImpl_deserialize(msgBridge msg, zmq_msg_t *zmsg, mamaMsg target);
+/**
+ * Serializes a msg for sending.
+ *
+ * @param msg        The bridge message (header info).
+ * @param source     The MAMA message (payload).
+ * @param transport  The transport the msg is sent on -- determines whether the payload is compressed.
+ *                   May be NULL, in which case the payload is never compressed.
+ * @param zmsg       The zmq message to initialize w/the serialized msg.
+ *
+ * @return mama_status indicating whether the method succeeded or failed.
+ */
+mama_status zmqBridgeMamaMsgImpl_serialize(msgBridge msg, mamaMsg source, zmqTransportBridge* transport, zmq_msg_t *zmsg);
+
+/**
+ * Builds the bridge header for a msg, so it can be re-used across sends (e.g., by a publisher).
+ *
+ * @param header       The header to build.
+ * @param subject      The subject (or alias) the msg is sent on.
+ * @param msgType      The zmqMsgType of the msg.
+ * @param replyHandle  For requests, the reply address -- otherwise NULL.
+ * @param alias        If non-NULL, the header defines this alias for the subject.
+ *
+ * @return mama_status indicating whether the method succeeded or failed.
+ */
+mama_status zmqBridgeMamaMsgImpl_buildHeader(zmqMsgHeader* header, const char* subject, uint8_t msgType, const char* replyHandle, const char* alias);
+
+/**
+ * Serializes a msg for sending, using a pre-built header.
+ *
+ * @param header     The bridge header (see zmqBridgeMamaMsgImpl_buildHeader).
+ * @param source     The MAMA message (payload).
+ * @param transport  The transport the msg is sent on -- determines whether the payload is compressed.
+ *                   May be NULL, in which case the payload is never compressed.
+ * @param delta      If non-NULL, the payload is delta-encoded against the previous msg in the stream.
+ * @param zmsg       The zmq message to initialize w/the serialized msg.
+ *
+ * @return mama_status indicating whether the method succeeded or failed.
+ */
+mama_status zmqBridgeMamaMsgImpl_serializeWithHeader(const zmqMsgHeader* header, mamaMsg source, zmqTransportBridge* transport, zmqDeltaStream* delta, zmq_msg_t *zmsg);
+// transport (may be NULL) determines the max size of a decompressed payload
+mama_status zmqBridgeMamaMsgImpl_deserialize(msgBridge msg, zmq_msg_t *zmsg, zmqTransportBridge* transport, mamaMsg target);
+
+/**
+ * Serializes just the payload of a msg, so that it can be sent (w/o copying) to multiple subjects as the
+ * second part of a multi-part msg, following a header-only first part (see zmqBridgeMamaMsgImpl_buildHeader).
+ *
+ * @param source     The MAMA message (payload).
+ * @param transport  The transport the msg is sent on -- determines whether the payload is compressed.
+ * @param zmsg       The zmq message to initialize w/the serialized payload.
+ *
+ * @return mama_status indicating whether the method succeeded or failed.
+ */
+mama_status zmqBridgeMamaMsgImpl_serializePayload(mamaMsg source, zmqTransportBridge* transport, zmq_msg_t *zmsg);
+
+/**
+ * Joins the header and payload parts of a multi-part msg into a single msg, in the same format as a msg
+ * serialized by zmqBridgeMamaMsgImpl_serialize.
+ *
+ * @param zmsg       The header part -- replaced by the joined msg.
+ * @param payload    The payload part.
+ *
+ * @return mama_status indicating whether the method succeeded or failed.
+ */
+mama_status zmqBridgeMamaMsgImpl_joinParts(zmq_msg_t *zmsg, zmq_msg_t *payload);
+mama_status zmqBridgeMamaMsgImpl_decompress(void** buffer, size_t* bufferSize, uint8_t** payload, int* payloadSize, size_t maxSize);
+mama_status zmqBridgeMamaMsgImpl_applyDelta(zmqTransportBridge* transport, const char* subject, zmq_msg_t *zmsg);
+const char* zmqBridgeMamaMsgImpl_getAliasDefinition(zmq_msg_t *zmsg);
 const char* zmqBridgeMamaMsg_getReplyHandle(msgBridge msg);
 msgBridge zmqBridgeMamaMsgImpl_getBridgeMsg(mamaMsg mamaMsg);
 mama_status zmqBridgeMamaMsgImpl_init(zmqBridgeMsgImpl* msg);
@@ -0,0 +1,254 @@
+//
+// naming msg encodings (see naming.h)
+//
+
+#include <stdint.h>
+#include <string.h>
+
+#include "naming.h"
+
+typedef struct zmqNamingWriter {
+   uint8_t*    mBuf;
+   size_t      mSize;
+   size_t      mPos;
+   int         mOverflow;
+} zmqNamingWriter;
+
+static void putField(zmqNamingWriter* w, uint8_t tag, const void* value, size_t len)
+{
+   if ((len > UINT16_MAX) || (w->mPos + 3 + len > w->mSize)) {
+      w->mOverflow = 1;
+      return;
+   }
+   w->mBuf[w->mPos++] = tag;
+   w->mBuf[w->mPos++] = (uint8_t) (len >> 8);
+   w->mBuf[w->mPos++] = (uint8_t) len;
+   memcpy(w->mBuf + w->mPos, value, len);
+   w->mPos += len;
+}
+
+// empty strings are omitted
+static void putString(zmqNamingWriter* w, uint8_t tag, const char* value, size_t fieldSize)
+{
+   size_t len = strnlen(value, fieldSize -1);
+   if (len > 0) {
+      putField(w, tag, value, len);
+   }
+}
+
+
+size_t zmqNaming_encode(const zmqNamingMsg* msg, void* buf, size_t bufSize)
+{
+   size_t topicLen = strnlen(msg->mTopic, sizeof(msg->mTopic) -1);
+   if (topicLen + 4 > bufSize) {
+      return 0;
+   }
+
+   zmqNamingWriter w;
+   w.mBuf = buf;
+   w.mSize = bufSize;
+   w.mOverflow = 0;
+   memcpy(w.mBuf, msg->mTopic, topicLen);
+   w.mPos = topicLen;
+   w.mBuf[w.mPos++] = '\0';
+   w.mBuf[w.mPos++] = ZMQ_NAMING_COMPACT_MAGIC;
+   w.mBuf[w.mPos++] = ZMQ_NAMING_COMPACT_VERSION;
+   w.mBuf[w.mPos++] = msg->mType;
+
+   putString(&w, ZMQ_NAMING_TAG_PROGNAME, msg->mProgName, sizeof(msg->mProgName));
+   putString(&w, ZMQ_NAMING_TAG_HOST, msg->mHost, sizeof(msg->mHost));
+   uint8_t pid[8];
+   uint64_t pidValue = (uint64_t) msg->mPid;
+   for (int i = 7; i >= 0; --i) {
+      pid[i] = (uint8_t) pidValue;
+      pidValue >>= 8;
+   }
+   putField(&w, ZMQ_NAMING_TAG_PID, pid, sizeof(pid));
+   putString(&w, ZMQ_NAMING_TAG_UUID, msg->mUuid, sizeof(msg->mUuid));
+   putString(&w, ZMQ_NAMING_TAG_ENDPOINT, msg->mEndPointAddr, sizeof(msg->mEndPointAddr));
+   putString(&w, ZMQ_NAMING_TAG_IPC_ENDPOINT, msg->mIpcEndPointAddr, sizeof(msg->mIpcEndPointAddr));
+   putString(&w, ZMQ_NAMING_TAG_SHM_ENDPOINT, msg->mShmEndPointAddr, sizeof(msg->mShmEndPointAddr));
+   // alternate/partition endpoints are filled in order, so stop at the first empty one
+   for (int i = 0; (i < ZMQ_MAX_PUBLISH_ADDRESSES -1) && (msg->mAltEndPointAddrs[i][0] != '\0'); ++i) {
+      putString(&w, ZMQ_NAMING_TAG_ALT_ENDPOINT, msg->mAltEndPointAddrs[i], sizeof(msg->mAltEndPointAddrs[i]));
+   }
+   for (int i = 0; (i < ZMQ_MAX_PARTITIONS -1) && (msg->mPartitionEndPointAddrs[i][0] != '\0'); ++i) {
+      putString(&w, ZMQ_NAMING_TAG_PART_ENDPOINT, msg->mPartitionEndPointAddrs[i], sizeof(msg->mPartitionEndPointAddrs[i]));
+   }
+   if (msg->mTopicFilter > 0) {
+      putField(&w, ZMQ_NAMING_TAG_TOPIC_FILTER, &msg->mTopicFilter, 1);
+      putField(&w, ZMQ_NAMING_TAG_TOPIC_BLOOM, msg->mTopicBloom, sizeof(msg->mTopicBloom));
+   }
+   if (msg->mFlags != 0) {
+      putField(&w, ZMQ_NAMING_TAG_FLAGS, &msg->mFlags, 1);
+   }
+   if (msg->mFlags & ZMQ_NAMING_FLAG_SUB_FILTER) {
+      putField(&w, ZMQ_NAMING_TAG_SUB_BLOOM, msg->mSubBloom, sizeof(msg->mSubBloom));
+   }
+   if (msg->mHeartbeatInterval != 0) {
+      uint8_t interval[4];
+      uint32_t intervalValue = msg->mHeartbeatInterval;
+      for (int i = 3; i >= 0; --i) {
+         interval[i] = (uint8_t) intervalValue;
+         intervalValue >>= 8;
+      }
+      putField(&w, ZMQ_NAMING_TAG_HB_INTERVAL, interval, sizeof(interval));
+   }
+
+   return w.mOverflow ? 0 : w.mPos;
+}
+
+
+int zmqNaming_isCompact(const void* data, size_t size)
+{
+   const uint8_t* p = data;
+   const uint8_t* nul = memchr(p, '\0', size);
+   return (nul != NULL) && ((size_t) (nul - p) + 1 < size) && (nul[1] == ZMQ_NAMING_COMPACT_MAGIC);
+}
+
+
+// copies a string field -- returns -1 if it doesn't fit
+static int getString(char* dest, size_t destSize, const uint8_t* value, size_t len)
+{
+   if (len >= destSize) {
+      return -1;
+   }
+   memcpy(dest, value, len);
+   dest[len] = '\0';
+   return 0;
+}
+
+
+int zmqNaming_decode(const void* data, size_t size, zmqNamingMsg* msg)
+{
+   memset(msg, '\0', sizeof(zmqNamingMsg));
+
+   if (!zmqNaming_isCompact(data, size)) {
+      // msgs from older peers don't have all the fields
+      memcpy(msg, data, (size < sizeof(zmqNamingMsg)) ? size : sizeof(zmqNamingMsg));
+      msg->mTopic[sizeof(msg->mTopic) -1] = '\0';
+      return 0;
+   }
+
+   const uint8_t* p = data;
+   size_t topicLen = strlen(data);
+   if (getString(msg->mTopic, sizeof(msg->mTopic), p, topicLen) != 0) {
+      return -1;
+   }
+   size_t pos = topicLen + 2;
+   // a later version may change the layout, so don't guess
+   if ((pos + 2 > size) || (p[pos] != ZMQ_NAMING_COMPACT_VERSION)) {
+      return -1;
+   }
+   msg->mType = p[pos + 1];
+   pos += 2;
+
+   int alts = 0;
+   int parts = 0;
+   int hasBloom = 0;
+   int hasSubBloom = 0;
+   while (pos < size) {
+      if (pos + 3 > size) {
+         return -1;
+      }
+      uint8_t tag = p[pos];
+      size_t len = ((size_t) p[pos + 1] << 8) | p[pos + 2];
+      pos += 3;
+      if (pos + len > size) {
+         return -1;
+      }
+      const uint8_t* value = p + pos;
+      pos += len;
+
+      int rc = 0;
+      switch (tag) {
+         case ZMQ_NAMING_TAG_PROGNAME:
+            rc = getString(msg->mProgName, sizeof(msg->mProgName), value, len);
+            break;
+         case ZMQ_NAMING_TAG_HOST:
+            rc = getString(msg->mHost, sizeof(msg->mHost), value, len);
+            break;
+         case ZMQ_NAMING_TAG_PID:
+            if (len == 8) {
+               uint64_t pid = 0;
+               for (int i = 0; i < 8; ++i) {
+                  pid = (pid << 8) | value[i];
+               }
+               msg->mPid = (long) pid;
+            }
+            else {
+               rc = -1;
+            }
+            break;
+         case ZMQ_NAMING_TAG_UUID:
+            rc = getString(msg->mUuid, sizeof(msg->mUuid), value, len);
+            break;
+         case ZMQ_NAMING_TAG_ENDPOINT:
+            rc = getString(msg->mEndPointAddr, sizeof(msg->mEndPointAddr), value, len);
+            break;
+         case ZMQ_NAMING_TAG_IPC_ENDPOINT:
+            rc = getString(msg->mIpcEndPointAddr, sizeof(msg->mIpcEndPointAddr), value, len);
+            break;
+         case ZMQ_NAMING_TAG_SHM_ENDPOINT:
+            rc = getString(msg->mShmEndPointAddr, sizeof(msg->mShmEndPointAddr), value, len);
+            break;
+         case ZMQ_NAMING_TAG_ALT_ENDPOINT:
+            // ignore any more than we can use
+            if (alts < ZMQ_MAX_PUBLISH_ADDRESSES -1) {
+               rc = getString(msg->mAltEndPointAddrs[alts++], sizeof(msg->mAltEndPointAddrs[0]), value, len);
+            }
+            break;
+         case ZMQ_NAMING_TAG_PART_ENDPOINT:
+            // a peer w/more partitions than we support must be connected to all of them, so fail the msg
+            if (parts >= ZMQ_MAX_PARTITIONS -1) {
+               return -1;
+            }
+            rc = getString(msg->mPartitionEndPointAddrs[parts++], sizeof(msg->mPartitionEndPointAddrs[0]), value, len);
+            break;
+         case ZMQ_NAMING_TAG_TOPIC_FILTER:
+            msg->mTopicFilter = (len == 1) ? value[0] : 0;
+            break;
+         case ZMQ_NAMING_TAG_TOPIC_BLOOM:
+            // a filter of a different size is no use to us
+            if (len == sizeof(msg->mTopicBloom)) {
+               memcpy(msg->mTopicBloom, value, len);
+               hasBloom = 1;
+            }
+            break;
+         case ZMQ_NAMING_TAG_FLAGS:
+            msg->mFlags = (len == 1) ? value[0] : 0;
+            break;
+         case ZMQ_NAMING_TAG_SUB_BLOOM:
+            if (len == sizeof(msg->mSubBloom)) {
+               memcpy(msg->mSubBloom, value, len);
+               hasSubBloom = 1;
+            }
+            break;
+         case ZMQ_NAMING_TAG_HB_INTERVAL:
+            if (len == 4) {
+               msg->mHeartbeatInterval = ((uint32_t) value[0] << 24) | ((uint32_t) value[1] << 16) | ((uint32_t) value[2] << 8) | value[3];
+            }
+            else {
+               rc = -1;
+            }
+            break;
+         default:
+            // from a newer peer
+            break;
+      }
+      if (rc != 0) {
+         return -1;
+      }
+   }
+
+   // w/o a usable filter, treat the peer as publishing everything
+   if (!hasBloom) {
+      msg->mTopicFilter = 0;
+   }
+   // ... and w/o a usable subscription filter, as subscribing to everything
+   if (!hasSubBloom) {
+      msg->mFlags &= ~ZMQ_NAMING_FLAG_SUB_FILTER;
+   }
+
+   return 0;
+}
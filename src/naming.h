@@ -0,0 +1,54 @@
+#ifndef OPENMAMA_ZMQ_NAMING_H
+#define OPENMAMA_ZMQ_NAMING_H
+
+#include <stddef.h>
+
+#include "zmqdefs.h"
+
+// Wire encodings of naming msgs.
+//
+// The original ("fixed") encoding is the packed zmqNamingMsg struct itself, which is over 1KB no matter what is in it.
+// The compact encoding is variable-length:
+//   topic (nul-terminated, so it can still be used for zmq prefix matching)
+//   ZMQ_NAMING_COMPACT_MAGIC (1)
+//   version (1)
+//   mType (1)
+//   fields, each as tag (1) + length (2, big-endian) + value -- empty fields are omitted
+// Receivers skip fields w/tags they don't know, so new fields can be added w/o bumping the version.  Tags are sent on
+// the wire, so values must never be re-used.
+//
+// In the fixed encoding the byte following the topic's nul is always nul (padding), so the two can be told apart.
+
+#define ZMQ_NAMING_COMPACT_MAGIC       0xfe
+#define ZMQ_NAMING_COMPACT_VERSION     1
+// big enough for any zmqNamingMsg in the compact encoding
+#define ZMQ_NAMING_COMPACT_MAX_SIZE    (2 * sizeof(zmqNamingMsg))
+
+typedef enum zmqNamingTag_ {
+   ZMQ_NAMING_TAG_PROGNAME       = 1,
+   ZMQ_NAMING_TAG_HOST           = 2,
+   ZMQ_NAMING_TAG_PID            = 3,      // 8 bytes, big-endian
+   ZMQ_NAMING_TAG_UUID           = 4,
+   ZMQ_NAMING_TAG_ENDPOINT       = 5,
+   ZMQ_NAMING_TAG_IPC_ENDPOINT   = 6,
+   ZMQ_NAMING_TAG_SHM_ENDPOINT   = 7,
+   ZMQ_NAMING_TAG_ALT_ENDPOINT   = 8,      // repeated, in order
+   ZMQ_NAMING_TAG_PART_ENDPOINT  = 9,      // repeated, in order (partitions 1..n-1)
+   ZMQ_NAMING_TAG_TOPIC_FILTER   = 10,
+   ZMQ_NAMING_TAG_TOPIC_BLOOM    = 11,
+   ZMQ_NAMING_TAG_FLAGS          = 12,
+   ZMQ_NAMING_TAG_SUB_BLOOM      = 13,     // only sent w/ZMQ_NAMING_FLAG_SUB_FILTER
+   ZMQ_NAMING_TAG_HB_INTERVAL    = 14      // 4 bytes, big-endian
+} zmqNamingTag;
+
+// encodes msg in the compact encoding -- returns the encoded size, or 0 if it doesn't fit in bufSize
+size_t zmqNaming_encode(const zmqNamingMsg* msg, void* buf, size_t bufSize);
+
+// returns non-zero if data is in the compact encoding
+int zmqNaming_isCompact(const void* data, size_t size);
+
+// decodes a msg in either encoding -- fields that are not in the msg are zeroed.  Returns 0 on success, or -1 if the
+// msg is malformed.
+int zmqNaming_decode(const void* data, size_t size, zmqNamingMsg* msg);
+
+#endif
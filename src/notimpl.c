@@ -15,14 +15,6 @@
 #include <mama/integration/inbox.h>
 
 
-mama_status zmqBridgeMamaTransport_forceClientDisconnect(transportBridge*   transports,
-                                             int                numTransports,
-                                             const char*        ipAddress,
-                                             uint16_t           port)
-{
-   return MAMA_STATUS_NOT_IMPLEMENTED;
-}
-
 mama_status zmqBridgeMamaTransport_findConnection(transportBridge*    transports,
                                       int                 numTransports,
                                       mamaConnection*     result,
@@ -1,6 +1,33 @@
 //
 // This code was cribbed from "The ZeroMQ Guide - for C Developers" -- Example 2.7 Weather Update proxy
 //
+// In addition to proxying naming msgs, nsd keeps a directory of live peers (by uuid) from the msgs it proxies, and
+// sends it to each new subscriber right after the welcome msg.  The backend socket uses ZMQ_XPUB_MANUAL, so that the
+// snapshot can be sent to just the new subscriber (see ZMQ_NAMING_SNAPSHOT_TOPIC).
+//
+// Periodic beacon ('c') msgs are only forwarded if they are from a new peer, or if the peer's entry has changed --
+// otherwise they are consumed here, and just serve to keep the peer alive in the directory.  Options:
+//   -t <secs>   peers not heard from for this long are dropped from the directory, and a disconnect msg is sent on
+//               their behalf (default 0 = never -- should be a few times the peers' naming.beacon_interval)
+//   -r <secs>   interval at which the whole directory is re-sent to all subscribers, as a safety net for subscribers
+//               that missed a change (default 60, 0 = never)
+//   -n <count>  number of zmq io threads (default 1)
+//   -s <secs>   interval at which a separate stats thread logs msg rates, peer counts and (at FINE) per-peer beacon
+//               timing -- it gets a copy of each naming msg over an inproc capture socket (default 60, 0 = off)
+//   -c <endpoint>  control endpoint (REP socket), which accepts the same commands as zmq_proxy_steerable: "PAUSE",
+//               "RESUME", "TERMINATE" and "STATISTICS" (which replies w/the proxy's counters as text)
+//   -h <secs>   interval at which heartbeats are sent on ZMQ_NAMING_HEARTBEAT_TOPIC, so that transports w/naming.failover
+//               can tell this nsd is alive -- the interval is sent in the welcome msg, and transports switch to the next
+//               nsd after missing ZMQ_NAMING_FAILOVER_HEARTBEATS of them (default .5, 0 = off)
+//   -e <endpoint>  (repeatable) subscriber endpoint (i.e., -i/-p) of another nsd in the same cluster
+//
+// The nsd's in a cluster share their directories: each sends every msg it gets from its own peers to the others
+// (on ZMQ_NAMING_SYNC_TOPIC), and forwards msgs it gets from the others to its own subscribers.  Every nsd must list
+// every other one w/-e.  Transports w/naming.failover talk to one nsd at a time, and still see all peers, so naming
+// traffic isn't multiplied by the number of nsd's.  Transports w/o it talk to every nsd, and so get a peer's msgs
+// both from the nsd it talks to and from the others -- to keep that to a minimum, a synced connect msg that doesn't
+// change our directory is consumed, like a beacon.
+//
 
 #define _GNU_SOURCE
 
@@ -8,16 +35,568 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
 
+#include <wombat/port.h>
 #include <wombat/strutils.h>
+#include <wombat/wtable.h>
 
 #include <zmq.h>
 #include "zmqdefs.h"
+#include "naming.h"
 
 void sighandler(int unused)
 {
 }
 
+
+// directory entry for a live peer -- the last connect/beacon msg from it, and when it was received
+typedef struct nsdPeer {
+   zmqNamingMsg   mMsg;
+   uint64_t       mLastSeen;
+   int            mIsCompact;       // msgs sent on the peer's behalf use the same encoding as the peer
+} nsdPeer;
+
+// directory of live peers, by uuid
+static wtable_t gPeers = NULL;
+
+// liveness timeout, re-sync and heartbeat intervals (millis, 0 = disabled)
+static uint64_t gTimeout = 0;
+static uint64_t gResync = 60 * 1000;
+static uint64_t gHeartbeat = ZMQ_NAMING_HEARTBEAT_MILLIS;
+
+// stats
+static uint64_t gNamingMsgs = 0;
+static uint64_t gNamingBytes = 0;
+static uint64_t gBeaconsConsumed = 0;
+static uint64_t gPeersExpired = 0;
+static uint64_t gSubscriptionMsgs = 0;
+static uint64_t gSyncMsgs = 0;
+static uint64_t gCaptureDropped = 0;
+
+// copies of naming msgs go to the stats thread over this socket (NULL if stats are disabled)
+#define NSD_CAPTURE_ENDPOINT     "inproc://nsd.capture"
+static void* gCapture = NULL;
+static uint64_t gStatsInterval = 60 * 1000;
+
+
+// monotonic time in millis (nsd does not link util.c)
+static uint64_t getNow(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+// sends a copy of a naming msg to the stats thread -- never blocks the proxy (msgs are dropped if it falls behind)
+static void capture(const void* data, size_t size)
+{
+   if ((gCapture != NULL) && (size > 0) && (zmq_send(gCapture, data, size, ZMQ_DONTWAIT) < 0)) {
+      gCaptureDropped++;
+   }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// stats thread
+
+// beacon timing for one peer
+typedef struct nsdPeerStats {
+   char           mProgName[256 +1];
+   char           mHost[MAXHOSTNAMELEN + 1];
+   long           mPid;
+   uint64_t       mBeacons;
+   uint64_t       mLastSeen;
+   uint64_t       mMaxInterval;
+   uint64_t       mSumIntervals;
+} nsdPeerStats;
+
+typedef struct nsdStats {
+   wtable_t       mPeers;
+   uint64_t       mMsgs;
+   uint64_t       mConnects;
+   uint64_t       mBeacons;
+   uint64_t       mDisconnects;
+   uint64_t       mOther;
+} nsdStats;
+
+static void updateStats(nsdStats* stats, const void* data, size_t size)
+{
+   stats->mMsgs++;
+   zmqNamingMsg msg;
+   if ((zmqNaming_decode(data, size, &msg) != 0) || (strcmp(msg.mTopic, ZMQ_NAMING_PREFIX) != 0)) {
+      stats->mOther++;
+      return;
+   }
+
+   if (msg.mType == 'D') {
+      stats->mDisconnects++;
+      free(wtable_remove(stats->mPeers, msg.mUuid));
+      return;
+   }
+   if ((msg.mType != 'C') && (msg.mType != 'c')) {
+      stats->mOther++;
+      return;
+   }
+
+   uint64_t now = getNow();
+   nsdPeerStats* peer = wtable_lookup(stats->mPeers, msg.mUuid);
+   if (peer == NULL) {
+      peer = calloc(1, sizeof(nsdPeerStats));
+      if ((peer == NULL) || (wtable_insert(stats->mPeers, msg.mUuid, peer) < 0)) {
+         free(peer);
+         return;
+      }
+      wmStrSizeCpy(peer->mProgName, msg.mProgName, sizeof(peer->mProgName));
+      wmStrSizeCpy(peer->mHost, msg.mHost, sizeof(peer->mHost));
+      peer->mPid = msg.mPid;
+   }
+   else if (msg.mType == 'c') {
+      // only beacons are periodic, so only they count towards timing
+      uint64_t interval = now - peer->mLastSeen;
+      peer->mBeacons++;
+      peer->mSumIntervals += interval;
+      if (interval > peer->mMaxInterval) {
+         peer->mMaxInterval = interval;
+      }
+   }
+   if (msg.mType == 'C') {
+      stats->mConnects++;
+   }
+   else {
+      stats->mBeacons++;
+   }
+   peer->mLastSeen = now;
+}
+
+// wtable_for_each callback -- logs one peer's beacon timing
+static void logPeerStats(wtable_t table, void* data, const char* key, void* closure)
+{
+   nsdPeerStats* peer = data;
+   uint64_t now = *(uint64_t*) closure;
+   mama_log(MAMA_LOG_LEVEL_FINE, "Peer prog=%s host=%s pid=%ld uuid=%s beacons=%lu avg=%.0fms max=%lums last=%lums ago",
+      peer->mProgName, peer->mHost, peer->mPid, key, (unsigned long) peer->mBeacons,
+      (peer->mBeacons > 0) ? (double) peer->mSumIntervals / peer->mBeacons : 0.0,
+      (unsigned long) peer->mMaxInterval, (unsigned long) (now - peer->mLastSeen));
+}
+
+static void logStats(nsdStats* stats, uint64_t elapsed)
+{
+   double secs = (elapsed > 0) ? elapsed / 1000.0 : 1.0;
+   mama_log(MAMA_LOG_LEVEL_NORMAL, "Naming msgs=%lu (%.1f/s) connects=%lu beacons=%lu disconnects=%lu other=%lu peers=%lu",
+      (unsigned long) stats->mMsgs, stats->mMsgs / secs, (unsigned long) stats->mConnects, (unsigned long) stats->mBeacons,
+      (unsigned long) stats->mDisconnects, (unsigned long) stats->mOther, (unsigned long) wtable_get_count(stats->mPeers));
+   if (gMamaLogLevel >= MAMA_LOG_LEVEL_FINE) {
+      uint64_t now = getNow();
+      wtable_for_each(stats->mPeers, logPeerStats, &now);
+   }
+   stats->mMsgs = stats->mConnects = stats->mBeacons = stats->mDisconnects = stats->mOther = 0;
+}
+
+// reads msgs from the capture socket until it gets an empty msg
+static void* statsThread(void* context)
+{
+   void* socket = zmq_socket(context, ZMQ_PULL);
+   if ((socket == NULL) || (zmq_connect(socket, NSD_CAPTURE_ENDPOINT) != 0)) {
+      mama_log(MAMA_LOG_LEVEL_ERROR, "Unable to connect stats thread: %d(%s)", errno, zmq_strerror(errno));
+      zmq_close(socket);
+      return NULL;
+   }
+
+   nsdStats stats;
+   memset(&stats, '\0', sizeof(stats));
+   stats.mPeers = wtable_create("peerStats", PEER_TABLE_SIZE);
+   uint64_t lastReport = getNow();
+
+   zmq_msg_t zmsg;
+   zmq_msg_init(&zmsg);
+   while (1) {
+      uint64_t now = getNow();
+      if (now >= lastReport + gStatsInterval) {
+         logStats(&stats, now - lastReport);
+         lastReport = now;
+      }
+
+      zmq_pollitem_t item = { socket, 0, ZMQ_POLLIN, 0 };
+      int rc = zmq_poll(&item, 1, (long) (lastReport + gStatsInterval - now));
+      if ((rc < 0) && (errno != EINTR)) {
+         break;
+      }
+      if ((rc > 0) && (zmq_msg_recv(&zmsg, socket, 0) >= 0)) {
+         if (zmq_msg_size(&zmsg) == 0) {
+            break;
+         }
+         updateStats(&stats, zmq_msg_data(&zmsg), zmq_msg_size(&zmsg));
+      }
+   }
+   zmq_msg_close(&zmsg);
+
+   wtable_free_all(stats.mPeers);
+   wtable_destroy(stats.mPeers);
+   zmq_close(socket);
+   return NULL;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// proxy
+
+// applies a (decoded) naming msg to the directory -- returns non-zero if subscribers should see the msg
+// (isSync is non-zero for msgs from other nsd's)
+static int applyMsg(zmqNamingMsg* pMsg, int isCompact, int isSync)
+{
+   if ((pMsg->mType == 'C') || (pMsg->mType == 'c')) {
+      unsigned char type = pMsg->mType;
+      int isChanged = 0;
+      nsdPeer* peer = wtable_lookup(gPeers, pMsg->mUuid);
+      if (peer == NULL) {
+         peer = calloc(1, sizeof(nsdPeer));
+         if ((peer == NULL) || (wtable_insert(gPeers, pMsg->mUuid, peer) < 0)) {
+            mama_log(MAMA_LOG_LEVEL_ERROR, "Unable to add peer %s to directory", pMsg->mUuid);
+            free(peer);
+            return 1;
+         }
+         mama_log(MAMA_LOG_LEVEL_FINE, "Added peer to directory: prog=%s host=%s uuid=%s pid=%ld", pMsg->mProgName, pMsg->mHost, pMsg->mUuid, pMsg->mPid);
+         isChanged = 1;
+      }
+      else {
+         // ignore the msg type when comparing (a beacon is the same as the original connect)
+         pMsg->mType = peer->mMsg.mType;
+         isChanged = (memcmp(&peer->mMsg, pMsg, sizeof(zmqNamingMsg)) != 0);
+         pMsg->mType = type;
+      }
+      memcpy(&peer->mMsg, pMsg, sizeof(zmqNamingMsg));
+      peer->mLastSeen = getNow();
+      peer->mIsCompact = isCompact;
+
+      // connect msgs from our own peers are always forwarded, but beacons (and connect msgs synced from other nsd's,
+      // which our subscribers may also have got from the peer's own nsd) only if they tell subscribers something new
+      if (((type == 'c') || isSync) && !isChanged) {
+         gBeaconsConsumed++;
+         return 0;
+      }
+   }
+   else if (pMsg->mType == 'D') {
+      nsdPeer* peer = wtable_remove(gPeers, pMsg->mUuid);
+      if (peer != NULL) {
+         mama_log(MAMA_LOG_LEVEL_FINE, "Removed peer from directory: prog=%s host=%s uuid=%s pid=%ld", pMsg->mProgName, pMsg->mHost, pMsg->mUuid, pMsg->mPid);
+         free(peer);
+      }
+   }
+
+   return 1;
+}
+
+
+// encodes a copy of a naming msg w/the given topic and type into buf -- returns its size (0 on failure), and sets
+// *data to point to it
+static size_t encodeMsg(const zmqNamingMsg* pMsg, int isCompact, const char* topic, char type, char* buf, const void** data)
+{
+   zmqNamingMsg* msg = (zmqNamingMsg*) buf;
+   memcpy(msg, pMsg, sizeof(zmqNamingMsg));
+   memset(msg->mTopic, '\0', sizeof(msg->mTopic));
+   strcpy(msg->mTopic, topic);
+   msg->mType = type;
+   *data = msg;
+   if (!isCompact) {
+      return sizeof(zmqNamingMsg);
+   }
+   *data = buf + sizeof(zmqNamingMsg);
+   return zmqNaming_encode(msg, buf + sizeof(zmqNamingMsg), ZMQ_NAMING_COMPACT_MAX_SIZE);
+}
+
+// buffer for encodeMsg
+#define NSD_ENCODE_BUFFER_SIZE   (sizeof(zmqNamingMsg) + ZMQ_NAMING_COMPACT_MAX_SIZE)
+
+
+// sends a copy of a naming msg w/the given topic and type, in the given encoding
+static void sendMsg(void* backend, const zmqNamingMsg* pMsg, int isCompact, const char* topic, char type)
+{
+   char buf[NSD_ENCODE_BUFFER_SIZE];
+   const void* data;
+   size_t size = encodeMsg(pMsg, isCompact, topic, type, buf, &data);
+   if ((size == 0) || (zmq_send(backend, data, size, 0) != (int) size)) {
+      mama_log(MAMA_LOG_LEVEL_ERROR, "Unable to send directory entry: %d(%s)", errno, zmq_strerror(errno));
+   }
+}
+
+
+// processes a naming msg from the frontend -- returns non-zero if the msg should be forwarded to subscribers
+static int updateDirectory(void* backend, zmq_msg_t* zmsg)
+{
+   const void* data = zmq_msg_data(zmsg);
+   size_t size = zmq_msg_size(zmsg);
+   gNamingMsgs++;
+   gNamingBytes += size;
+   capture(data, size);
+
+   int isCompact = zmqNaming_isCompact(data, size);
+   if (!isCompact && (size < offsetof(zmqNamingMsg, mEndPointAddr))) {
+      return 1;
+   }
+   // msgs may be in either encoding, and msgs from older peers don't have all the fields
+   zmqNamingMsg msg;
+   if (zmqNaming_decode(data, size, &msg) != 0) {
+      mama_log(MAMA_LOG_LEVEL_WARN, "Unable to decode naming msg of size %lu", (unsigned long) size);
+      return 1;
+   }
+   if (strcmp(msg.mTopic, ZMQ_NAMING_PREFIX) != 0) {
+      return 1;
+   }
+
+   int isForwarded = applyMsg(&msg, isCompact, 0);
+
+   // other nsd's get everything from our own peers (incl. beacons, which keep the peers alive in their directories)
+   if ((msg.mType == 'C') || (msg.mType == 'c') || (msg.mType == 'D')) {
+      sendMsg(backend, &msg, isCompact, ZMQ_NAMING_SYNC_TOPIC, msg.mType);
+   }
+
+   return isForwarded;
+}
+
+
+// processes a msg from another nsd on the sync socket -- it is applied to our directory, and forwarded to our
+// subscribers (but not to other nsd's, which get it from the originating nsd themselves)
+static void handleSync(void* sync, void* backend)
+{
+   zmq_msg_t zmsg;
+   zmq_msg_init(&zmsg);
+   if (zmq_msg_recv(&zmsg, sync, 0) < 0) {
+      zmq_msg_close(&zmsg);
+      return;
+   }
+   gSyncMsgs++;
+
+   const void* data = zmq_msg_data(&zmsg);
+   size_t size = zmq_msg_size(&zmsg);
+   int isCompact = zmqNaming_isCompact(data, size);
+   zmqNamingMsg msg;
+   if ((zmqNaming_decode(data, size, &msg) != 0) || (strcmp(msg.mTopic, ZMQ_NAMING_SYNC_TOPIC) != 0)) {
+      mama_log(MAMA_LOG_LEVEL_WARN, "Unable to decode sync msg of size %lu", (unsigned long) size);
+      zmq_msg_close(&zmsg);
+      return;
+   }
+   zmq_msg_close(&zmsg);
+
+   memset(msg.mTopic, '\0', sizeof(msg.mTopic));
+   strcpy(msg.mTopic, ZMQ_NAMING_PREFIX);
+   int isForwarded = applyMsg(&msg, isCompact, 1);
+
+   char buf[NSD_ENCODE_BUFFER_SIZE];
+   size = encodeMsg(&msg, isCompact, ZMQ_NAMING_PREFIX, msg.mType, buf, &data);
+   capture(data, size);
+   if (isForwarded && ((size == 0) || (zmq_send(backend, data, size, 0) != (int) size))) {
+      mama_log(MAMA_LOG_LEVEL_ERROR, "Unable to forward sync msg: %d(%s)", errno, zmq_strerror(errno));
+   }
+}
+
+
+// sends a copy of a peer's entry w/the given topic and type
+static void sendEntry(void* backend, const nsdPeer* peer, const char* topic, char type)
+{
+   sendMsg(backend, &peer->mMsg, peer->mIsCompact, topic, type);
+}
+
+
+// wtable_for_each callback -- sends one peer's entry on the snapshot topic
+static void sendSnapshotEntry(wtable_t table, void* data, const char* key, void* closure)
+{
+   sendEntry(closure, data, ZMQ_NAMING_SNAPSHOT_TOPIC, 'C');
+}
+
+
+// wtable_for_each callback -- sends one peer's entry to other nsd's
+static void sendSyncEntry(wtable_t table, void* data, const char* key, void* closure)
+{
+   sendEntry(closure, data, ZMQ_NAMING_SYNC_TOPIC, 'c');
+}
+
+
+// wtable_for_each callback -- re-sends one peer's entry to all naming subscribers
+static void sendResyncEntry(wtable_t table, void* data, const char* key, void* closure)
+{
+   sendEntry(closure, data, ZMQ_NAMING_PREFIX, 'c');
+}
+
+
+typedef struct nsdExpiredClosure {
+   uint64_t    mCutoff;
+   nsdPeer**   mPeers;
+   size_t      mCount;
+} nsdExpiredClosure;
+
+// wtable_for_each callback -- collects peers not heard from since the cutoff
+static void findExpired(wtable_t table, void* data, const char* key, void* closure)
+{
+   nsdExpiredClosure* pClosure = closure;
+   nsdPeer* peer = data;
+   if (peer->mLastSeen < pClosure->mCutoff) {
+      pClosure->mPeers[pClosure->mCount++] = peer;
+   }
+}
+
+
+// drops peers that have stopped sending beacons, and tells subscribers to disconnect from them
+static void expirePeers(void* backend, uint64_t now)
+{
+   size_t count = wtable_get_count(gPeers);
+   if ((count == 0) || (now < gTimeout)) {
+      return;
+   }
+
+   nsdExpiredClosure closure;
+   closure.mCutoff = now - gTimeout;
+   closure.mPeers = calloc(count, sizeof(nsdPeer*));
+   closure.mCount = 0;
+   if (closure.mPeers == NULL) {
+      return;
+   }
+   wtable_for_each(gPeers, findExpired, &closure);
+
+   for (size_t i = 0; i < closure.mCount; i++) {
+      nsdPeer* peer = closure.mPeers[i];
+      mama_log(MAMA_LOG_LEVEL_NORMAL, "Peer expired from directory: prog=%s host=%s uuid=%s pid=%ld", peer->mMsg.mProgName, peer->mMsg.mHost, peer->mMsg.mUuid, peer->mMsg.mPid);
+      wtable_remove(gPeers, peer->mMsg.mUuid);
+      sendEntry(backend, peer, ZMQ_NAMING_PREFIX, 'D');
+      // stats thread needs to know about peers we drop
+      char buf[NSD_ENCODE_BUFFER_SIZE];
+      const void* data;
+      size_t size = encodeMsg(&peer->mMsg, peer->mIsCompact, ZMQ_NAMING_PREFIX, 'D', buf, &data);
+      capture(data, size);
+      free(peer);
+      gPeersExpired++;
+   }
+   free(closure.mPeers);
+}
+
+
+// processes a (un)subscribe msg from the backend -- w/ZMQ_XPUB_MANUAL, setsockopt applies to the subscriber that
+// sent the last msg received
+static int handleSubscription(void* backend, zmq_msg_t* zmsg)
+{
+   gSubscriptionMsgs++;
+   size_t size = zmq_msg_size(zmsg);
+   const char* data = (const char*) zmq_msg_data(zmsg);
+   if ((size < 1) || ((data[0] != 0) && (data[0] != 1))) {
+      return 1;
+   }
+   int isSubscribe = (data[0] == 1);
+   const char* topic = data + 1;
+   size_t topicSize = size - 1;
+
+   // naming subscribers get regular naming msgs (whose topic is nul-terminated) but not snapshots sent to others
+   int isNaming = ((topicSize == strlen(ZMQ_NAMING_PREFIX)) && (memcmp(topic, ZMQ_NAMING_PREFIX, topicSize) == 0));
+   if (isNaming) {
+      topicSize++;
+   }
+   int rc = zmq_setsockopt(backend, isSubscribe ? ZMQ_SUBSCRIBE : ZMQ_UNSUBSCRIBE, isNaming ? ZMQ_NAMING_PREFIX : topic, topicSize);
+   if (rc != 0) {
+      mama_log(MAMA_LOG_LEVEL_ERROR, "Unable to %s subscriber: %d(%s)", isSubscribe ? "subscribe" : "unsubscribe", errno, zmq_strerror(errno));
+      return 1;
+   }
+
+   // new naming subscriber gets the directory
+   if (isSubscribe && isNaming) {
+      rc = zmq_setsockopt(backend, ZMQ_SUBSCRIBE, ZMQ_NAMING_SNAPSHOT_TOPIC, strlen(ZMQ_NAMING_SNAPSHOT_TOPIC));
+      if (rc != 0) {
+         mama_log(MAMA_LOG_LEVEL_ERROR, "Unable to subscribe to snapshot: %d(%s)", errno, zmq_strerror(errno));
+         return 1;
+      }
+      wtable_for_each(gPeers, sendSnapshotEntry, backend);
+      zmq_setsockopt(backend, ZMQ_UNSUBSCRIBE, ZMQ_NAMING_SNAPSHOT_TOPIC, strlen(ZMQ_NAMING_SNAPSHOT_TOPIC));
+      mama_log(MAMA_LOG_LEVEL_FINE, "Sent snapshot of %lu peers", (unsigned long) wtable_get_count(gPeers));
+   }
+
+   // new nsd gets the directory (other nsd's see it again too, which is harmless)
+   if (isSubscribe && (topicSize == strlen(ZMQ_NAMING_SYNC_TOPIC)) && (memcmp(topic, ZMQ_NAMING_SYNC_TOPIC, topicSize) == 0)) {
+      wtable_for_each(gPeers, sendSyncEntry, backend);
+      mama_log(MAMA_LOG_LEVEL_NORMAL, "Sent directory of %lu peers to nsd", (unsigned long) wtable_get_count(gPeers));
+   }
+
+   return 1;
+}
+
+
+// forwards one (possibly multi-part) msg, calling handler w/the first part -- if handler returns zero, the msg is
+// consumed (not forwarded)
+static int forward(void* from, void* to, int (*handler)(void*, zmq_msg_t*), void* closure)
+{
+   zmq_msg_t zmsg;
+   zmq_msg_init(&zmsg);
+   int more = 0;
+   int isFirst = 1;
+   int isForwarded = 1;
+   do {
+      if (zmq_msg_recv(&zmsg, from, 0) < 0) {
+         zmq_msg_close(&zmsg);
+         return -1;
+      }
+      if (isFirst && (handler != NULL)) {
+         isForwarded = handler(closure, &zmsg);
+      }
+      isFirst = 0;
+      more = zmq_msg_more(&zmsg);
+      if (isForwarded && (zmq_msg_send(&zmsg, to, more ? ZMQ_SNDMORE : 0) < 0)) {
+         zmq_msg_close(&zmsg);
+         return -1;
+      }
+   } while (more);
+   zmq_msg_close(&zmsg);
+
+   return 0;
+}
+
+// wtable_for_each callback -- treats a peer as just having been heard from
+static void touchPeer(wtable_t table, void* data, const char* key, void* closure)
+{
+   ((nsdPeer*) data)->mLastSeen = *(uint64_t*) closure;
+}
+
+
+// processes a command from the control socket -- returns non-zero to terminate
+static int handleControl(void* control, int* isPaused)
+{
+   char command[64];
+   int size = zmq_recv(control, command, sizeof(command) -1, 0);
+   if (size < 0) {
+      return 0;
+   }
+   command[(size < (int) sizeof(command)) ? size : (int) sizeof(command) -1] = '\0';
+
+   char reply[512];
+   int isTerminate = 0;
+   strcpy(reply, "OK");
+   if (strcasecmp(command, "PAUSE") == 0) {
+      *isPaused = 1;
+   }
+   else if (strcasecmp(command, "RESUME") == 0) {
+      // don't expire peers whose beacons we didn't read while paused
+      if (*isPaused) {
+         uint64_t now = getNow();
+         wtable_for_each(gPeers, touchPeer, &now);
+      }
+      *isPaused = 0;
+   }
+   else if (strcasecmp(command, "TERMINATE") == 0) {
+      isTerminate = 1;
+   }
+   else if (strcasecmp(command, "STATISTICS") == 0) {
+      snprintf(reply, sizeof(reply), "paused=%d peers=%lu namingMsgs=%lu namingBytes=%lu beaconsConsumed=%lu peersExpired=%lu subscriptionMsgs=%lu syncMsgs=%lu captureDropped=%lu",
+         *isPaused, (unsigned long) wtable_get_count(gPeers), (unsigned long) gNamingMsgs, (unsigned long) gNamingBytes,
+         (unsigned long) gBeaconsConsumed, (unsigned long) gPeersExpired, (unsigned long) gSubscriptionMsgs, (unsigned long) gSyncMsgs, (unsigned long) gCaptureDropped);
+   }
+   else {
+      snprintf(reply, sizeof(reply), "ERROR unknown command %s", command);
+   }
+   mama_log(MAMA_LOG_LEVEL_NORMAL, "Control command %s: %s", command, reply);
+   zmq_send(control, reply, strlen(reply), 0);
+
+   return isTerminate;
+}
+
 int main (int argc, char** argv)
 {
    // setup logging
@@ -31,6 +610,10 @@ int main (int argc, char** argv)
    // get/check params
    const char* interface = NULL;
    int port = 0;
+   int ioThreads = 1;
+   const char* controlEndpoint = NULL;
+   const char* syncEndpoints[ZMQ_MAX_NAMING_URIS];
+   int syncCount = 0;
    for (int i = 1; i < argc; i++) {
       if (strcasecmp("-i", argv[i]) == 0) {
          interface = strdup(argv[++i]);
@@ -38,6 +621,27 @@ int main (int argc, char** argv)
       if (strcasecmp("-p", argv[i]) == 0) {
          port = atoi(argv[++i]);
       }
+      if (strcasecmp("-t", argv[i]) == 0) {
+         gTimeout = (uint64_t) (atof(argv[++i]) * 1000);
+      }
+      if (strcasecmp("-r", argv[i]) == 0) {
+         gResync = (uint64_t) (atof(argv[++i]) * 1000);
+      }
+      if (strcasecmp("-n", argv[i]) == 0) {
+         ioThreads = atoi(argv[++i]);
+      }
+      if (strcasecmp("-s", argv[i]) == 0) {
+         gStatsInterval = (uint64_t) (atof(argv[++i]) * 1000);
+      }
+      if (strcasecmp("-c", argv[i]) == 0) {
+         controlEndpoint = strdup(argv[++i]);
+      }
+      if (strcasecmp("-h", argv[i]) == 0) {
+         gHeartbeat = (uint64_t) (atof(argv[++i]) * 1000);
+      }
+      if ((strcasecmp("-e", argv[i]) == 0) && (syncCount < ZMQ_MAX_NAMING_URIS)) {
+         syncEndpoints[syncCount++] = strdup(argv[++i]);
+      }
    }
    if ((interface == NULL) || (port == 0)) {
       mama_log(MAMA_LOG_LEVEL_SEVERE, "Must specify both -i and -p");
@@ -49,6 +653,9 @@ int main (int argc, char** argv)
       mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to create context: %d(%s)", errno, zmq_strerror(errno));
       exit(2);
    }
+   if ((ioThreads > 1) && (zmq_ctx_set(context, ZMQ_IO_THREADS, ioThreads) != 0)) {
+      mama_log(MAMA_LOG_LEVEL_WARN, "Unable to set io threads: %d(%s)", errno, zmq_strerror(errno));
+   }
 
    // public endpoint for publishers to connect to
    char subEndpoint[ZMQ_MAX_ENDPOINT_LENGTH];
@@ -77,6 +684,18 @@ int main (int argc, char** argv)
       mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to create backend: %d(%s)", errno, zmq_strerror(errno));
       exit(6);
    }
+   int manual = 1;
+   rc = zmq_setsockopt(backend, ZMQ_XPUB_MANUAL, &manual, sizeof(manual));
+   if (rc != 0) {
+      mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to set manual subscriptions: %d(%s)", errno, zmq_strerror(errno));
+      exit(6);
+   }
+
+   gPeers = wtable_create("peers", PEER_TABLE_SIZE);
+   if (gPeers == NULL) {
+      mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to create peer directory");
+      exit(6);
+   }
 
    // public endpoint for subscribers to connect to
    char pubEndpoint[1024];
@@ -91,6 +710,11 @@ int main (int argc, char** argv)
    wmStrSizeCpy(welcomeMsg.mEndPointAddr, subEndpoint, sizeof(welcomeMsg.mEndPointAddr));
    gethostname(welcomeMsg.mHost, sizeof(welcomeMsg.mHost));
    welcomeMsg.mPid = getpid();
+   welcomeMsg.mFlags = ZMQ_NAMING_FLAG_SNAPSHOT;
+   if (gHeartbeat > 0) {
+      welcomeMsg.mFlags |= ZMQ_NAMING_FLAG_HEARTBEAT;
+      welcomeMsg.mHeartbeatInterval = (uint32_t) gHeartbeat;
+   }
    rc = zmq_setsockopt(backend, ZMQ_XPUB_WELCOME_MSG, &welcomeMsg, sizeof(welcomeMsg));
    if (rc != 0) {
       mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to set welcome message: %d(%s)", errno, zmq_strerror(errno));
@@ -104,11 +728,169 @@ int main (int argc, char** argv)
       exit(8);
    }
 
+   // stats thread reads copies of naming msgs from the capture socket
+   wthread_t statsThreadId;
+   if (gStatsInterval > 0) {
+      gCapture = zmq_socket(context, ZMQ_PUSH);
+      int linger = 0;
+      if ((gCapture == NULL) || (zmq_setsockopt(gCapture, ZMQ_LINGER, &linger, sizeof(linger)) != 0)
+         || (zmq_bind(gCapture, NSD_CAPTURE_ENDPOINT) != 0)
+         || (wthread_create(&statsThreadId, NULL, statsThread, context) != 0)) {
+         mama_log(MAMA_LOG_LEVEL_ERROR, "Unable to start stats thread: %d(%s)", errno, zmq_strerror(errno));
+         zmq_close(gCapture);
+         gCapture = NULL;
+      }
+   }
+
+   void* control = NULL;
+   if (controlEndpoint != NULL) {
+      control = zmq_socket(context, ZMQ_REP);
+      if ((control == NULL) || (zmq_bind(control, controlEndpoint) != 0)) {
+         mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to bind control endpoint %s: %d(%s)", controlEndpoint, errno, zmq_strerror(errno));
+         exit(9);
+      }
+   }
+
+   // directory updates from other nsd's in the cluster
+   void* sync = NULL;
+   if (syncCount > 0) {
+      sync = zmq_socket(context, ZMQ_SUB);
+      if ((sync == NULL) || (zmq_setsockopt(sync, ZMQ_SUBSCRIBE, ZMQ_NAMING_SYNC_TOPIC, strlen(ZMQ_NAMING_SYNC_TOPIC)) != 0)) {
+         mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to create sync socket: %d(%s)", errno, zmq_strerror(errno));
+         exit(10);
+      }
+      for (int i = 0; i < syncCount; ++i) {
+         if (zmq_connect(sync, syncEndpoints[i]) != 0) {
+            mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to connect to nsd at %s: %d(%s)", syncEndpoints[i], errno, zmq_strerror(errno));
+            exit(10);
+         }
+         mama_log(MAMA_LOG_LEVEL_NORMAL, "Syncing w/nsd at %s", syncEndpoints[i]);
+      }
+   }
+
+   // heartbeat is just the topic, and our endpoint
+   char heartbeat[sizeof(ZMQ_NAMING_HEARTBEAT_TOPIC) + sizeof(pubEndpoint)];
+   strcpy(heartbeat, ZMQ_NAMING_HEARTBEAT_TOPIC);
+   strcpy(heartbeat + sizeof(ZMQ_NAMING_HEARTBEAT_TOPIC), pubEndpoint);
+   size_t heartbeatSize = sizeof(ZMQ_NAMING_HEARTBEAT_TOPIC) + strlen(pubEndpoint) + 1;
+
    //  Run the proxy until the user interrupts us
    signal(SIGINT, &sighandler);
    mama_log(MAMA_LOG_LEVEL_NORMAL, "%s running at %s", program_invocation_short_name, pubEndpoint);
-   zmq_proxy (frontend, backend, NULL);
+   zmq_pollitem_t items[4] = {
+      { frontend, 0, ZMQ_POLLIN, 0 },
+      { backend,  0, ZMQ_POLLIN, 0 }
+   };
+   int itemCount = 2;
+   int syncItem = -1;
+   int controlItem = -1;
+   if (sync != NULL) {
+      syncItem = itemCount++;
+      items[syncItem].socket = sync;
+   }
+   if (control != NULL) {
+      controlItem = itemCount++;
+      items[controlItem].socket = control;
+   }
+   for (int i = 2; i < itemCount; ++i) {
+      items[i].fd = 0;
+      items[i].events = ZMQ_POLLIN;
+   }
+   int isPaused = 0;
+   mama_log(MAMA_LOG_LEVEL_NORMAL, "Peer timeout = %.1fs, re-sync interval = %.1fs, heartbeat interval = %.1fs", gTimeout / 1000.0, gResync / 1000.0, gHeartbeat / 1000.0);
+   uint64_t nextResync = (gResync > 0) ? getNow() + gResync : 0;
+   uint64_t nextHeartbeat = (gHeartbeat > 0) ? getNow() + gHeartbeat : 0;
+   while (1) {
+      // wake up in time to check for expired peers (at most once a second), re-sync and/or send heartbeats
+      long timeout = -1;
+      uint64_t now = getNow();
+      if (gTimeout > 0) {
+         timeout = (gTimeout < 1000) ? gTimeout : 1000;
+      }
+      if (gResync > 0) {
+         long untilResync = (nextResync > now) ? (long) (nextResync - now) : 0;
+         if ((timeout < 0) || (untilResync < timeout)) {
+            timeout = untilResync;
+         }
+      }
+      if (gHeartbeat > 0) {
+         long untilHeartbeat = (nextHeartbeat > now) ? (long) (nextHeartbeat - now) : 0;
+         if ((timeout < 0) || (untilHeartbeat < timeout)) {
+            timeout = untilHeartbeat;
+         }
+      }
+
+      // while paused, msgs are left queued (and peers aren't expired or re-sent, nor heartbeats sent) -- so there's
+      // nothing to wake up for but control msgs, and the deadlines above would just keep zmq_poll from blocking
+      if (isPaused) {
+         timeout = -1;
+      }
+      items[0].events = isPaused ? 0 : ZMQ_POLLIN;
+      items[1].events = isPaused ? 0 : ZMQ_POLLIN;
+      if (syncItem > 0) {
+         items[syncItem].events = isPaused ? 0 : ZMQ_POLLIN;
+      }
+      if (zmq_poll(items, itemCount, timeout) < 0) {
+         if (errno != EINTR) {
+            mama_log(MAMA_LOG_LEVEL_ERROR, "zmq_poll failed: %d(%s)", errno, zmq_strerror(errno));
+         }
+         break;
+      }
+      // naming msgs from publishers
+      if ((items[0].revents & ZMQ_POLLIN) && (forward(frontend, backend, updateDirectory, backend) != 0)) {
+         break;
+      }
+      // subscriptions from subscribers
+      if ((items[1].revents & ZMQ_POLLIN) && (forward(backend, frontend, handleSubscription, backend) != 0)) {
+         break;
+      }
+      // directory updates from other nsd's
+      if ((syncItem > 0) && (items[syncItem].revents & ZMQ_POLLIN)) {
+         handleSync(sync, backend);
+      }
+      if ((controlItem > 0) && (items[controlItem].revents & ZMQ_POLLIN) && (handleControl(control, &isPaused) != 0)) {
+         break;
+      }
+      if (isPaused) {
+         continue;
+      }
+
+      now = getNow();
+      if (gTimeout > 0) {
+         expirePeers(backend, now);
+      }
+      if ((gResync > 0) && (now >= nextResync)) {
+         wtable_for_each(gPeers, sendResyncEntry, backend);
+         mama_log(MAMA_LOG_LEVEL_FINE, "Re-sent directory of %lu peers", (unsigned long) wtable_get_count(gPeers));
+         nextResync = now + gResync;
+      }
+      if ((gHeartbeat > 0) && (now >= nextHeartbeat)) {
+         zmq_send(backend, heartbeat, heartbeatSize, 0);
+         nextHeartbeat = now + gHeartbeat;
+      }
+   }
    mama_log(MAMA_LOG_LEVEL_NORMAL, "%s shutting down at %s", program_invocation_short_name, pubEndpoint);
+   mama_log(MAMA_LOG_LEVEL_NORMAL, "Peers in directory = %lu", (unsigned long) wtable_get_count(gPeers));
+   mama_log(MAMA_LOG_LEVEL_NORMAL, "Beacons consumed = %lu", (unsigned long) gBeaconsConsumed);
+   mama_log(MAMA_LOG_LEVEL_NORMAL, "Peers expired = %lu", (unsigned long) gPeersExpired);
+   mama_log(MAMA_LOG_LEVEL_NORMAL, "Naming messages = %lu (%lu bytes)", (unsigned long) gNamingMsgs, (unsigned long) gNamingBytes);
+   mama_log(MAMA_LOG_LEVEL_NORMAL, "Subscription messages = %lu", (unsigned long) gSubscriptionMsgs);
+   mama_log(MAMA_LOG_LEVEL_NORMAL, "Sync messages = %lu", (unsigned long) gSyncMsgs);
+   mama_log(MAMA_LOG_LEVEL_NORMAL, "Capture messages dropped = %lu", (unsigned long) gCaptureDropped);
+   if (gCapture != NULL) {
+      // empty msg tells stats thread to exit
+      zmq_send(gCapture, "", 0, 0);
+      wthread_join(statsThreadId, NULL);
+      zmq_close(gCapture);
+   }
+   if (control != NULL) {
+      zmq_close(control);
+   }
+   if (sync != NULL) {
+      zmq_close(sync);
+   }
+   wtable_free_all(gPeers);
+   wtable_destroy(gPeers);
 
    zmq_close (frontend);
    zmq_close (backend);
@@ -7,6 +7,9 @@
 #include <property.h>
 #include <wombat/wInterlocked.h>
 
+#include <strings.h>
+#include <limits.h>
+
 #include "zmqdefs.h"
 #include "params.h"
 
@@ -98,9 +101,86 @@ void MAMACALLTYPE  zmqBridgeMamaTransportImpl_parseCommonParams(zmqTransportBrid
 
    impl->mDataReconnect = getInt(name, "retry_connects", 1);
    impl->mDataReconnectInterval = getFloat(name, "retry_interval", 10) * 1000;    // millis
-   impl->mSocketMonitor = getInt(name, "socket_monitor", 1);
+   impl->mSocketMonitor = (getInt(name, "socket_monitor", 1) != 0) ? 1 : 0;
    impl->mIsNaming = getInt(name, "is_naming", 1);
-   impl->mPublishAddress = getStr(name, "publish_address", "lo");
+   // additional interfaces are publish_address_1, publish_address_2 etc.
+   impl->mPublishAddress[0] = getStr(name, "publish_address", "lo");
+   for (int i = 1; i < ZMQ_MAX_PUBLISH_ADDRESSES; ++i) {
+      char property[64];
+      sprintf(property, "publish_address_%d", i);
+      impl->mPublishAddress[i] = getStr(name, property, NULL);
+      if (impl->mPublishAddress[i] == NULL) {
+         break;
+      }
+   }
+
+   impl->mSendPoolSize = getInt(name, "send_pool_size", 1024);
+   impl->mSendThread = getInt(name, "send_thread", 0);
+   impl->mSendRingSize = getInt(name, "send_ring_size", 4096);
+   impl->mInterest = getInt(name, "interest", 0);
+   impl->mShmSize = getInt(name, "shm_size", 64) * 1024 * 1024;
+   impl->mShmMode = (getInt(name, "shm_group", 0) == 1) ? 0640 : 0600;
+   impl->mShmPollInterval = getFloat(name, "shm_poll_interval", .001) * 1000;    // millis
+
+   impl->mRateLimit = getFloat(name, "rate_limit", 0);
+   impl->mRateBurst = getFloat(name, "rate_burst", 100);
+   impl->mPublisherRateLimit = getFloat(name, "publisher_rate_limit", 0);
+   impl->mPublisherRateBurst = getFloat(name, "publisher_rate_burst", 100);
+   impl->mRateQueueMax = getInt(name, "rate_queue_max", 10000);
+   const char* ratePolicy = getStr(name, "rate_policy", "queue");
+   if (strcasecmp(ratePolicy, "conflate") == 0) {
+      impl->mRatePolicy = ZMQ_RATE_POLICY_CONFLATE;
+   }
+   else if (strcasecmp(ratePolicy, "reject") == 0) {
+      impl->mRatePolicy = ZMQ_RATE_POLICY_REJECT;
+   }
+   else {
+      if (strcasecmp(ratePolicy, "queue") != 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Unknown rate policy (%s) -- using queue", ratePolicy);
+      }
+      impl->mRatePolicy = ZMQ_RATE_POLICY_QUEUE;
+   }
+
+   impl->mSlowConsumerMax = getInt(name, "slow_consumer_max_msgs", 0);
+   impl->mSlowConsumerInterval = getFloat(name, "slow_consumer_interval", 1) * 1000;    // millis
+   const char* slowConsumerPolicy = getStr(name, "slow_consumer_policy", "log");
+   if (strcasecmp(slowConsumerPolicy, "disconnect") == 0) {
+      impl->mSlowConsumerPolicy = ZMQ_SLOW_CONSUMER_DISCONNECT;
+   }
+   else {
+      if (strcasecmp(slowConsumerPolicy, "log") != 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Unknown slow consumer policy (%s) -- using log", slowConsumerPolicy);
+      }
+      impl->mSlowConsumerPolicy = ZMQ_SLOW_CONSUMER_LOG;
+   }
+   if ((impl->mSlowConsumerMax > 0) && (impl->mSocketMonitor == 0)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Slow consumer detection requires socket_monitor -- disabled");
+      impl->mSlowConsumerMax = 0;
+   }
+#if ZMQ_MONITOR_PEERS < 2
+   if (impl->mSlowConsumerMax > 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Slow consumer detection requires ZMQ_EVENT_PIPES_STATS (libzmq 4.3.3 or later) -- disabled");
+      impl->mSlowConsumerMax = 0;
+   }
+#endif
+
+   const char* compression = getStr(name, "compression", "none");
+   impl->mCodec = zmqBridge_getCodecByName(compression);
+   if ((impl->mCodec == NULL) && (strcasecmp(compression, "none") != 0)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Unknown compression codec (%s) -- compression disabled", compression);
+   }
+   impl->mCompressThreshold = getInt(name, "compression_threshold", 1024);
+
+   impl->mDelta = getInt(name, "delta", 0);
+   impl->mDeltaKeyInterval = getInt(name, "delta_key_interval", 100);
+   impl->mMaxMsgSize = (size_t) getInt(name, "max_msg_size", ZMQ_MAX_MSG_SIZE) * 1024 * 1024;
+
+   impl->mTopicAlias = getInt(name, "topic_alias", 0);
+   impl->mAliasRefresh = getInt(name, "topic_alias_refresh", 100);
+   if (impl->mAliasRefresh < 1) {
+      impl->mAliasRefresh = 1;
+   }
+   impl->mAliasRefreshInterval = getFloat(name, "topic_alias_refresh_interval", 1) * 1000;    // millis
 }
 
 
@@ -115,6 +195,41 @@ void MAMACALLTYPE  zmqBridgeMamaTransportImpl_parseNamingParams(zmqTransportBrid
    impl->mNamingConnectRetries = getInt(name, "naming.connect_retries", 100);
    impl->mNamingReconnect = getInt(name, "naming.retry_connects", 1);
    impl->mNamingReconnectInterval = getFloat(name, "naming.retry_interval", 10) * 1000;           // millis
+   impl->mNamingLoopback = getInt(name, "naming.loopback", 1);
+   impl->mNamingIpc = getInt(name, "naming.ipc", 1);
+   impl->mNamingShm = getInt(name, "naming.shm", 0);
+   impl->mNamingCompact = getInt(name, "naming.compact", 0);
+   impl->mNamingFailover = getInt(name, "naming.failover", 0);
+   impl->mPeerCache = getStr(name, "naming.peer_cache", NULL);
+   impl->mPeerCacheMaxAge = getInt(name, "naming.peer_cache_max_age", 3600);
+   impl->mPeerCacheTimeout = getFloat(name, "naming.peer_cache_timeout", 10) * 1000;          // millis
+   impl->mPeerCacheInterval = getFloat(name, "naming.peer_cache_interval", 0) * 1000;         // millis
+   impl->mTopicFilter = getInt(name, "naming.topic_filter", 0);
+   if ((impl->mTopicFilter < 0) || (impl->mTopicFilter > UCHAR_MAX)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "naming.topic_filter must be between 0 and %d", UCHAR_MAX);
+      impl->mTopicFilter = 0;
+   }
+   impl->mPartitions = getInt(name, "naming.partitions", 1);
+   if ((impl->mPartitions < 1) || (impl->mPartitions > ZMQ_MAX_PARTITIONS)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "naming.partitions must be between 1 and %d", ZMQ_MAX_PARTITIONS);
+      impl->mPartitions = (impl->mPartitions < 1) ? 1 : ZMQ_MAX_PARTITIONS;
+   }
+   if (impl->mPartitions > 1) {
+      // these all depend on every msg going out on the one data pub socket
+      if ((impl->mNamingLoopback != 0) || (impl->mNamingIpc != 0)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "naming.loopback and naming.ipc are not supported w/naming.partitions -- disabling");
+         impl->mNamingLoopback = 0;
+         impl->mNamingIpc = 0;
+      }
+      if (impl->mInterest != 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "interest is not supported w/naming.partitions -- disabling");
+         impl->mInterest = 0;
+      }
+      if (impl->mTopicAlias != 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "topic_alias is not supported w/naming.partitions -- disabling");
+         impl->mTopicAlias = 0;
+      }
+   }
    double f = getFloat(name, "naming.beacon_interval", 1);
    if (f <= 0) {
       impl->mBeaconInterval = 0;
@@ -127,7 +242,6 @@ void MAMACALLTYPE  zmqBridgeMamaTransportImpl_parseNamingParams(zmqTransportBrid
          wInterlocked_set(100,  &impl->mBeaconInterval);
       }
    }
-
    // The naming server address can be specified in any of the following formats:
    // 1. naming.subscribe_address[_n]/naming.subscribe_port[_n]
    // 2. naming.nsd_addr[_n]
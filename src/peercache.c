@@ -0,0 +1,136 @@
+//
+// on-disk peer cache (see peercache.h)
+//
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <mama/mama.h>
+
+#include "util.h"
+#include "naming.h"
+#include "peercache.h"
+
+typedef struct zmqPeerCacheWriter {
+   FILE*          mFile;
+   const char*    mSkipUuid;
+   int            mCount;
+   int            mError;
+} zmqPeerCacheWriter;
+
+// wtable_for_each callback -- writes one peer's record
+static void writePeer(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqPeerCacheWriter* writer = closure;
+   const zmqNamingMsg* msg = data;
+   if ((writer->mError != 0) || ((writer->mSkipUuid != NULL) && (strcmp(msg->mUuid, writer->mSkipUuid) == 0))) {
+      return;
+   }
+
+   uint8_t buf[2 + ZMQ_NAMING_COMPACT_MAX_SIZE];
+   size_t size = zmqNaming_encode(msg, buf + 2, sizeof(buf) - 2);
+   if ((size == 0) || (size > UINT16_MAX)) {
+      return;
+   }
+   buf[0] = (uint8_t) (size >> 8);
+   buf[1] = (uint8_t) size;
+   if (fwrite(buf, 1, size + 2, writer->mFile) != size + 2) {
+      writer->mError = errno;
+      return;
+   }
+   writer->mCount++;
+}
+
+
+int zmqPeerCache_save(const char* path, wtable_t peers, const char* skipUuid)
+{
+   // write to a temp file and rename it, so a reader never sees a partial file -- the temp file is unique, so that
+   // two writers (e.g., transports misconfigured w/the same path) can't interleave their records
+   char tempPath[PATH_MAX];
+   snprintf(tempPath, sizeof(tempPath), "%s.XXXXXX", path);
+   int fd = mkstemp(tempPath);
+   FILE* file = (fd >= 0) ? fdopen(fd, "wb") : NULL;
+   if (file == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unable to create peer cache %s: %d(%s)", tempPath, errno, strerror(errno));
+      if (fd >= 0) {
+         close(fd);
+         remove(tempPath);
+      }
+      return -1;
+   }
+
+   zmqPeerCacheWriter writer;
+   writer.mFile = file;
+   writer.mSkipUuid = skipUuid;
+   writer.mCount = 0;
+   writer.mError = 0;
+   if (fwrite(ZMQ_PEER_CACHE_MAGIC, 1, strlen(ZMQ_PEER_CACHE_MAGIC), file) != strlen(ZMQ_PEER_CACHE_MAGIC)) {
+      writer.mError = errno;
+   }
+   wtable_for_each(peers, writePeer, &writer);
+   if ((fclose(file) != 0) && (writer.mError == 0)) {
+      writer.mError = errno;
+   }
+   if ((writer.mError == 0) && (rename(tempPath, path) != 0)) {
+      writer.mError = errno;
+   }
+   if (writer.mError != 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unable to write peer cache %s: %d(%s)", path, writer.mError, strerror(writer.mError));
+      remove(tempPath);
+      return -1;
+   }
+
+   return writer.mCount;
+}
+
+
+int zmqPeerCache_load(const char* path, int maxAge, void (*callback)(const zmqNamingMsg* msg, void* closure), void* closure)
+{
+   struct stat st;
+   if (stat(path, &st) != 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "No peer cache at %s", path);
+      return -1;
+   }
+   if ((maxAge > 0) && (time(NULL) - st.st_mtime > maxAge)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Ignoring stale peer cache %s", path);
+      return -1;
+   }
+
+   FILE* file = fopen(path, "rb");
+   if (file == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unable to open peer cache %s: %d(%s)", path, errno, strerror(errno));
+      return -1;
+   }
+
+   char magic[sizeof(ZMQ_PEER_CACHE_MAGIC)];
+   if ((fread(magic, 1, strlen(ZMQ_PEER_CACHE_MAGIC), file) != strlen(ZMQ_PEER_CACHE_MAGIC))
+      || (memcmp(magic, ZMQ_PEER_CACHE_MAGIC, strlen(ZMQ_PEER_CACHE_MAGIC)) != 0)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Ignoring invalid peer cache %s", path);
+      fclose(file);
+      return -1;
+   }
+
+   int count = 0;
+   uint8_t header[2];
+   uint8_t buf[ZMQ_NAMING_COMPACT_MAX_SIZE];
+   while (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+      size_t size = ((size_t) header[0] << 8) | header[1];
+      zmqNamingMsg msg;
+      if ((size > sizeof(buf)) || (fread(buf, 1, size, file) != size) || (zmqNaming_decode(buf, size, &msg) != 0)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Ignoring rest of invalid peer cache %s", path);
+         break;
+      }
+      callback(&msg, closure);
+      count++;
+   }
+   fclose(file);
+
+   return count;
+}
@@ -0,0 +1,27 @@
+#ifndef OPENMAMA_ZMQ_PEERCACHE_H
+#define OPENMAMA_ZMQ_PEERCACHE_H
+
+#include <wombat/wtable.h>
+
+#include "zmqdefs.h"
+
+// On-disk cache of the peers a transport knows about (see naming.peer_cache), so that after a restart it can connect
+// to them right away, rather than waiting to hear from them over naming.
+//
+// The file is a header (ZMQ_PEER_CACHE_MAGIC) followed by one record per peer: its naming msg in the compact
+// encoding (see naming.h), preceded by its length (2 bytes, big-endian).
+//
+// Each transport (in each process) must have its own file -- writers can't corrupt each other's files, but the last
+// one to save would win, and each would load the other's peers at startup.
+
+#define ZMQ_PEER_CACHE_MAGIC     "OZPEERS1"
+
+// writes the zmqNamingMsg's in peers (except the one w/skipUuid) to path, replacing it atomically -- returns the
+// number of peers written, or -1 on error
+int zmqPeerCache_save(const char* path, wtable_t peers, const char* skipUuid);
+
+// calls callback w/each peer in path, unless the file is more than maxAge secs old (0 = any age) -- returns the number
+// of peers read, or -1 if the file is missing, stale or invalid
+int zmqPeerCache_load(const char* path, int maxAge, void (*callback)(const zmqNamingMsg* msg, void* closure), void* closure);
+
+#endif
@@ -44,6 +44,7 @@
 #include "msg.h"
 #include "inbox.h"
 #include "subscription.h"
+#include "sender.h"
 #include "zmqbridgefunctions.h"
 
 #include <zmq.h>
@@ -61,6 +62,13 @@ typedef struct zmqPublisherBridge {
    mamaPublisher           mParent;
    mamaPublisherCallbacks  mCallbacks;
    void*                   mCallbackClosure;
+   zmqDeltaStream*         mDelta;              // non-NULL if delta-encoding msgs sent on mSubject
+   zmqTopicAlias*          mAlias;              // non-NULL if sending msgs on an alias for mSubject
+   zmqMsgHeader            mHeader;             // pre-built header for msgs sent on mSubject
+   zmqMsgHeader*           mAliasHeaders;       // if aliasing, pre-built headers for [0] alias and [1] alias definition
+   uint32_t                mInterestGen;        // transport's interest generation when mHasInterest was computed
+   int                     mHasInterest;        // is any peer subscribed to mSubject?
+   zmqRateQueue*           mRateQueue;          // non-NULL if rate limiting
 } zmqPublisherBridge;
 
 /*=========================================================================
@@ -85,6 +93,57 @@ mama_status zmqBridgeMamaPublisher_sendSubject(publisherBridge publisher, mamaMs
 
 mama_status zmqBridgeMamaPublisherImpl_sendSubject(publisherBridge publisher, mamaMsg mamaMsg, msgBridge bridgeMsg, const char* subject);
 
+/**
+ * Serializes a msg for sending by a publisher.
+ *
+ * @param impl        The related zmq publisher bridge.
+ * @param mamaMsg     The MAMA message (payload).
+ * @param bridgeMsg   The bridge message (header info), or NULL.
+ * @param subject     The subject to send on, or NULL to send on the publisher's subject.
+ * @param zmsg        The zmq message to initialize w/the serialized msg.
+ *
+ * @return mama_status indicating whether the method succeeded or failed.
+ */
+static mama_status zmqBridgeMamaPublisherImpl_serialize(zmqPublisherBridge* impl, mamaMsg mamaMsg, msgBridge bridgeMsg, const char* subject, zmq_msg_t* zmsg);
+
+/**
+ * Checks whether any peer is subscribed to a subject (always true if the transport is not tracking interest).
+ * A msg that is not sent must be reported by calling this function w/skip set, so the publisher's state
+ * (e.g., delta stream) can be adjusted.
+ *
+ * @param impl        The related zmq publisher bridge.
+ * @param subject     The subject, or NULL for the publisher's subject.
+ * @param skip        If non-zero, the msg is counted as skipped if there is no interest.
+ *
+ * @return non-zero if any peer is subscribed to the subject.
+ */
+static int zmqBridgeMamaPublisherImpl_hasInterest(zmqPublisherBridge* impl, const char* subject, int skip);
+
+// max number of subjects sent by zmqBridgeMamaPublisher_sendSubjects under a single lock of the socket
+#define ZMQ_SEND_SUBJECTS_CHUNK     64
+
+// max number of msgs sent by zmqBridgeMamaPublisher_sendBatch under a single lock of the socket
+#define ZMQ_SEND_BATCH_CHUNK        64
+
+/**
+ * Builds the headers for msgs sent on the publisher's subject, so they don't need to be
+ * re-built on each send.
+ *
+ * @param impl  The related zmq publisher bridge.
+ *
+ * @return mama_status indicating whether the method succeeded or failed.
+ */
+static mama_status zmqBridgeMamaPublisherImpl_buildHeaders(zmqPublisherBridge* impl);
+
+/**
+ * Generates an id for a publisher's delta stream that is (very likely to be) unique across processes.
+ *
+ * @param transport  The transport that owns the publisher.
+ *
+ * @return The stream id.
+ */
+static uint32_t zmqBridgeMamaPublisherImpl_generateStreamId(zmqTransportBridge* transport);
+
 /*=========================================================================
  =               Public interface implementation functions               =
  =========================================================================*/
@@ -119,6 +178,40 @@ mama_status zmqBridgeMamaPublisher_createByIndex(publisherBridge* result, mamaTr
    /* Generate a topic name based on the publisher details */
    mama_status status = zmqBridgeMamaPublisherImpl_buildSendSubject(impl);
 
+   /* Delta-encoding requires per-publisher state -- note that this assumes that the publisher is not
+    * used concurrently from multiple threads */
+   if ((MAMA_STATUS_OK == status) && (transport->mDelta != 0)) {
+      impl->mDelta = zmqDeltaStream_create(zmqBridgeMamaPublisherImpl_generateStreamId(transport));
+      if (NULL == impl->mDelta) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Could not allocate delta stream for publisher.");
+         status = MAMA_STATUS_NOMEM;
+      }
+   }
+
+   /* Topic aliases are shared by all publishers on the transport (NULL if aliasing is disabled, or
+    * if we've run out of aliases) */
+   if ((MAMA_STATUS_OK == status) && (transport->mTopicAlias != 0)) {
+      impl->mAlias = zmqBridgeMamaTransportImpl_getTopicAlias(transport, impl->mSubject);
+   }
+
+   /* Peers filtering by topic need to know what namespaces we publish on */
+   if ((MAMA_STATUS_OK == status) && (transport->mTopicFilter != 0)) {
+      status = zmqBridgeMamaTransportImpl_addPubNamespace(transport, impl->mSubject);
+   }
+
+   /* Rate-limited msgs are queued per publisher */
+   if (MAMA_STATUS_OK == status) {
+      impl->mRateQueue = zmqBridgeMamaTransportImpl_createRateQueue(transport);
+   }
+
+   /* Force interest in the publisher's subject to be checked on the first send */
+   impl->mInterestGen = __atomic_load_n(&transport->mInterestGen, __ATOMIC_ACQUIRE) - 1;
+
+   /* Pre-build headers for msgs sent on the publisher's subject */
+   if (MAMA_STATUS_OK == status) {
+      status = zmqBridgeMamaPublisherImpl_buildHeaders(impl);
+   }
+
    /* Populate the publisherBridge pointer with the publisher implementation */
    *result = (publisherBridge) impl;
 
@@ -139,9 +232,16 @@ mama_status zmqBridgeMamaPublisher_destroy(publisherBridge publisher)
    void* closure = impl->mCallbackClosure;
 
    if (NULL != impl->mSubject) {
+      if (impl->mTransport->mTopicFilter != 0) {
+         zmqBridgeMamaTransportImpl_removePubNamespace(impl->mTransport, impl->mSubject);
+      }
       free((void*) impl->mSubject);
    }
 
+   zmqBridgeMamaTransportImpl_destroyRateQueue(impl->mTransport, impl->mRateQueue);
+   zmqDeltaStream_destroy(impl->mDelta);
+   free(impl->mAliasHeaders);
+
    free(impl);
 
    if (NULL != callbacks.onDestroy) {
@@ -158,6 +258,18 @@ mama_status zmqBridgeMamaPublisher_send(publisherBridge publisher, mamaMsg msg)
 }
 
 
+mama_status zmqBridgeMamaPublisher_hasInterest(publisherBridge publisher, int* result)
+{
+   if ((NULL == publisher) || (NULL == result)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   *result = zmqBridgeMamaPublisherImpl_hasInterest((zmqPublisherBridge*) publisher, NULL, 0);
+
+   return MAMA_STATUS_OK;
+}
+
+
 mama_status zmqBridgeMamaPublisher_sendSubject(publisherBridge publisher, mamaMsg msg, const char* subject)
 {
 
@@ -165,6 +277,156 @@ mama_status zmqBridgeMamaPublisher_sendSubject(publisherBridge publisher, mamaMs
 }
 
 
+// Sends the same msg to multiple subjects -- the payload is serialized once, and each subject gets a two-part msg
+// consisting of its own header and the shared payload.
+mama_status zmqBridgeMamaPublisher_sendSubjects(publisherBridge publisher, mamaMsg msg, const char** subjects, size_t count)
+{
+   if ((NULL == publisher) || (NULL == subjects)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+   zmqPublisherBridge* impl = (zmqPublisherBridge*) publisher;
+
+   // rate-limited msgs are sent individually
+   if (NULL != impl->mRateQueue) {
+      mama_status status = MAMA_STATUS_OK;
+      for (size_t i = 0; i < count; ++i) {
+         mama_status sendStatus = zmqBridgeMamaPublisherImpl_sendSubject(publisher, msg, NULL, subjects[i]);
+         if (MAMA_STATUS_OK != sendStatus) {
+            status = sendStatus;
+         }
+      }
+      return status;
+   }
+
+   // the payload is serialized when the first subject w/interest is found, so it's skipped entirely if none have any
+   zmq_msg_t payload;
+   int haveSerialized = 0;
+   mama_status status = MAMA_STATUS_OK;
+   zmq_msg_t headers[ZMQ_SEND_SUBJECTS_CHUNK];
+   size_t i = 0;
+   while (i < count) {
+      size_t chunk = 0;
+      for (; (i < count) && (chunk < ZMQ_SEND_SUBJECTS_CHUNK); ++i) {
+         if (!zmqBridgeMamaPublisherImpl_hasInterest(impl, subjects[i], 1)) {
+            continue;
+         }
+         zmqMsgHeader header;
+         if (MAMA_STATUS_OK != zmqBridgeMamaMsgImpl_buildHeader(&header, subjects[i], ZMQ_MSG_PUB_SUB, NULL, NULL)) {
+            status = MAMA_STATUS_INVALID_ARG;
+            continue;
+         }
+         if (!haveSerialized) {
+            mama_status serializeStatus = zmqBridgeMamaMsgImpl_serializePayload(msg, impl->mTransport, &payload);
+            if (MAMA_STATUS_OK != serializeStatus) {
+               return serializeStatus;
+            }
+            haveSerialized = 1;
+         }
+         if (0 != zmq_msg_init_size(&headers[chunk], header.mSize)) {
+            MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_init_size failed %d(%s)", zmq_errno(), zmq_strerror(errno));
+            for (size_t j = 0; j < chunk; ++j) {
+               zmq_msg_close(&headers[j]);
+            }
+            zmq_msg_close(&payload);
+            return MAMA_STATUS_NOMEM;
+         }
+         memcpy(zmq_msg_data(&headers[chunk]), header.mData, header.mSize);
+         ++chunk;
+      }
+      if (chunk == 0) {
+         continue;
+      }
+
+      mama_status sendStatus = zmqBridgeMamaTransportImpl_sendDataMsgs(impl->mTransport, headers, chunk, &payload);
+      if (MAMA_STATUS_OK != sendStatus) {
+         status = sendStatus;
+      }
+   }
+
+   if (haveSerialized) {
+      zmq_msg_close(&payload);
+   }
+
+   return status;
+}
+
+
+// Sends each msg on its publisher's subject -- msgs are serialized up front, and then sent together under a single
+// lock of the socket.  The status of each send is returned in statuses (if non-NULL); the return value is the
+// status of the last failed send (or MAMA_STATUS_OK if all succeeded).
+mama_status zmqBridgeMamaPublisher_sendBatch(publisherBridge* publishers, mamaMsg* msgs, mama_status* statuses, size_t count)
+{
+   if ((NULL == publishers) || (NULL == msgs)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   mama_status status = MAMA_STATUS_OK;
+   zmq_msg_t zmsgs[ZMQ_SEND_BATCH_CHUNK];
+   size_t indexes[ZMQ_SEND_BATCH_CHUNK];
+   mama_status sendStatuses[ZMQ_SEND_BATCH_CHUNK];
+   size_t i = 0;
+   while (i < count) {
+      // serialize msgs, up to the chunk size or until the transport changes
+      zmqTransportBridge* transport = NULL;
+      size_t chunk = 0;
+      for (; (i < count) && (chunk < ZMQ_SEND_BATCH_CHUNK); ++i) {
+         zmqPublisherBridge* impl = (zmqPublisherBridge*) publishers[i];
+         mama_status serializeStatus = MAMA_STATUS_NULL_ARG;
+         if ((NULL != impl) && (NULL != msgs[i])) {
+            if ((transport != NULL) && (impl->mTransport != transport)) {
+               break;
+            }
+            transport = impl->mTransport;
+            if (NULL != impl->mRateQueue) {
+               // rate-limited msgs are sent individually, but only after any msgs ahead of them in the chunk
+               if (chunk > 0) {
+                  break;
+               }
+               mama_status sendStatus = zmqBridgeMamaPublisherImpl_sendSubject(publishers[i], msgs[i], NULL, NULL);
+               if (MAMA_STATUS_OK != sendStatus) {
+                  status = sendStatus;
+               }
+               if (NULL != statuses) {
+                  statuses[i] = sendStatus;
+               }
+               continue;
+            }
+            if (!zmqBridgeMamaPublisherImpl_hasInterest(impl, NULL, 1)) {
+               if (NULL != statuses) {
+                  statuses[i] = MAMA_STATUS_OK;
+               }
+               continue;
+            }
+            serializeStatus = zmqBridgeMamaPublisherImpl_serialize(impl, msgs[i], NULL, NULL, &zmsgs[chunk]);
+         }
+         if (MAMA_STATUS_OK != serializeStatus) {
+            status = serializeStatus;
+            if (NULL != statuses) {
+               statuses[i] = serializeStatus;
+            }
+            continue;
+         }
+         indexes[chunk++] = i;
+      }
+      if (chunk == 0) {
+         continue;
+      }
+
+      zmqBridgeMamaTransportImpl_sendDataBatch(transport, zmsgs, chunk, sendStatuses);
+      for (size_t j = 0; j < chunk; ++j) {
+         if (MAMA_STATUS_OK != sendStatuses[j]) {
+            status = sendStatuses[j];
+         }
+         if (NULL != statuses) {
+            statuses[indexes[j]] = sendStatuses[j];
+         }
+      }
+   }
+
+   return status;
+}
+
+
 // Send reply to inbox from original request
 mama_status zmqBridgeMamaPublisher_sendReplyToInbox(publisherBridge publisher, void* request, mamaMsg reply)
 {
@@ -298,6 +560,32 @@ mama_status zmqBridgeMamaPublisherImpl_buildSendSubject(zmqPublisherBridge* impl
 }
 
 
+mama_status zmqBridgeMamaPublisherImpl_buildHeaders(zmqPublisherBridge* impl)
+{
+   CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_buildHeader(&impl->mHeader, impl->mSubject, ZMQ_MSG_PUB_SUB, NULL, NULL));
+
+   if (impl->mAlias != NULL) {
+      impl->mAliasHeaders = calloc(2, sizeof(zmqMsgHeader));
+      if (NULL == impl->mAliasHeaders) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Could not allocate alias headers for publisher.");
+         return MAMA_STATUS_NOMEM;
+      }
+      CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_buildHeader(&impl->mAliasHeaders[0], impl->mAlias->mAlias, ZMQ_MSG_PUB_SUB, NULL, NULL));
+      CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_buildHeader(&impl->mAliasHeaders[1], impl->mSubject, ZMQ_MSG_PUB_SUB, NULL, impl->mAlias->mAlias));
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+uint32_t zmqBridgeMamaPublisherImpl_generateStreamId(zmqTransportBridge* transport)
+{
+   // hash of transport's uuid, mixed w/publisher sequence
+   uint32_t hash = zmqBridge_hashString(transport->mUuid);
+   return hash ^ (__sync_add_and_fetch(&transport->mDeltaStreamUid, 1) * 2654435761u);
+}
+
+
 mama_status zmqBridgeMamaPublisherImpl_sendSubject(publisherBridge publisher, mamaMsg mamaMsg, msgBridge bridgeMsg, const char* subject)
 {
    if (NULL == publisher || NULL == mamaMsg) {
@@ -305,39 +593,106 @@ mama_status zmqBridgeMamaPublisherImpl_sendSubject(publisherBridge publisher, ma
    }
    zmqPublisherBridge* impl = (zmqPublisherBridge*) publisher;
 
-   // if no bridge msg passed in, allocate one on the stack
-   zmqBridgeMsgImpl tempMsg;
-   if (bridgeMsg == NULL) {
-      CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_init(&tempMsg));
-      bridgeMsg = (msgBridge) &tempMsg;
+   // don't bother serializing msgs that no-one will receive (requests and replies are always sent)
+   if ((bridgeMsg == NULL) && !zmqBridgeMamaPublisherImpl_hasInterest(impl, subject, 1)) {
+      return MAMA_STATUS_OK;
    }
 
-   // use subject passed in, or publisher's subject?
-   if (subject != NULL) {
-      zmqBridgeMamaMsg_setSendSubject(bridgeMsg, subject, NULL);
+   // over the rate limit?
+   zmqRateAction rateAction = zmqBridgeMamaTransportImpl_acquireRate(impl->mTransport, impl->mRateQueue);
+   if (rateAction == ZMQ_RATE_REJECT) {
+      return MAMA_STATUS_QUEUE_FULL;
    }
-   else {
-      zmqBridgeMamaMsg_setSendSubject(bridgeMsg, impl->mSubject, impl->mSource);
+   // only regular msgs can be conflated -- and a conflated msg can't be a delta frame, since the receiver may not
+   // see the frame it was based on
+   int canConflate = (bridgeMsg == NULL);
+   if ((rateAction == ZMQ_RATE_DEFER) && canConflate && (subject == NULL) && (impl->mDelta != NULL) &&
+       (impl->mTransport->mRatePolicy == ZMQ_RATE_POLICY_CONFLATE)) {
+      zmqDeltaStream_reset(impl->mDelta);
    }
 
-   // serialize the msg
    zmq_msg_t zmq_msg;
-   CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_serialize(bridgeMsg, mamaMsg, &zmq_msg));
+   CALL_MAMA_FUNC(zmqBridgeMamaPublisherImpl_serialize(impl, mamaMsg, bridgeMsg, subject, &zmq_msg));
+
+   if (rateAction == ZMQ_RATE_DEFER) {
+      return zmqBridgeMamaTransportImpl_queueDataMsg(impl->mTransport, impl->mRateQueue, &zmq_msg, canConflate);
+   }
 
    // send it
-   mama_status status = MAMA_STATUS_OK;
-   wlock_lock(impl->mTransport->mZmqDataPub.mLock);
-   // ZMQ_DONTWAIT is superfluous w/PUB sockets, but...
-   int i = zmq_msg_send(&zmq_msg, impl->mTransport->mZmqDataPub.mSocket, ZMQ_DONTWAIT);
-   wlock_unlock(impl->mTransport->mZmqDataPub.mLock);
-   if (i < 0) {
-      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_send failed %d(%s)", zmq_errno(), zmq_strerror(errno));
-      status = MAMA_STATUS_PLATFORM;
+   return zmqBridgeMamaTransportImpl_sendDataMsg(impl->mTransport, &zmq_msg);
+}
+
+
+mama_status zmqBridgeMamaPublisherImpl_serialize(zmqPublisherBridge* impl, mamaMsg mamaMsg, msgBridge bridgeMsg, const char* subject, zmq_msg_t* zmsg)
+{
+   if ((bridgeMsg == NULL) && (subject == NULL)) {
+      // fast path for msgs sent on the publisher's own subject, using pre-built header -- only these msgs are
+      // delta-encoded (since the receiver keeps one reference payload per subject) or aliased
+      const zmqMsgHeader* header = &impl->mHeader;
+      if (impl->mAlias != NULL) {
+         // send on alias, or (periodically, or on request) define the alias by sending it w/the full subject?
+         uint32_t sendCount = __sync_fetch_and_add(&impl->mAlias->mSendCount, 1);
+         int define = ((sendCount % impl->mTransport->mAliasRefresh) == 0);
+         if ((__atomic_load_n(&impl->mAlias->mDefine, __ATOMIC_RELAXED) == 1) &&
+             __sync_bool_compare_and_swap(&impl->mAlias->mDefine, 1, 0)) {
+            define = 1;
+         }
+         header = &impl->mAliasHeaders[define];
+      }
+      CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_serializeWithHeader(header, mamaMsg, impl->mTransport, impl->mDelta, zmsg));
    }
    else {
-      MAMA_LOG(MAMA_LOG_LEVEL_FINEST, "Sent msg w/subject:%s, size=%ld", zmq_msg_data(&zmq_msg), zmq_msg_size(&zmq_msg));
+      // if no bridge msg passed in, allocate one on the stack
+      zmqBridgeMsgImpl tempMsg;
+      if (bridgeMsg == NULL) {
+         CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_init(&tempMsg));
+         bridgeMsg = (msgBridge) &tempMsg;
+      }
+
+      // use subject passed in, or publisher's subject?
+      if (subject != NULL) {
+         zmqBridgeMamaMsg_setSendSubject(bridgeMsg, subject, NULL);
+      }
+      else {
+         zmqBridgeMamaMsg_setSendSubject(bridgeMsg, impl->mSubject, impl->mSource);
+      }
+
+      // serialize the msg
+      CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_serialize(bridgeMsg, mamaMsg, impl->mTransport, zmsg));
    }
-   zmq_msg_close (&zmq_msg);
 
-   return status;
+   return MAMA_STATUS_OK;
+}
+
+
+int zmqBridgeMamaPublisherImpl_hasInterest(zmqPublisherBridge* impl, const char* subject, int skip)
+{
+   zmqTransportBridge* transport = impl->mTransport;
+   if (transport->mInterest == 0) {
+      return 1;
+   }
+
+   int hasInterest;
+   if (subject != NULL) {
+      hasInterest = zmqBridgeMamaTransportImpl_hasInterest(transport, subject);
+   }
+   else {
+      // re-check interest in the publisher's subject only if it may have changed
+      uint32_t interestGen = __atomic_load_n(&transport->mInterestGen, __ATOMIC_ACQUIRE);
+      if (interestGen != impl->mInterestGen) {
+         impl->mHasInterest = zmqBridgeMamaTransportImpl_hasInterest(transport, impl->mSubject);
+         impl->mInterestGen = interestGen;
+      }
+      hasInterest = impl->mHasInterest;
+   }
+
+   if ((hasInterest == 0) && (skip != 0)) {
+      __sync_add_and_fetch(&transport->mInterestSkipped, 1);
+      // subscribers that show up later need a key frame to start from
+      if ((subject == NULL) && (impl->mDelta != NULL)) {
+         zmqDeltaStream_reset(impl->mDelta);
+      }
+   }
+
+   return hasInterest;
 }
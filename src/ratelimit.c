@@ -0,0 +1,64 @@
+//
+// token bucket rate limiting (see ratelimit.h)
+//
+
+#include "ratelimit.h"
+
+
+static void refill(zmqTokenBucket* bucket, uint64_t now)
+{
+   if (now > bucket->mLast) {
+      bucket->mTokens += (now - bucket->mLast) * bucket->mRate / 1000000.0;
+      if (bucket->mTokens > bucket->mBurst) {
+         bucket->mTokens = bucket->mBurst;
+      }
+   }
+   bucket->mLast = now;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void zmqTokenBucket_init(zmqTokenBucket* bucket, double rate, double burst)
+{
+   bucket->mRate = (rate > 0) ? rate : 0;
+   bucket->mBurst = (burst >= 1) ? burst : 1;
+   bucket->mTokens = bucket->mBurst;
+   bucket->mLast = 0;
+}
+
+
+int zmqTokenBucket_take(zmqTokenBucket* bucket, uint64_t now)
+{
+   if (bucket->mRate == 0) {
+      return 1;
+   }
+
+   refill(bucket, now);
+   if (bucket->mTokens < 1) {
+      return 0;
+   }
+   bucket->mTokens -= 1;
+   return 1;
+}
+
+
+void zmqTokenBucket_putBack(zmqTokenBucket* bucket)
+{
+   if (bucket->mRate != 0) {
+      bucket->mTokens += 1;
+   }
+}
+
+
+uint64_t zmqTokenBucket_wait(zmqTokenBucket* bucket, uint64_t now)
+{
+   if (bucket->mRate == 0) {
+      return 0;
+   }
+
+   refill(bucket, now);
+   if (bucket->mTokens >= 1) {
+      return 0;
+   }
+   return (uint64_t) ((1 - bucket->mTokens) * 1000000.0 / bucket->mRate) + 1;
+}
@@ -0,0 +1,26 @@
+#ifndef OPENMAMA_ZMQ_RATELIMIT_H
+#define OPENMAMA_ZMQ_RATELIMIT_H
+
+#include <stdint.h>
+
+// Token bucket: tokens accumulate at mRate per second, up to mBurst, and each msg sent takes one token.
+// Not thread-safe -- callers must serialize access.
+typedef struct zmqTokenBucket_ {
+   double         mRate;               // tokens per second (0 means unlimited)
+   double         mBurst;              // max tokens
+   double         mTokens;
+   uint64_t       mLast;               // time of last refill (micros)
+} zmqTokenBucket;
+
+void zmqTokenBucket_init(zmqTokenBucket* bucket, double rate, double burst);
+
+// returns non-zero if a token was available (and takes it)
+int zmqTokenBucket_take(zmqTokenBucket* bucket, uint64_t now);
+
+// returns a token taken by zmqTokenBucket_take (e.g., if another bucket had none)
+void zmqTokenBucket_putBack(zmqTokenBucket* bucket);
+
+// returns the number of micros until a token is available
+uint64_t zmqTokenBucket_wait(zmqTokenBucket* bucket, uint64_t now);
+
+#endif
@@ -0,0 +1,852 @@
+//
+// sending msgs on the data pub socket (see sender.h)
+//
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <mama/mama.h>
+#include <timers.h>
+#include <wombat/wInterlocked.h>
+
+#include "zmqdefs.h"
+#include "sender.h"
+#include "util.h"
+
+// max number of msgs sent from a single ring before moving on to the next ring
+#define SEND_BATCH_SIZE    64
+
+// min/max delay before flushing rate-limited msgs (micros) -- the max bounds how long stopRateLimit has to wait
+#define MIN_RATE_FLUSH_DELAY  100
+#define MAX_RATE_FLUSH_DELAY  100000
+
+extern timerHeap gOmzmqTimerHeap;
+
+// Each ring is written by a single publishing thread, and read by the sender thread.
+// Head and tail are free-running counters, and are kept on separate cache lines so producer and
+// consumer don't contend.
+typedef struct zmqSendRing_ {
+   uint32_t             mHead;               // next slot to read (sender thread)
+   char                 mPad1[64 - sizeof(uint32_t)];
+   uint32_t             mTail;               // next slot to write (publishing thread)
+   char                 mPad2[64 - sizeof(uint32_t)];
+   uint32_t             mIsOrphaned;         // publishing thread has exited -- ring can be re-used
+   uint32_t             mMask;               // capacity - 1 (capacity is a power of 2)
+   zmq_msg_t            mSlots[];
+} zmqSendRing;
+
+// stored as the ring of a thread that couldn't get one (so that it doesn't try again)
+static char gNoSendRing;
+#define NO_SEND_RING ((zmqSendRing*) &gNoSendRing)
+
+
+///////////////////////////////////////////////////////////////////////////////
+// called when a publishing thread exits -- lets another thread take over the ring
+static void zmqBridgeMamaTransportImpl_orphanSendRing(void* closure)
+{
+   zmqSendRing* ring = (zmqSendRing*) closure;
+   if (ring == NO_SEND_RING) {
+      return;
+   }
+   __atomic_store_n(&ring->mIsOrphaned, 1, __ATOMIC_RELEASE);
+}
+
+
+// returns the calling thread's ring, creating it if necessary -- or NULL if the thread has to send directly
+static zmqSendRing* zmqBridgeMamaTransportImpl_getSendRing(zmqTransportBridge* impl)
+{
+   zmqSendRing* ring = wthread_getspecific(impl->mSendRingKey);
+   if (ring != NULL) {
+      return (ring == NO_SEND_RING) ? NULL : ring;
+   }
+
+   wlock_lock(impl->mSendRingsLock);
+
+   // re-use a ring from a thread that has exited?
+   uint32_t count = __atomic_load_n(&impl->mSendRingCount, __ATOMIC_ACQUIRE);
+   for (uint32_t i = 0; i < count; ++i) {
+      if (__sync_bool_compare_and_swap(&impl->mSendRings[i]->mIsOrphaned, 1, 0)) {
+         ring = impl->mSendRings[i];
+         break;
+      }
+   }
+
+   // no -- create a new one
+   if ((ring == NULL) && (count < ZMQ_MAX_SEND_RINGS)) {
+      ring = calloc(1, sizeof(zmqSendRing) + (impl->mSendRingSize * sizeof(zmq_msg_t)));
+      if (ring != NULL) {
+         ring->mMask = impl->mSendRingSize - 1;
+         impl->mSendRings[count] = ring;
+         __atomic_store_n(&impl->mSendRingCount, count + 1, __ATOMIC_RELEASE);
+      }
+   }
+
+   wlock_unlock(impl->mSendRingsLock);
+
+   if (ring == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "No send ring available -- sending directly from this thread");
+      // don't try again for this thread
+      wthread_setspecific(impl->mSendRingKey, NO_SEND_RING);
+      return NULL;
+   }
+   wthread_setspecific(impl->mSendRingKey, ring);
+
+   return ring;
+}
+
+
+int zmqBridgeMamaTransportImpl_getPartition(const char* subject, int partitions)
+{
+   // all inbox msgs for a transport go to the same partition -- replies are sent on the full reply handle, but the
+   // requester only connects to the partition for its inbox subject (see getPartitionMask)
+   if (strncmp(subject, ZMQ_REPLYHANDLE_PREFIX, strlen(ZMQ_REPLYHANDLE_PREFIX)) == 0) {
+      char inbox[ZMQ_INBOX_SUBJECT_SIZE +1];
+      size_t size = strnlen(subject, ZMQ_INBOX_SUBJECT_SIZE);
+      memcpy(inbox, subject, size);
+      inbox[size] = '\0';
+      return zmqBridge_hashString(inbox) % partitions;
+   }
+   return zmqBridge_hashString(subject) % partitions;
+}
+
+
+// returns the socket to send msg on -- w/naming.partitions, msgs are spread across several data pub sockets by
+// subject, all of which are used w/the data pub socket's lock held
+static void* zmqBridgeMamaTransportImpl_getDataSocket(zmqTransportBridge* impl, zmq_msg_t* header)
+{
+   if (impl->mPartitions <= 1) {
+      return impl->mZmqDataPub.mSocket;
+   }
+
+   int partition = zmqBridgeMamaTransportImpl_getPartition((const char*) zmq_msg_data(header), impl->mPartitions);
+   return (partition == 0) ? impl->mZmqDataPub.mSocket : impl->mZmqPartitionPub[partition -1].mSocket;
+}
+
+
+// size of msg once joined
+static size_t zmqBridgeMamaTransportImpl_joinedSize(zmq_msg_t* header, zmq_msg_t* payload)
+{
+   return zmq_msg_size(header) + ((payload != NULL) ? zmq_msg_size(payload) - 1 : 0);
+}
+
+
+// copies msg to dest -- multi-part msgs (header and payload) are joined, as per zmqBridgeMamaMsgImpl_joinParts
+static void zmqBridgeMamaTransportImpl_joinInto(uint8_t* dest, zmq_msg_t* header, zmq_msg_t* payload)
+{
+   const uint8_t* headerData = (const uint8_t*) zmq_msg_data(header);
+   size_t headerSize = zmq_msg_size(header);
+   memcpy(dest, headerData, headerSize);
+   if (payload != NULL) {
+      const uint8_t* payloadData = (const uint8_t*) zmq_msg_data(payload);
+      dest[strnlen((const char*) headerData, headerSize) + 1] |= payloadData[0];
+      memcpy(dest + headerSize, payloadData + 1, zmq_msg_size(payload) - 1);
+   }
+}
+
+
+// copies msg to each shm ring written by this transport
+static void zmqBridgeMamaTransportImpl_writeShm(zmqTransportBridge* impl, zmq_msg_t* header, zmq_msg_t* payload)
+{
+   size_t size = zmqBridgeMamaTransportImpl_joinedSize(header, payload);
+   for (int i = 0; i < impl->mShmWriterCount; ++i) {
+      uint8_t* dest = zmqShmRing_reserve(impl->mShmWriters[i], size);
+      if (dest == NULL) {
+         impl->mShmTooBig++;
+         continue;
+      }
+      zmqBridgeMamaTransportImpl_joinInto(dest, header, payload);
+      zmqShmRing_commit(impl->mShmWriters[i]);
+   }
+}
+
+
+// sends a copy of msg on the radio socket, to the group for its subject, w/a trailer that lets receivers detect
+// lost msgs (radio sockets don't support multi-part msgs, so these are sent joined)
+static void zmqBridgeMamaTransportImpl_sendRadio(zmqTransportBridge* impl, zmq_msg_t* header, zmq_msg_t* payload)
+{
+   char group[ZMQ_RADIO_GROUP_SIZE +1];
+   zmqBridgeMamaTransportImpl_getRadioGroup(impl, (const char*) zmq_msg_data(header), group);
+
+   uint32_t* seq = wtable_lookup(impl->mRadioSendSeqs, group);
+   if (seq == NULL) {
+      seq = calloc(1, sizeof(uint32_t));
+      if ((seq == NULL) || (wtable_insert(impl->mRadioSendSeqs, group, seq) < 0)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create radio seq for group %s", group);
+         free(seq);
+         return;
+      }
+   }
+
+   size_t size = zmqBridgeMamaTransportImpl_joinedSize(header, payload);
+   zmq_msg_t zmsg;
+   if (0 != zmq_msg_init_size(&zmsg, size + sizeof(zmqRadioTrailer))) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_init_size failed %d(%s)", zmq_errno(), zmq_strerror(errno));
+      return;
+   }
+   uint8_t* dest = (uint8_t*) zmq_msg_data(&zmsg);
+   zmqBridgeMamaTransportImpl_joinInto(dest, header, payload);
+   zmqRadioTrailer trailer;
+   trailer.mTag = impl->mRadioTag;
+   trailer.mSeq = ++(*seq);
+   memcpy(dest + size, &trailer, sizeof(trailer));
+
+#if defined(ZMQ_RADIO) && defined(ZMQ_DISH)
+   zmq_msg_set_group(&zmsg, group);
+#endif
+   if (zmq_msg_send(&zmsg, impl->mZmqRadio.mSocket, ZMQ_DONTWAIT) < 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_send failed on radio socket %d(%s)", zmq_errno(), zmq_strerror(errno));
+      impl->mSendErrors++;
+   }
+   zmq_msg_close(&zmsg);
+}
+
+
+// copies msg to the transport's other outputs (shm rings, radio socket) -- called w/the data pub socket's lock held,
+// before the msg is sent (which consumes it)
+static void zmqBridgeMamaTransportImpl_sendCopies(zmqTransportBridge* impl, zmq_msg_t* header, zmq_msg_t* payload)
+{
+   if (impl->mShmWriterCount > 0) {
+      zmqBridgeMamaTransportImpl_writeShm(impl, header, payload);
+   }
+   if (impl->mZmqRadio.mSocket != NULL) {
+      zmqBridgeMamaTransportImpl_sendRadio(impl, header, payload);
+   }
+}
+
+
+void zmqBridgeMamaTransportImpl_getRadioGroup(zmqTransportBridge* impl, const char* subject, char* group)
+{
+   // all inbox msgs for a transport go to the same group
+   size_t size = strlen(subject);
+   if (strncmp(subject, ZMQ_REPLYHANDLE_PREFIX, strlen(ZMQ_REPLYHANDLE_PREFIX)) == 0) {
+      if (size > ZMQ_INBOX_SUBJECT_SIZE) {
+         size = ZMQ_INBOX_SUBJECT_SIZE;
+      }
+   }
+   if (size > ZMQ_RADIO_GROUP_SIZE) {
+      size = ZMQ_RADIO_GROUP_SIZE;
+   }
+   memcpy(group, subject, size);
+   group[size] = '\0';
+}
+
+
+// wakes up the sender thread if it is waiting for msgs
+static void zmqBridgeMamaTransportImpl_wakeSender(zmqTransportBridge* impl)
+{
+   // the store to the ring's tail must be visible before we check whether the sender is sleeping -- otherwise the
+   // sender could see an empty ring and go to sleep after we saw it awake (pairs w/the fence in senderThread)
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   if ((__atomic_load_n(&impl->mSenderSleeping, __ATOMIC_SEQ_CST) == 1) &&
+       (__sync_bool_compare_and_swap(&impl->mSenderSleeping, 1, 0))) {
+      wsem_post(&impl->mSenderSem);
+   }
+}
+
+
+// sends up to max msgs from ring -- called w/the data pub socket's lock held, which serializes readers of the ring
+// (i.e., the sender thread, and the ring's own publishing thread when the ring is full)
+static size_t zmqBridgeMamaTransportImpl_drainSendRing(zmqTransportBridge* impl, zmqSendRing* ring, size_t max)
+{
+   size_t sent = 0;
+   uint32_t head = __atomic_load_n(&ring->mHead, __ATOMIC_RELAXED);
+   uint32_t tail = __atomic_load_n(&ring->mTail, __ATOMIC_ACQUIRE);
+   for (; (head != tail) && (sent < max); ++head, ++sent) {
+      zmq_msg_t* zmsg = &ring->mSlots[head & ring->mMask];
+      zmqBridgeMamaTransportImpl_sendCopies(impl, zmsg, NULL);
+      if (zmq_msg_send(zmsg, zmqBridgeMamaTransportImpl_getDataSocket(impl, zmsg), ZMQ_DONTWAIT) < 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_send failed %d(%s)", zmq_errno(), zmq_strerror(errno));
+         impl->mSendErrors++;
+      }
+      zmq_msg_close(zmsg);
+   }
+   __atomic_store_n(&ring->mHead, head, __ATOMIC_RELEASE);
+
+   return sent;
+}
+
+
+// sends whatever is in the rings -- returns number of msgs sent
+static size_t zmqBridgeMamaTransportImpl_drainSendRings(zmqTransportBridge* impl)
+{
+   size_t sent = 0;
+   int isLocked = 0;
+
+   uint32_t count = __atomic_load_n(&impl->mSendRingCount, __ATOMIC_ACQUIRE);
+   for (uint32_t i = 0; i < count; ++i) {
+      zmqSendRing* ring = impl->mSendRings[i];
+      if (__atomic_load_n(&ring->mHead, __ATOMIC_RELAXED) == __atomic_load_n(&ring->mTail, __ATOMIC_ACQUIRE)) {
+         continue;
+      }
+
+      // only take the lock if there's something to send (the lock is still needed for other users of the
+      // socket, e.g. naming, but is uncontended by publishers)
+      if (isLocked == 0) {
+         wlock_lock(impl->mZmqDataPub.mLock);
+         isLocked = 1;
+      }
+
+      sent += zmqBridgeMamaTransportImpl_drainSendRing(impl, ring, SEND_BATCH_SIZE);
+   }
+
+   if (isLocked == 1) {
+      wlock_unlock(impl->mZmqDataPub.mLock);
+   }
+
+   return sent;
+}
+
+
+static int zmqBridgeMamaTransportImpl_sendRingsEmpty(zmqTransportBridge* impl)
+{
+   uint32_t count = __atomic_load_n(&impl->mSendRingCount, __ATOMIC_ACQUIRE);
+   for (uint32_t i = 0; i < count; ++i) {
+      zmqSendRing* ring = impl->mSendRings[i];
+      if (ring->mHead != __atomic_load_n(&ring->mTail, __ATOMIC_ACQUIRE)) {
+         return 0;
+      }
+   }
+   return 1;
+}
+
+
+static void* zmqBridgeMamaTransportImpl_senderThread(void* closure)
+{
+   zmqTransportBridge* impl = (zmqTransportBridge*) closure;
+
+   while (1) {
+      // read flag before draining, so that everything queued before stop is sent
+      int isSending = wInterlocked_read(&impl->mIsSending);
+      if (zmqBridgeMamaTransportImpl_drainSendRings(impl) > 0) {
+         continue;
+      }
+      if (isSending == 0) {
+         break;
+      }
+
+      // nothing to send -- wait for a publisher to wake us (re-check after setting the flag, in case a msg
+      // was queued in the meantime)
+      __atomic_store_n(&impl->mSenderSleeping, 1, __ATOMIC_SEQ_CST);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      if ((zmqBridgeMamaTransportImpl_sendRingsEmpty(impl) == 1) && (wInterlocked_read(&impl->mIsSending) == 1)) {
+         wsem_wait(&impl->mSenderSem);
+      }
+      __atomic_store_n(&impl->mSenderSleeping, 0, __ATOMIC_SEQ_CST);
+   }
+
+   return NULL;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+mama_status zmqBridgeMamaTransportImpl_startSender(zmqTransportBridge* impl)
+{
+   // lives as long as the transport, since a publisher can still release its ring after stopSender returns
+   wsem_init(&impl->mSendRingUsersSem, 0, 0);
+
+   if (impl->mSendThread == 0) {
+      return MAMA_STATUS_OK;
+   }
+
+   // ring capacity must be a power of 2
+   uint32_t size = 2;
+   while (size < impl->mSendRingSize) {
+      size <<= 1;
+   }
+   impl->mSendRingSize = size;
+
+   impl->mSendRingsLock = wlock_create();
+   impl->mSendRingCount = 0;
+   impl->mSendRingUsers = 0;
+   impl->mSenderSleeping = 0;
+   wsem_init(&impl->mSenderSem, 0, 0);
+   int rc = wthread_key_create(&impl->mSendRingKey, zmqBridgeMamaTransportImpl_orphanSendRing);
+   if (0 != rc) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "create of send ring key failed %d(%s)", rc, strerror(rc));
+      return MAMA_STATUS_PLATFORM;
+   }
+
+   wInterlocked_initialize(&impl->mIsSending);
+   wInterlocked_set(1, &impl->mIsSending);
+
+   rc = wthread_create(&impl->mSenderThread, NULL, zmqBridgeMamaTransportImpl_senderThread, impl);
+   if (0 != rc) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "create of sender thread failed %d(%s)", rc, strerror(rc));
+      return MAMA_STATUS_PLATFORM;
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+mama_status zmqBridgeMamaTransportImpl_stopSender(zmqTransportBridge* impl)
+{
+   if (impl->mSendThread == 0) {
+      return MAMA_STATUS_OK;
+   }
+
+   // from here on, msgs are sent directly -- wait for publishers that are still using their rings to finish
+   __atomic_store_n(&impl->mSendThread, 0, __ATOMIC_SEQ_CST);
+   // (the last one to release its ring posts the sem -- extra posts from earlier releases just cause a re-check)
+   while (__atomic_load_n(&impl->mSendRingUsers, __ATOMIC_SEQ_CST) != 0) {
+      wsem_wait(&impl->mSendRingUsersSem);
+   }
+
+   // sender thread drains the rings before exiting
+   wInterlocked_set(0, &impl->mIsSending);
+   wsem_post(&impl->mSenderSem);
+   int rc = wthread_join(impl->mSenderThread, NULL);
+   if (0 != rc) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "join of sender thread failed %d(%s)", rc, strerror(rc));
+   }
+
+   // deleting the key ensures that the destructor is not called for threads that exit after this
+   wthread_key_delete(impl->mSendRingKey);
+   for (uint32_t i = 0; i < impl->mSendRingCount; ++i) {
+      free(impl->mSendRings[i]);
+   }
+   impl->mSendRingCount = 0;
+   wsem_destroy(&impl->mSenderSem);
+   wlock_destroy(impl->mSendRingsLock);
+   wInterlocked_destroy(&impl->mIsSending);
+
+   return MAMA_STATUS_OK;
+}
+
+
+// wakes stopSender if it is waiting for this (the last) user -- pairs w/stopSender, which clears mSendThread before
+// checking the count, so either it sees the count drop to 0, or we see that it is stopping
+static void zmqBridgeMamaTransportImpl_releaseSendRing(zmqTransportBridge* impl)
+{
+   if ((__atomic_sub_fetch(&impl->mSendRingUsers, 1, __ATOMIC_SEQ_CST) == 0) &&
+       (__atomic_load_n(&impl->mSendThread, __ATOMIC_SEQ_CST) == 0)) {
+      wsem_post(&impl->mSendRingUsersSem);
+   }
+}
+
+
+// returns the calling thread's ring, or NULL if it has to send directly (no sender thread, or it has been stopped)
+// -- a ring that is returned must be released w/releaseSendRing once the caller is done w/it, which is what lets
+// stopSender know when it is safe to free the rings
+static zmqSendRing* zmqBridgeMamaTransportImpl_acquireSendRing(zmqTransportBridge* impl)
+{
+   if (__atomic_load_n(&impl->mSendThread, __ATOMIC_ACQUIRE) == 0) {
+      return NULL;
+   }
+
+   // pairs w/stopSender -- either it sees our count, or we see that the sender thread is stopping
+   __atomic_add_fetch(&impl->mSendRingUsers, 1, __ATOMIC_SEQ_CST);
+   zmqSendRing* ring = NULL;
+   if (__atomic_load_n(&impl->mSendThread, __ATOMIC_SEQ_CST) != 0) {
+      ring = zmqBridgeMamaTransportImpl_getSendRing(impl);
+   }
+   if (ring == NULL) {
+      zmqBridgeMamaTransportImpl_releaseSendRing(impl);
+   }
+   return ring;
+}
+
+
+// sends msg on the data pub socket -- called w/the socket's lock held
+static mama_status zmqBridgeMamaTransportImpl_sendLocked(zmqTransportBridge* impl, zmq_msg_t* zmsg)
+{
+   mama_status status = MAMA_STATUS_OK;
+   zmqBridgeMamaTransportImpl_sendCopies(impl, zmsg, NULL);
+   // ZMQ_DONTWAIT is superfluous w/PUB sockets, but...
+   if (zmq_msg_send(zmsg, zmqBridgeMamaTransportImpl_getDataSocket(impl, zmsg), ZMQ_DONTWAIT) < 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_send failed %d(%s)", zmq_errno(), zmq_strerror(errno));
+      status = MAMA_STATUS_PLATFORM;
+   }
+   return status;
+}
+
+
+mama_status zmqBridgeMamaTransportImpl_sendDataMsg(zmqTransportBridge* impl, zmq_msg_t* zmsg)
+{
+   MAMA_LOG(MAMA_LOG_LEVEL_FINEST, "Sending msg w/subject:%s, size=%ld", zmq_msg_data(zmsg), zmq_msg_size(zmsg));
+
+   zmqSendRing* ring = zmqBridgeMamaTransportImpl_acquireSendRing(impl);
+   if (ring == NULL) {
+      wlock_lock(impl->mZmqDataPub.mLock);
+      mama_status status = zmqBridgeMamaTransportImpl_sendLocked(impl, zmsg);
+      wlock_unlock(impl->mZmqDataPub.mLock);
+      zmq_msg_close(zmsg);
+      return status;
+   }
+
+   uint32_t tail = ring->mTail;
+   if (tail - __atomic_load_n(&ring->mHead, __ATOMIC_ACQUIRE) > ring->mMask) {
+      // ring is full -- rather than wait for the sender thread, send the ring's msgs ourselves (so msgs from this
+      // thread still go out in order), followed by this one
+      __sync_add_and_fetch(&impl->mSendRingFull, 1);
+      wlock_lock(impl->mZmqDataPub.mLock);
+      zmqBridgeMamaTransportImpl_drainSendRing(impl, ring, ring->mMask + 1);
+      mama_status status = zmqBridgeMamaTransportImpl_sendLocked(impl, zmsg);
+      wlock_unlock(impl->mZmqDataPub.mLock);
+      zmqBridgeMamaTransportImpl_releaseSendRing(impl);
+      zmq_msg_close(zmsg);
+      return status;
+   }
+
+   // hand off msg to sender thread (errors are logged and counted there)
+   zmq_msg_t* slot = &ring->mSlots[tail & ring->mMask];
+   zmq_msg_init(slot);
+   zmq_msg_move(slot, zmsg);
+   zmq_msg_close(zmsg);
+   __atomic_store_n(&ring->mTail, tail + 1, __ATOMIC_RELEASE);
+
+   zmqBridgeMamaTransportImpl_wakeSender(impl);
+   zmqBridgeMamaTransportImpl_releaseSendRing(impl);
+
+   return MAMA_STATUS_OK;
+}
+
+
+void zmqBridgeMamaTransportImpl_sendDataBatch(zmqTransportBridge* impl, zmq_msg_t* zmsgs, size_t count, mama_status* statuses)
+{
+   // w/the sender thread, msgs are queued individually (which doesn't take the lock anyway)
+   zmqSendRing* ring = zmqBridgeMamaTransportImpl_acquireSendRing(impl);
+   if (ring != NULL) {
+      for (size_t i = 0; i < count; ++i) {
+         statuses[i] = zmqBridgeMamaTransportImpl_sendDataMsg(impl, &zmsgs[i]);
+      }
+      zmqBridgeMamaTransportImpl_releaseSendRing(impl);
+      return;
+   }
+
+   wlock_lock(impl->mZmqDataPub.mLock);
+   for (size_t i = 0; i < count; ++i) {
+      MAMA_LOG(MAMA_LOG_LEVEL_FINEST, "Sending msg w/subject:%s, size=%ld", zmq_msg_data(&zmsgs[i]), zmq_msg_size(&zmsgs[i]));
+      statuses[i] = zmqBridgeMamaTransportImpl_sendLocked(impl, &zmsgs[i]);
+   }
+   wlock_unlock(impl->mZmqDataPub.mLock);
+
+   for (size_t i = 0; i < count; ++i) {
+      zmq_msg_close(&zmsgs[i]);
+   }
+}
+
+mama_status zmqBridgeMamaTransportImpl_sendDataMsgs(zmqTransportBridge* impl, zmq_msg_t* headers, size_t count, zmq_msg_t* payload)
+{
+   mama_status status = MAMA_STATUS_OK;
+   zmqSendRing* ring = zmqBridgeMamaTransportImpl_acquireSendRing(impl);
+   wlock_lock(impl->mZmqDataPub.mLock);
+
+   // multi-part msgs are sent directly, but only after this thread's queued msgs, so that msgs from the same thread
+   // are still sent in order
+   if (ring != NULL) {
+      zmqBridgeMamaTransportImpl_drainSendRing(impl, ring, ring->mMask + 1);
+      zmqBridgeMamaTransportImpl_releaseSendRing(impl);
+   }
+
+   for (size_t i = 0; i < count; ++i) {
+      MAMA_LOG(MAMA_LOG_LEVEL_FINEST, "Sending msg w/subject:%s, size=%ld", zmq_msg_data(&headers[i]), zmq_msg_size(payload));
+
+      // each send consumes its copy of the payload (zmq_msg_copy shares the buffer)
+      zmq_msg_t part;
+      zmq_msg_init(&part);
+      zmq_msg_copy(&part, payload);
+      zmqBridgeMamaTransportImpl_sendCopies(impl, &headers[i], payload);
+      void* socket = zmqBridgeMamaTransportImpl_getDataSocket(impl, &headers[i]);
+      if ((zmq_msg_send(&headers[i], socket, ZMQ_SNDMORE | ZMQ_DONTWAIT) < 0) ||
+          (zmq_msg_send(&part, socket, ZMQ_DONTWAIT) < 0)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_send failed %d(%s)", zmq_errno(), zmq_strerror(errno));
+         status = MAMA_STATUS_PLATFORM;
+      }
+      zmq_msg_close(&part);
+      zmq_msg_close(&headers[i]);
+   }
+   wlock_unlock(impl->mZmqDataPub.mLock);
+
+   return status;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// rate limiting
+
+static int zmqBridgeMamaTransportImpl_isRateLimited(zmqTransportBridge* impl)
+{
+   return (impl->mRateLimit > 0) || (impl->mPublisherRateLimit > 0);
+}
+
+
+// takes a token from both the publisher's and the transport's buckets, or neither (called w/mRateLock held)
+static int zmqBridgeMamaTransportImpl_takeTokens(zmqTransportBridge* impl, zmqRateQueue* queue, uint64_t now)
+{
+   if (zmqTokenBucket_take(&queue->mBucket, now) == 0) {
+      return 0;
+   }
+   if (zmqTokenBucket_take(&impl->mRateBucket, now) == 0) {
+      zmqTokenBucket_putBack(&queue->mBucket);
+      return 0;
+   }
+   return 1;
+}
+
+
+static void zmqBridgeMamaTransportImpl_rateTimerCallback(timerElement timer, void* closure);
+
+// arranges for queued msgs to be sent after delay (called w/mRateLock held)
+static void zmqBridgeMamaTransportImpl_scheduleFlush(zmqTransportBridge* impl, uint64_t delay)
+{
+   if ((impl->mRateTimer != NULL) || (impl->mRateStopping != 0)) {
+      return;
+   }
+
+   if (delay < MIN_RATE_FLUSH_DELAY) {
+      delay = MIN_RATE_FLUSH_DELAY;
+   }
+   else if (delay > MAX_RATE_FLUSH_DELAY) {
+      delay = MAX_RATE_FLUSH_DELAY;
+   }
+   struct timeval timeout;
+   timeout.tv_sec  = delay / 1000000;
+   timeout.tv_usec = delay % 1000000;
+
+   lockTimerHeap(gOmzmqTimerHeap);
+   int rc = createTimer((timerElement*) &impl->mRateTimer, gOmzmqTimerHeap, zmqBridgeMamaTransportImpl_rateTimerCallback, &timeout, impl);
+   unlockTimerHeap(gOmzmqTimerHeap);
+   if (0 != rc) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create rate limit timer [%d].", rc);
+      impl->mRateTimer = NULL;
+   }
+}
+
+
+// sends queued msgs, as far as the rate limits allow (or all of them if force is set), and returns the number of
+// micros until more can be sent (or 0 if there's nothing left to send) -- called w/mRateLock held
+static uint64_t zmqBridgeMamaTransportImpl_flushRateQueues(zmqTransportBridge* impl, int force)
+{
+   uint64_t now = getMicros();
+   uint64_t minWait = 0;
+
+   zmqRateQueue** prev = &impl->mPendingQueues;
+   while (*prev != NULL) {
+      zmqRateQueue* queue = *prev;
+      while ((queue->mHead != NULL) && ((force != 0) || zmqBridgeMamaTransportImpl_takeTokens(impl, queue, now))) {
+         zmqPendingMsg* pending = queue->mHead;
+         queue->mHead = pending->mNext;
+         queue->mCount--;
+         zmqBridgeMamaTransportImpl_sendDataMsg(impl, &pending->mZmsg);
+         free(pending);
+      }
+
+      if (queue->mHead == NULL) {
+         queue->mTail = NULL;
+         queue->mIsPending = 0;
+         *prev = queue->mNextPending;
+         queue->mNextPending = NULL;
+         continue;
+      }
+
+      uint64_t wait = zmqTokenBucket_wait(&queue->mBucket, now);
+      uint64_t transportWait = zmqTokenBucket_wait(&impl->mRateBucket, now);
+      if (transportWait > wait) {
+         wait = transportWait;
+      }
+      if ((minWait == 0) || (wait < minWait)) {
+         minWait = (wait > 0) ? wait : 1;
+      }
+      prev = &queue->mNextPending;
+   }
+
+   return minWait;
+}
+
+
+// called on the timer thread -- the timer is only ever destroyed here (once its callback can no longer be
+// running), and stopRateLimit waits for it (on mRateTimerSem)
+static void zmqBridgeMamaTransportImpl_rateTimerCallback(timerElement timer, void* closure)
+{
+   zmqTransportBridge* impl = (zmqTransportBridge*) closure;
+
+   wlock_lock(impl->mRateLock);
+
+   // timers are single-shot
+   lockTimerHeap(gOmzmqTimerHeap);
+   destroyTimer(gOmzmqTimerHeap, timer);
+   unlockTimerHeap(gOmzmqTimerHeap);
+   impl->mRateTimer = NULL;
+   if (impl->mRateStopping == 0) {
+      uint64_t wait = zmqBridgeMamaTransportImpl_flushRateQueues(impl, 0);
+      if (wait > 0) {
+         zmqBridgeMamaTransportImpl_scheduleFlush(impl, wait);
+      }
+   }
+   else {
+      wsem_post(&impl->mRateTimerSem);
+   }
+   wlock_unlock(impl->mRateLock);
+}
+
+
+mama_status zmqBridgeMamaTransportImpl_startRateLimit(zmqTransportBridge* impl)
+{
+   impl->mRateLock = wlock_create();
+   zmqTokenBucket_init(&impl->mRateBucket, impl->mRateLimit, impl->mRateBurst);
+   impl->mPendingQueues = NULL;
+   impl->mRateTimer = NULL;
+   impl->mRateStopping = 0;
+   wsem_init(&impl->mRateTimerSem, 0, 0);
+
+   return MAMA_STATUS_OK;
+}
+
+
+mama_status zmqBridgeMamaTransportImpl_stopRateLimit(zmqTransportBridge* impl)
+{
+   wlock_lock(impl->mRateLock);
+   impl->mRateStopping = 1;
+   zmqBridgeMamaTransportImpl_flushRateQueues(impl, 1);
+   // a scheduled flush can't be cancelled safely (its callback may already be waiting for the lock), so wait for it
+   // to run -- it does nothing once mRateStopping is set (other than post mRateTimerSem), and is due within
+   // MAX_RATE_FLUSH_DELAY.  No new flush can be scheduled once mRateStopping is set.
+   int isScheduled = (impl->mRateTimer != NULL);
+   wlock_unlock(impl->mRateLock);
+   if (isScheduled) {
+      wsem_wait(&impl->mRateTimerSem);
+      // the callback posts w/the lock held, so make sure it's done w/it
+      wlock_lock(impl->mRateLock);
+      wlock_unlock(impl->mRateLock);
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+zmqRateQueue* zmqBridgeMamaTransportImpl_createRateQueue(zmqTransportBridge* impl)
+{
+   if (!zmqBridgeMamaTransportImpl_isRateLimited(impl)) {
+      return NULL;
+   }
+
+   zmqRateQueue* queue = calloc(1, sizeof(zmqRateQueue));
+   if (queue != NULL) {
+      zmqTokenBucket_init(&queue->mBucket, impl->mPublisherRateLimit, impl->mPublisherRateBurst);
+   }
+   return queue;
+}
+
+
+void zmqBridgeMamaTransportImpl_destroyRateQueue(zmqTransportBridge* impl, zmqRateQueue* queue)
+{
+   if (queue == NULL) {
+      return;
+   }
+
+   wlock_lock(impl->mRateLock);
+   if (queue->mIsPending != 0) {
+      zmqRateQueue** prev = &impl->mPendingQueues;
+      while ((*prev != NULL) && (*prev != queue)) {
+         prev = &(*prev)->mNextPending;
+      }
+      if (*prev != NULL) {
+         *prev = queue->mNextPending;
+      }
+   }
+   wlock_unlock(impl->mRateLock);
+
+   if (queue->mCount > 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Discarding %zu rate-limited msgs", queue->mCount);
+   }
+   while (queue->mHead != NULL) {
+      zmqPendingMsg* pending = queue->mHead;
+      queue->mHead = pending->mNext;
+      zmq_msg_close(&pending->mZmsg);
+      free(pending);
+   }
+   free(queue);
+}
+
+
+zmqRateAction zmqBridgeMamaTransportImpl_acquireRate(zmqTransportBridge* impl, zmqRateQueue* queue)
+{
+   if (queue == NULL) {
+      return ZMQ_RATE_SEND;
+   }
+
+   // msgs already queued must go first
+   zmqRateAction action = ZMQ_RATE_SEND;
+   wlock_lock(impl->mRateLock);
+   if ((queue->mHead != NULL) || !zmqBridgeMamaTransportImpl_takeTokens(impl, queue, getMicros())) {
+      action = (impl->mRatePolicy == ZMQ_RATE_POLICY_REJECT) ? ZMQ_RATE_REJECT : ZMQ_RATE_DEFER;
+   }
+   wlock_unlock(impl->mRateLock);
+
+   if (action == ZMQ_RATE_REJECT) {
+      __sync_add_and_fetch(&impl->mRateRejected, 1);
+   }
+   return action;
+}
+
+
+mama_status zmqBridgeMamaTransportImpl_queueDataMsg(zmqTransportBridge* impl, zmqRateQueue* queue, zmq_msg_t* zmsg, int canConflate)
+{
+   wlock_lock(impl->mRateLock);
+
+   // stopRateLimit has already flushed the queues, and no more flushes will be scheduled, so a queued msg would never
+   // be sent -- send it now instead
+   if (impl->mRateStopping != 0) {
+      wlock_unlock(impl->mRateLock);
+      return zmqBridgeMamaTransportImpl_sendDataMsg(impl, zmsg);
+   }
+
+   // replace queued msg for the same subject?
+   if ((canConflate != 0) && (impl->mRatePolicy == ZMQ_RATE_POLICY_CONFLATE)) {
+      const char* subject = (const char*) zmq_msg_data(zmsg);
+      for (zmqPendingMsg* pending = queue->mHead; pending != NULL; pending = pending->mNext) {
+         if ((pending->mCanConflate != 0) && (strcmp((const char*) zmq_msg_data(&pending->mZmsg), subject) == 0)) {
+            zmq_msg_close(&pending->mZmsg);
+            zmq_msg_init(&pending->mZmsg);
+            zmq_msg_move(&pending->mZmsg, zmsg);
+            wlock_unlock(impl->mRateLock);
+            zmq_msg_close(zmsg);
+            __sync_add_and_fetch(&impl->mRateConflated, 1);
+            return MAMA_STATUS_OK;
+         }
+      }
+   }
+
+   zmqPendingMsg* pending = NULL;
+   if (queue->mCount < impl->mRateQueueMax) {
+      pending = malloc(sizeof(zmqPendingMsg));
+   }
+   if (pending == NULL) {
+      wlock_unlock(impl->mRateLock);
+      zmq_msg_close(zmsg);
+      __sync_add_and_fetch(&impl->mRateRejected, 1);
+      return MAMA_STATUS_QUEUE_FULL;
+   }
+
+   zmq_msg_init(&pending->mZmsg);
+   zmq_msg_move(&pending->mZmsg, zmsg);
+   pending->mCanConflate = canConflate;
+   pending->mNext = NULL;
+   if (queue->mTail != NULL) {
+      queue->mTail->mNext = pending;
+   }
+   else {
+      queue->mHead = pending;
+   }
+   queue->mTail = pending;
+   queue->mCount++;
+
+   if (queue->mIsPending == 0) {
+      queue->mIsPending = 1;
+      queue->mNextPending = impl->mPendingQueues;
+      impl->mPendingQueues = queue;
+   }
+
+   uint64_t now = getMicros();
+   uint64_t wait = zmqTokenBucket_wait(&queue->mBucket, now);
+   uint64_t transportWait = zmqTokenBucket_wait(&impl->mRateBucket, now);
+   zmqBridgeMamaTransportImpl_scheduleFlush(impl, (transportWait > wait) ? transportWait : wait);
+
+   wlock_unlock(impl->mRateLock);
+   zmq_msg_close(zmsg);
+   __sync_add_and_fetch(&impl->mRateQueued, 1);
+
+   return MAMA_STATUS_OK;
+}
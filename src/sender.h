@@ -0,0 +1,56 @@
+#ifndef OPENMAMA_ZMQ_SENDER_H
+#define OPENMAMA_ZMQ_SENDER_H
+
+#include "zmqdefs.h"
+
+// Sends msgs on the transport's data pub socket.
+//
+// By default, each publishing thread sends directly on the socket, serialized by the socket's lock.
+// With send_thread enabled, each publishing thread instead queues msgs to its own single-producer/single-consumer
+// ring, and a dedicated sender thread drains all the rings in batches onto the socket.  Msgs sent from a single
+// thread are sent in order, but there is no ordering across threads.  A publishing thread whose ring is full sends
+// the ring's msgs itself (rather than waiting for the sender thread), and once the sender thread is stopped all msgs
+// are sent directly.
+
+mama_status zmqBridgeMamaTransportImpl_startSender(zmqTransportBridge* impl);
+mama_status zmqBridgeMamaTransportImpl_stopSender(zmqTransportBridge* impl);
+
+// sends (or queues) a msg on the data pub socket -- zmsg is always closed on return
+mama_status zmqBridgeMamaTransportImpl_sendDataMsg(zmqTransportBridge* impl, zmq_msg_t* zmsg);
+
+// sends (or queues) count msgs w/a single lock of the socket, returning the status of each in statuses -- msgs are
+// always closed on return
+void zmqBridgeMamaTransportImpl_sendDataBatch(zmqTransportBridge* impl, zmq_msg_t* zmsgs, size_t count, mama_status* statuses);
+
+// Rate limiting (enabled if either rate_limit or publisher_rate_limit is set) -- each publisher gets a rate queue, and
+// must call acquireRate before sending.  Msgs that can't be sent immediately are (depending on rate_policy) either
+// rejected, or queued via queueDataMsg and sent later from the timer thread.
+typedef enum zmqRateAction_ {
+   ZMQ_RATE_SEND = 0,               // send the msg now
+   ZMQ_RATE_DEFER,                  // queue the msg w/zmqBridgeMamaTransportImpl_queueDataMsg
+   ZMQ_RATE_REJECT                  // reject the msg
+} zmqRateAction;
+
+mama_status zmqBridgeMamaTransportImpl_startRateLimit(zmqTransportBridge* impl);
+// sends any queued msgs (regardless of rate)
+mama_status zmqBridgeMamaTransportImpl_stopRateLimit(zmqTransportBridge* impl);
+// returns NULL if rate limiting is not enabled
+zmqRateQueue* zmqBridgeMamaTransportImpl_createRateQueue(zmqTransportBridge* impl);
+// discards any queued msgs
+void zmqBridgeMamaTransportImpl_destroyRateQueue(zmqTransportBridge* impl, zmqRateQueue* queue);
+zmqRateAction zmqBridgeMamaTransportImpl_acquireRate(zmqTransportBridge* impl, zmqRateQueue* queue);
+// zmsg is always closed on return
+mama_status zmqBridgeMamaTransportImpl_queueDataMsg(zmqTransportBridge* impl, zmqRateQueue* queue, zmq_msg_t* zmsg, int canConflate);
+
+// sends the same payload w/each of count headers, as two-part msgs -- headers are always closed on return, but payload
+// is not (so it can be sent again)
+mama_status zmqBridgeMamaTransportImpl_sendDataMsgs(zmqTransportBridge* impl, zmq_msg_t* headers, size_t count, zmq_msg_t* payload);
+
+// returns the partition that msgs on subject are sent to (see naming.partitions) -- inbox subjects are hashed on just
+// their first ZMQ_INBOX_SUBJECT_SIZE chars, so all of a transport's inboxes are in one partition
+int zmqBridgeMamaTransportImpl_getPartition(const char* subject, int partitions);
+
+// returns the group that msgs on subject are sent to on the radio socket (group must hold ZMQ_RADIO_GROUP_SIZE +1)
+void zmqBridgeMamaTransportImpl_getRadioGroup(zmqTransportBridge* impl, const char* subject, char* group);
+
+#endif
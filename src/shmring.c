@@ -0,0 +1,377 @@
+//
+// shared memory broadcast ring (see shmring.h)
+//
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <mama/mama.h>
+
+#include "util.h"
+#include "shmring.h"
+
+#define SHM_RING_MAGIC        0x4f5a52494e470001ULL     // "OZRING" + version
+#define SHM_RING_ALIGN        8
+#define SHM_RING_MIN_SIZE     65536
+#define SHM_ATTACH_MILLIS     1000                      // min interval between attempts to attach to the ring
+#define SHM_DIR               "/dev/shm"
+
+// at the start of the segment -- positions are free-running byte offsets into the data area, and are kept on
+// separate cache lines
+typedef struct zmqShmRingHeader_ {
+   uint64_t             mMagic;                 // set last, once the ring is initialized
+   uint64_t             mSize;                  // size of data area (power of 2)
+   uint32_t             mIsClosed;              // writer has gone away
+   char                 mPad1[64 - 20];
+   uint64_t             mReserved;              // writer may be writing anything up to here
+   char                 mPad2[64 - 8];
+   uint64_t             mWritten;               // msgs up to here are complete
+   char                 mPad3[64 - 8];
+} zmqShmRingHeader;
+
+// precedes each msg in the ring -- a record w/mSize of zero pads out the end of the ring
+typedef struct zmqShmRecord_ {
+   uint32_t             mSize;
+   uint32_t             mSeq;
+} zmqShmRecord;
+
+struct zmqShmRing_ {
+   char                 mName[256];
+   char                 mPath[256];             // name of shm object
+   int                  mIsWriter;
+   zmqShmRingHeader*    mHeader;                // NULL if not attached
+   uint8_t*             mData;
+   size_t               mMapSize;
+   uint64_t             mSize;
+   uint64_t             mPos;                   // writer: end of committed msgs; reader: next msg to read
+   uint32_t             mSeq;                   // writer: seq of next msg; reader: expected seq of next msg
+   uint64_t             mNextPos;               // writer: end of reserved msg; reader: end of msg returned by peek
+   uint32_t             mNextSeq;               // reader: seq of msg returned by peek
+   int                  mHasSeq;                // reader: has read at least one msg since attaching
+   uint64_t             mLost;
+   uint64_t             mLastAttach;            // millis
+};
+
+
+static zmqShmRing* zmqShmRing_alloc(const char* name, int isWriter)
+{
+   zmqShmRing* ring = calloc(1, sizeof(zmqShmRing));
+   if (ring == NULL) {
+      return NULL;
+   }
+   snprintf(ring->mName, sizeof(ring->mName), "%s", name);
+   snprintf(ring->mPath, sizeof(ring->mPath), "/%s", name);
+   ring->mIsWriter = isWriter;
+
+   return ring;
+}
+
+
+static void zmqShmRing_detach(zmqShmRing* ring)
+{
+   if (ring->mHeader != NULL) {
+      munmap(ring->mHeader, ring->mMapSize);
+      ring->mHeader = NULL;
+      ring->mData = NULL;
+   }
+}
+
+
+// tries to map an existing ring -- returns 0 if successful
+static int zmqShmRing_attach(zmqShmRing* ring)
+{
+   ring->mLastAttach = getMillis();
+
+   int fd = shm_open(ring->mPath, O_RDONLY, 0);
+   if (fd < 0) {
+      // most likely the writer hasn't started yet
+      return -1;
+   }
+   struct stat st;
+   if ((fstat(fd, &st) != 0) || (st.st_size <= (off_t) sizeof(zmqShmRingHeader))) {
+      close(fd);
+      return -1;
+   }
+   void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if (map == MAP_FAILED) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "mmap of shm ring %s failed %d(%s)", ring->mName, errno, strerror(errno));
+      return -1;
+   }
+
+   zmqShmRingHeader* header = (zmqShmRingHeader*) map;
+   if ((__atomic_load_n(&header->mMagic, __ATOMIC_ACQUIRE) != SHM_RING_MAGIC) ||
+       (header->mSize + sizeof(zmqShmRingHeader) != (uint64_t) st.st_size) || (header->mIsClosed != 0)) {
+      // not initialized yet (or not ours)
+      munmap(map, st.st_size);
+      return -1;
+   }
+
+   ring->mHeader = header;
+   ring->mData = (uint8_t*) (header + 1);
+   ring->mMapSize = st.st_size;
+   ring->mSize = header->mSize;
+   // start w/the next msg written
+   ring->mPos = __atomic_load_n(&header->mWritten, __ATOMIC_ACQUIRE);
+   ring->mHasSeq = 0;
+
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Attached to shm ring %s (size=%lu)", ring->mName, ring->mSize);
+
+   return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+zmqShmRing* zmqShmRing_create(const char* name, size_t size, int mode)
+{
+   zmqShmRing* ring = zmqShmRing_alloc(name, 1);
+   if (ring == NULL) {
+      return NULL;
+   }
+
+   ring->mSize = SHM_RING_MIN_SIZE;
+   while (ring->mSize < size) {
+      ring->mSize <<= 1;
+   }
+   ring->mMapSize = sizeof(zmqShmRingHeader) + ring->mSize;
+
+   // a ring left over from a previous writer (e.g., one that crashed) is marked closed, so any readers still
+   // attached to it will re-attach to the new one
+   int fd = shm_open(ring->mPath, O_RDWR, 0);
+   if (fd >= 0) {
+      struct stat st;
+      if ((fstat(fd, &st) == 0) && (st.st_size >= (off_t) sizeof(zmqShmRingHeader))) {
+         void* map = mmap(NULL, sizeof(zmqShmRingHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+         if (map != MAP_FAILED) {
+            __atomic_store_n(&((zmqShmRingHeader*) map)->mIsClosed, 1, __ATOMIC_RELEASE);
+            munmap(map, sizeof(zmqShmRingHeader));
+         }
+      }
+      close(fd);
+      shm_unlink(ring->mPath);
+   }
+
+   fd = shm_open(ring->mPath, O_CREAT | O_EXCL | O_RDWR, mode);
+   if (fd < 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "shm_open of shm ring %s failed %d(%s)", name, errno, strerror(errno));
+      free(ring);
+      return NULL;
+   }
+   if (ftruncate(fd, ring->mMapSize) != 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "ftruncate of shm ring %s failed %d(%s)", name, errno, strerror(errno));
+      close(fd);
+      shm_unlink(ring->mPath);
+      free(ring);
+      return NULL;
+   }
+   void* map = mmap(NULL, ring->mMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   if (map == MAP_FAILED) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "mmap of shm ring %s failed %d(%s)", name, errno, strerror(errno));
+      shm_unlink(ring->mPath);
+      free(ring);
+      return NULL;
+   }
+
+   // new segment is zero-filled
+   ring->mHeader = (zmqShmRingHeader*) map;
+   ring->mData = (uint8_t*) (ring->mHeader + 1);
+   ring->mHeader->mSize = ring->mSize;
+   __atomic_store_n(&ring->mHeader->mMagic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Created shm ring %s (size=%lu)", ring->mName, ring->mSize);
+
+   return ring;
+}
+
+
+zmqShmRing* zmqShmRing_open(const char* name)
+{
+   zmqShmRing* ring = zmqShmRing_alloc(name, 0);
+   if (ring != NULL) {
+      zmqShmRing_attach(ring);
+   }
+
+   return ring;
+}
+
+
+void zmqShmRing_destroy(zmqShmRing* ring)
+{
+   if (ring == NULL) {
+      return;
+   }
+
+   if ((ring->mIsWriter == 1) && (ring->mHeader != NULL)) {
+      __atomic_store_n(&ring->mHeader->mIsClosed, 1, __ATOMIC_RELEASE);
+      shm_unlink(ring->mPath);
+   }
+   zmqShmRing_detach(ring);
+   free(ring);
+}
+
+
+void zmqShmRing_cleanup(const char* prefix)
+{
+   DIR* dir = opendir(SHM_DIR);
+   if (dir == NULL) {
+      return;
+   }
+
+   size_t prefixSize = strlen(prefix);
+   struct dirent* entry;
+   while ((entry = readdir(dir)) != NULL) {
+      if (strncmp(entry->d_name, prefix, prefixSize) != 0) {
+         continue;
+      }
+      char* end = NULL;
+      long pid = strtol(entry->d_name + prefixSize, &end, 10);
+      if ((pid <= 0) || (end == NULL) || (*end != '.')) {
+         continue;
+      }
+      // EPERM means the process exists (but belongs to someone else)
+      if ((kill((pid_t) pid, 0) == 0) || (errno != ESRCH)) {
+         continue;
+      }
+
+      char path[sizeof(entry->d_name) + 1];
+      snprintf(path, sizeof(path), "/%s", entry->d_name);
+      if (shm_unlink(path) == 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Removed shm ring %s left behind by pid %ld", entry->d_name, pid);
+      }
+   }
+   closedir(dir);
+}
+
+
+const char* zmqShmRing_getName(zmqShmRing* ring)
+{
+   return ring->mName;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void* zmqShmRing_reserve(zmqShmRing* ring, size_t size)
+{
+   uint64_t need = (sizeof(zmqShmRecord) + size + SHM_RING_ALIGN - 1) & ~((uint64_t) SHM_RING_ALIGN - 1);
+   if (need > ring->mSize / 4) {
+      return NULL;
+   }
+
+   uint64_t pos = ring->mPos;
+   uint64_t offset = pos & (ring->mSize - 1);
+   uint64_t pad = (offset + need > ring->mSize) ? ring->mSize - offset : 0;
+
+   // let readers know what is about to be overwritten, before overwriting it
+   __atomic_store_n(&ring->mHeader->mReserved, pos + pad + need, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+
+   if (pad > 0) {
+      zmqShmRecord* padRecord = (zmqShmRecord*) (ring->mData + offset);
+      padRecord->mSize = 0;
+      padRecord->mSeq = 0;
+      pos += pad;
+      offset = 0;
+   }
+
+   zmqShmRecord* record = (zmqShmRecord*) (ring->mData + offset);
+   record->mSize = size;
+   record->mSeq = ring->mSeq;
+   ring->mNextPos = pos + need;
+
+   return record + 1;
+}
+
+
+void zmqShmRing_commit(zmqShmRing* ring)
+{
+   ring->mSeq++;
+   ring->mPos = ring->mNextPos;
+   __atomic_store_n(&ring->mHeader->mWritten, ring->mPos, __ATOMIC_RELEASE);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// returns non-zero if anything from pos onwards may have been overwritten
+static int zmqShmRing_isOverwritten(zmqShmRing* ring, uint64_t pos)
+{
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   uint64_t reserved = __atomic_load_n(&ring->mHeader->mReserved, __ATOMIC_RELAXED);
+   return (reserved - pos > ring->mSize);
+}
+
+
+const void* zmqShmRing_peek(zmqShmRing* ring, size_t* size)
+{
+   if (ring->mHeader == NULL) {
+      if ((getMillis() - ring->mLastAttach < SHM_ATTACH_MILLIS) || (zmqShmRing_attach(ring) != 0)) {
+         return NULL;
+      }
+   }
+
+   while (1) {
+      uint64_t written = __atomic_load_n(&ring->mHeader->mWritten, __ATOMIC_ACQUIRE);
+      if (ring->mPos == written) {
+         if (__atomic_load_n(&ring->mHeader->mIsClosed, __ATOMIC_ACQUIRE) != 0) {
+            // writer has gone away -- look for a new one
+            MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Detached from closed shm ring %s", ring->mName);
+            zmqShmRing_detach(ring);
+         }
+         return NULL;
+      }
+
+      if (written - ring->mPos > ring->mSize) {
+         // lapped by the writer -- skip ahead (the msgs lost are counted once the next one is read)
+         ring->mPos = written;
+         continue;
+      }
+
+      uint64_t offset = ring->mPos & (ring->mSize - 1);
+      zmqShmRecord record;
+      memcpy(&record, ring->mData + offset, sizeof(record));
+      uint64_t need = (sizeof(zmqShmRecord) + record.mSize + SHM_RING_ALIGN - 1) & ~((uint64_t) SHM_RING_ALIGN - 1);
+      if ((record.mSize == 0) || (offset + need > ring->mSize)) {
+         // padding at end of ring (or a record that has been overwritten since we checked)
+         uint64_t next = ring->mPos + (ring->mSize - offset);
+         ring->mPos = zmqShmRing_isOverwritten(ring, ring->mPos) ? written : next;
+         continue;
+      }
+
+      ring->mNextPos = ring->mPos + need;
+      ring->mNextSeq = record.mSeq;
+      *size = record.mSize;
+      return ring->mData + offset + sizeof(zmqShmRecord);
+   }
+}
+
+
+int zmqShmRing_release(zmqShmRing* ring)
+{
+   if (zmqShmRing_isOverwritten(ring, ring->mPos)) {
+      ring->mPos = __atomic_load_n(&ring->mHeader->mWritten, __ATOMIC_ACQUIRE);
+      return 0;
+   }
+
+   if ((ring->mHasSeq == 1) && (ring->mNextSeq != ring->mSeq)) {
+      ring->mLost += (uint32_t) (ring->mNextSeq - ring->mSeq);
+   }
+   ring->mHasSeq = 1;
+   ring->mSeq = ring->mNextSeq + 1;
+   ring->mPos = ring->mNextPos;
+
+   return 1;
+}
+
+
+uint64_t zmqShmRing_getLost(zmqShmRing* ring)
+{
+   return ring->mLost;
+}
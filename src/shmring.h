@@ -0,0 +1,42 @@
+#ifndef OPENMAMA_ZMQ_SHMRING_H
+#define OPENMAMA_ZMQ_SHMRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Broadcast ring in a shared memory segment, for msgs between processes on the same host ("shm://name" endpoints).
+// There is a single writer, and any number of readers, each of which keeps its own position in the ring.  The writer
+// never waits for readers -- a reader that falls more than a ring behind loses msgs, which it can detect (see
+// zmqShmRing_getLost).  Neither reading nor writing makes any syscalls.
+// A ring object is used either for writing or for reading, from one thread at a time.
+typedef struct zmqShmRing_ zmqShmRing;
+
+// creates the ring for writing (replacing any existing ring w/the same name) -- size is rounded up to a power of 2,
+// and mode is the permissions of the shm object (e.g., 0600, or 0640 to share w/readers in the same group)
+zmqShmRing* zmqShmRing_create(const char* name, size_t size, int mode);
+// opens the ring for reading -- the ring doesn't need to exist yet, it is attached to (from zmqShmRing_peek) once
+// it does
+zmqShmRing* zmqShmRing_open(const char* name);
+// the writer marks the ring as closed and removes it
+void zmqShmRing_destroy(zmqShmRing* ring);
+
+// removes rings named <prefix><pid>.<anything> whose writer (pid) no longer exists, i.e. rings left behind by
+// writers that crashed (Linux only, where shm objects are visible in /dev/shm)
+void zmqShmRing_cleanup(const char* prefix);
+
+const char* zmqShmRing_getName(zmqShmRing* ring);
+
+// writer: returns space for a msg of size bytes, which is visible to readers once zmqShmRing_commit is called, or
+// NULL if the msg is too big for the ring
+void* zmqShmRing_reserve(zmqShmRing* ring, size_t size);
+void zmqShmRing_commit(zmqShmRing* ring);
+
+// reader: returns the next msg (in place, in the ring) or NULL if there is none.  The msg can be overwritten by the
+// writer at any time, so it must be copied out, and the copy only used if zmqShmRing_release returns non-zero.
+const void* zmqShmRing_peek(zmqShmRing* ring, size_t* size);
+int zmqShmRing_release(zmqShmRing* ring);
+
+// reader: number of msgs lost because reader fell behind
+uint64_t zmqShmRing_getLost(zmqShmRing* ring);
+
+#endif
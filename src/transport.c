@@ -33,6 +33,11 @@
 // system includes
 #include <stdio.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <ifaddrs.h>
 
 // MAMA includes
 #include <mama/mama.h>
@@ -55,9 +60,14 @@
 #include "util.h"
 #include "inbox.h"
 #include "params.h"
+#include "sender.h"
+#include "naming.h"
+#include "peercache.h"
 
 #include "transport.h"
 
+extern timerHeap gOmzmqTimerHeap;
+
 ///////////////////////////////////////////////////////////////////////////////
 // following functions are defined in the Mama API
 int zmqBridgeMamaTransport_isValid(transportBridge transport)
@@ -91,14 +101,34 @@ mama_status zmqBridgeMamaTransport_create(transportBridge* result, const char* n
    impl->mName                 = name;
 
    wsem_init(&impl->mIsReady, 0, 0);
+   wsem_init(&impl->mNamingConnectedSem, 0, 0);
 
    // initialize counters
    impl->mNamingMessages       = 0;
+   impl->mNamingFailovers      = 0;
+   impl->mNamingHeartbeatInterval = ZMQ_NAMING_HEARTBEAT_MILLIS;
    impl->mNormalMessages       = 0;
    impl->mSubMessages          = 0;
    impl->mInboxMessages        = 0;
    impl->mControlMessages      = 0;
    impl->mPolls                = 0;
+   impl->mCompressedMessages   = 0;
+   impl->mDeltaMessages        = 0;
+   impl->mDeltaDropped         = 0;
+   impl->mAliasDropped         = 0;
+   impl->mSendErrors           = 0;
+   impl->mSendRingFull         = 0;
+   impl->mInterestSkipped      = 0;
+   impl->mRateQueued           = 0;
+   impl->mRateConflated        = 0;
+   impl->mRateRejected         = 0;
+   impl->mSlowConsumers        = 0;
+   impl->mSlowConsumersEvicted = 0;
+   impl->mShmMessages          = 0;
+   impl->mShmTooBig            = 0;
+   impl->mShmLost              = 0;
+   impl->mRadioMessages        = 0;
+   impl->mRadioLost            = 0;
 
    {
    // init logging
@@ -140,6 +170,85 @@ mama_status zmqBridgeMamaTransport_create(transportBridge* result, const char* n
       return MAMA_STATUS_NOMEM;
    }
 
+   // create pool of send buffers
+   impl->mSendPool = zmqBufferPool_create(impl->mSendPoolSize);
+   if (impl->mSendPool == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create send buffer pool");
+      free(impl);
+      return MAMA_STATUS_NOMEM;
+   }
+
+   // create table of incoming delta streams
+   impl->mDeltaStreams = wtable_create("deltaStreams", DELTA_TABLE_SIZE);
+   if (impl->mDeltaStreams == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create delta streams table");
+      free(impl);
+      return MAMA_STATUS_NOMEM;
+   }
+
+   // create tables of outgoing and incoming topic aliases
+   impl->mAliases = wtable_create("aliases", ALIAS_TABLE_SIZE);
+   impl->mAliasTables = wtable_create("aliasTables", ALIAS_TABLE_SIZE);
+   if ((impl->mAliases == NULL) || (impl->mAliasTables == NULL)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create alias tables");
+      free(impl);
+      return MAMA_STATUS_NOMEM;
+   }
+   impl->mAliasesLock = wlock_create();
+   __sync_and_and_fetch(&impl->mAliasUid, 0);
+
+   // rate limiting
+   zmqBridgeMamaTransportImpl_startRateLimit(impl);
+
+   // create table of subscriber interest
+   impl->mInterestTable = wtable_create("interest", INTEREST_TABLE_SIZE);
+   if (impl->mInterestTable == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create interest table");
+      free(impl);
+      return MAMA_STATUS_NOMEM;
+   }
+   impl->mInterestLock = wlock_create();
+   impl->mInterestAll = 0;
+   __sync_and_and_fetch(&impl->mInterestGen, 0);
+
+   // create table of peers connected to data pub socket
+   impl->mConsumers = wtable_create("consumers", CONSUMER_TABLE_SIZE);
+   if (impl->mConsumers == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create consumers table");
+      free(impl);
+      return MAMA_STATUS_NOMEM;
+   }
+   impl->mConsumersLock = wlock_create();
+   impl->mCheckConsumers = 0;
+
+   impl->mPublishLock = wlock_create();
+   impl->mPublishTimer = NULL;
+   impl->mPublishRetries = 0;
+   impl->mPublishStopping = 0;
+
+   // create tables of peers/topics, for partitions and topic filters
+   impl->mPartitionPeers = wtable_create("partitionPeers", PARTITION_TABLE_SIZE);
+   impl->mIdlePeers = wtable_create("idlePeers", PEER_TABLE_SIZE);
+   impl->mCachedPeers = wtable_create("cachedPeers", PEER_TABLE_SIZE);
+   impl->mSubTopics = wtable_create("subTopics", TOPIC_TABLE_SIZE);
+   impl->mPubNamespaces = wtable_create("pubNamespaces", TOPIC_TABLE_SIZE);
+   if ((impl->mPartitionPeers == NULL) || (impl->mIdlePeers == NULL) || (impl->mCachedPeers == NULL) || (impl->mSubTopics == NULL) || (impl->mPubNamespaces == NULL)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create peer/topic tables");
+      free(impl);
+      return MAMA_STATUS_NOMEM;
+   }
+   impl->mPubNamespacesLock = wlock_create();
+
+   // create radio tables
+   impl->mRadioSendSeqs = wtable_create("radioSendSeqs", RADIO_TABLE_SIZE);
+   impl->mRadioRecvSeqs = wtable_create("radioRecvSeqs", RADIO_TABLE_SIZE);
+   impl->mRadioGroups = wtable_create("radioGroups", RADIO_TABLE_SIZE);
+   if ((impl->mRadioSendSeqs == NULL) || (impl->mRadioRecvSeqs == NULL) || (impl->mRadioGroups == NULL)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create radio tables");
+      free(impl);
+      return MAMA_STATUS_NOMEM;
+   }
+
    // create inboxes
    impl->mInboxes = wtable_create("inboxes", INBOX_TABLE_SIZE);
    if (impl->mInboxes == NULL) {
@@ -171,6 +280,11 @@ mama_status zmqBridgeMamaTransport_create(transportBridge* result, const char* n
    sprintf(temp, "%s.%s", ZMQ_REPLYHANDLE_PREFIX, impl->mUuid);
    impl->mInboxSubject = strdup(temp);
 
+   // aliases defined by this transport are tagged w/a hash of its uuid
+   sprintf(impl->mAliasTag, "%08x", zmqBridge_hashString(impl->mUuid));
+   // as are msgs it sends on the radio socket
+   impl->mRadioTag = zmqBridge_hashString(impl->mUuid);
+
    wInterlocked_initialize(&impl->mNamingConnected);
 
    // connect/bind/subscribe/etc. all sockets
@@ -201,19 +315,24 @@ mama_status zmqBridgeMamaTransport_destroy(transportBridge transport)
    status = zmqBridgeMamaTransportImpl_stop(impl);
    wsem_destroy(&impl->mIsReady);
 
-   // TODO: is this good enough?
-   // make sure we don't delete the transport out from under publishEndpoints, if it's running
-   if ((impl->mIsNaming == 1) && (wInterlocked_read(&impl->mNamingConnected) == 0)) {
-      // this can only be true if publishEndpoints is running in a separate thread(s)
-      // if so, give the thread a chance to terminate
-      usleep(impl->mNamingConnectInterval * 2);
-   }
-
    wInterlocked_destroy(&impl->mNamingConnected);
+   wsem_destroy(&impl->mNamingConnectedSem);
+
+   // close shm rings
+   zmqBridgeMamaTransportImpl_closeShmRings(impl);
 
    // close sockets
+   if (impl->mZmqRadio.mSocket != NULL) {
+      zmqBridgeMamaTransportImpl_destroySocket(&impl->mZmqRadio);
+   }
+   if (impl->mZmqDish.mSocket != NULL) {
+      zmqBridgeMamaTransportImpl_destroySocket(&impl->mZmqDish);
+   }
    zmqBridgeMamaTransportImpl_destroySocket(&impl->mZmqDataSub);
    zmqBridgeMamaTransportImpl_destroySocket(&impl->mZmqDataPub);
+   for (int i = 1; i < impl->mPartitions; ++i) {
+      zmqBridgeMamaTransportImpl_destroySocket(&impl->mZmqPartitionPub[i -1]);
+   }
    zmqBridgeMamaTransportImpl_destroySocket(&impl->mZmqControlSub);
    zmqBridgeMamaTransportImpl_destroySocket(&impl->mZmqControlPub);
    if (impl->mIsNaming == 1) {
@@ -230,7 +349,11 @@ mama_status zmqBridgeMamaTransport_destroy(transportBridge transport)
    zmq_ctx_shutdown(impl->mZmqContext);
    zmq_ctx_term(impl->mZmqContext);
 
-   // free memory
+   // free memory (send buffers are returned to the pool when zmq closes the msgs, so this must
+   // come after zmq_ctx_term)
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Send buffer allocations = %ld", zmqBufferPool_getHeapAllocs(impl->mSendPool));
+   zmqBufferPool_destroy(impl->mSendPool);
+
    wlock_destroy(impl->mSubsLock);
    endpointPool_destroy(impl->mSubEndpoints);
 
@@ -242,23 +365,96 @@ mama_status zmqBridgeMamaTransport_destroy(transportBridge transport)
 
    free((void*) impl->mUuid);
    free((void*) impl->mInboxSubject);
-   free((void*) impl->mPubEndpoint);
+   for (int i = 0; (i < ZMQ_MAX_PUBLISH_ADDRESSES); ++i) {
+      free((void*) impl->mPubEndpoint[i]);
+   }
+   for (int i = 0; (i < ZMQ_MAX_PARTITIONS -1); ++i) {
+      free((void*) impl->mPartitionEndpoint[i]);
+   }
+   free((void*) impl->mLoopbackEndpoint);
+   free((void*) impl->mIpcEndpoint);
+   free((void*) impl->mShmEndpoint);
 
    for (int i = 0; (i < ZMQ_MAX_NAMING_URIS); ++i) {
       free((void*) impl->mNamingAddress[i]);
    }
+   free((void*) impl->mNamingProxyEndpoint);
+
+   if (impl->mPeerCache != NULL) {
+      int saved = zmqPeerCache_save(impl->mPeerCache, impl->mPeers, impl->mUuid);
+      MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Saved %d peers to cache %s", saved, impl->mPeerCache);
+   }
 
    uint32_t peers = wtable_get_count(impl->mPeers);
    MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Peers = %lu", peers);
    wtable_free_all(impl->mPeers);
    wtable_destroy(impl->mPeers);
 
+   wtable_for_each(impl->mDeltaStreams, zmqBridgeMamaTransportImpl_destroyDeltaStream, NULL);
+   wtable_destroy(impl->mDeltaStreams);
+   free(impl->mDeltaBuffer);
+
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Topic aliases = %lu", wtable_get_count(impl->mAliases));
+   wlock_destroy(impl->mAliasesLock);
+   wtable_free_all(impl->mAliases);
+   wtable_destroy(impl->mAliases);
+   wtable_for_each(impl->mAliasTables, zmqBridgeMamaTransportImpl_destroyAliasTable, NULL);
+   wtable_destroy(impl->mAliasTables);
+
+   wlock_destroy(impl->mInterestLock);
+   wtable_destroy(impl->mInterestTable);
+
+   wlock_destroy(impl->mRateLock);
+   wsem_destroy(&impl->mRateTimerSem);
+   wsem_destroy(&impl->mSendRingUsersSem);
+
+   wlock_destroy(impl->mPublishLock);
+
+   wlock_destroy(impl->mConsumersLock);
+   wtable_free_all(impl->mConsumers);
+   wtable_destroy(impl->mConsumers);
+
+   wtable_free_all(impl->mPartitionPeers);
+   wtable_destroy(impl->mPartitionPeers);
+   wtable_destroy(impl->mIdlePeers);                     // entries are owned by mPeers
+   wtable_destroy(impl->mCachedPeers);                   // entries are owned by mPeers
+   wtable_free_all(impl->mSubTopics);
+   wtable_destroy(impl->mSubTopics);
+   wlock_destroy(impl->mPubNamespacesLock);
+   wtable_free_all(impl->mPubNamespaces);
+   wtable_destroy(impl->mPubNamespaces);
+
+   wtable_free_all(impl->mRadioSendSeqs);
+   wtable_destroy(impl->mRadioSendSeqs);
+   wtable_free_all(impl->mRadioRecvSeqs);
+   wtable_destroy(impl->mRadioRecvSeqs);
+   wtable_free_all(impl->mRadioGroups);
+   wtable_destroy(impl->mRadioGroups);
+
    MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Naming messages = %ld", impl->mNamingMessages);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Naming failovers = %ld", impl->mNamingFailovers);
    MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Normal messages = %ld", impl->mNormalMessages);
    MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Subscription messages = %ld", impl->mSubMessages);
    MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Inbox messages = %ld", impl->mInboxMessages);
    MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Control messages = %ld", impl->mControlMessages);
    MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Polls = %ld", impl->mPolls);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Compressed messages = %ld", impl->mCompressedMessages);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Delta messages = %ld", impl->mDeltaMessages);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Delta messages dropped = %ld", impl->mDeltaDropped);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Unknown alias messages dropped = %ld", impl->mAliasDropped);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Sender thread send errors = %ld", impl->mSendErrors);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Send ring full = %ld", impl->mSendRingFull);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Uninteresting messages skipped = %ld", impl->mInterestSkipped);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Rate limited messages queued = %ld", impl->mRateQueued);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Rate limited messages conflated = %ld", impl->mRateConflated);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Rate limited messages rejected = %ld", impl->mRateRejected);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Slow consumers = %ld", impl->mSlowConsumers);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Slow consumers evicted = %ld", impl->mSlowConsumersEvicted);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Shm ring messages = %ld", impl->mShmMessages);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Shm ring messages too big = %ld", impl->mShmTooBig);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Shm ring messages lost = %ld", impl->mShmLost);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Radio messages = %ld", impl->mRadioMessages);
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Radio messages lost = %ld", impl->mRadioLost);
 
    free(impl);
 
@@ -279,6 +475,52 @@ mama_status zmqBridgeMamaTransport_getNativeTransport(transportBridge transport,
 }
 
 
+// callback is invoked on the transport's dispatch thread when peers subscribe to (isInterested=1) or unsubscribe
+// from (isInterested=0) a topic prefix (requires interest=1)
+mama_status zmqBridgeMamaTransport_setInterestCallback(transportBridge transport, zmqBridgeInterestCallback callback, void* closure)
+{
+   if (NULL == transport) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+   zmqTransportBridge* impl = (zmqTransportBridge*)transport;
+   if (impl->mInterest == 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Interest callback will not be called, since interest tracking is disabled for transport %s", impl->mName);
+   }
+
+   impl->mInterestClosure = closure;
+   impl->mInterestCallback = callback;
+
+   return MAMA_STATUS_OK;
+}
+
+
+// closes the connection from a peer (identified by the address and port of its end of the connection) to the data pub
+// socket on any of the transports (requires socket_monitor, to track connections)
+mama_status zmqBridgeMamaTransport_forceClientDisconnect(transportBridge*   transports,
+                                             int                numTransports,
+                                             const char*        ipAddress,
+                                             uint16_t           port)
+{
+   if ((NULL == transports) || (NULL == ipAddress)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   char endpoint[ZMQ_MAX_ENDPOINT_LENGTH +1];
+   snprintf(endpoint, sizeof(endpoint), "tcp://%s:%u", ipAddress, port);
+
+   mama_status status = MAMA_STATUS_NOT_FOUND;
+   for (int i = 0; i < numTransports; ++i) {
+      zmqTransportBridge* impl = (zmqTransportBridge*) transports[i];
+      if ((impl != NULL) && (zmqBridgeMamaTransportImpl_disconnectConsumer(impl, endpoint) == MAMA_STATUS_OK)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Disconnected client %s from transport %s", endpoint, impl->mName);
+         status = MAMA_STATUS_OK;
+      }
+   }
+
+   return status;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 zmqTransportBridge* zmqBridgeMamaTransportImpl_getTransportBridge(mamaTransport transport)
 {
@@ -307,6 +549,10 @@ mama_status zmqBridgeMamaTransportImpl_init(zmqTransportBridge* impl)
       MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unable to allocate zmq context - error %d(%s)", errno, zmq_strerror(errno));
       return MAMA_STATUS_PLATFORM;
    }
+   // each partition gets its own io thread (see ZMQ_AFFINITY below)
+   if (impl->mPartitions > 1) {
+      CALL_ZMQ_FUNC(zmq_ctx_set(impl->mZmqContext, ZMQ_IO_THREADS, impl->mPartitions));
+   }
 
    // create control sockets for inter-thread commands
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqControlSub, ZMQ_PULL, "controlSub", 0));
@@ -315,12 +561,30 @@ mama_status zmqBridgeMamaTransportImpl_init(zmqTransportBridge* impl)
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqControlPub,  ZMQ_CONTROL_ENDPOINT, 0, 0));
 
    // create data sockets
-   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqDataPub, ZMQ_PUB_TYPE, "dataPub", impl->mSocketMonitor));
+   // tracking interest requires XPUB, so we can see subscriptions
+   // data pub socket is monitored w/v2 events, if available, to track connected peers
+   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqDataPub, (impl->mInterest == 1) ? ZMQ_XPUB : ZMQ_PUB_TYPE, "dataPub",
+      (impl->mSocketMonitor != 0) ? ZMQ_MONITOR_PEERS : 0));
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqDataSub, ZMQ_SUB_TYPE, "dataSub", impl->mSocketMonitor));
    // set socket options as per mama.properties etc.
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_setCommonSocketOptions(impl->mName, &impl->mZmqDataPub));
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_setCommonSocketOptions(impl->mName, &impl->mZmqDataSub));
 
+   // create data pub sockets for partitions 1..n-1 (partition 0 is the data pub socket itself)
+   for (int i = 0; i < impl->mPartitions; ++i) {
+      zmqSocket* socket = (i == 0) ? &impl->mZmqDataPub : &impl->mZmqPartitionPub[i -1];
+      if (i > 0) {
+         char socketName[32];
+         sprintf(socketName, "dataPub.%d", i);
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, socket, ZMQ_PUB_TYPE, socketName, impl->mSocketMonitor));
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_setCommonSocketOptions(impl->mName, socket));
+      }
+      if (impl->mPartitions > 1) {
+         uint64_t affinity = 1ULL << i;
+         CALL_ZMQ_FUNC(zmq_setsockopt(socket->mSocket, ZMQ_AFFINITY, &affinity, sizeof(affinity)));
+      }
+   }
+
    // subscribe to inbox subjects
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_subscribe(impl->mZmqDataSub.mSocket, impl->mInboxSubject));
 
@@ -342,15 +606,64 @@ mama_status zmqBridgeMamaTransportImpl_init(zmqTransportBridge* impl)
    }
 
    if (impl->mIsNaming == 1) {
-      // bind data pub socket & get endpoint
+      // bind data pub socket & get endpoint(s) -- one per publish address, so peers can spread their connections
+      // across interfaces (see getPeerEndpoint)
       char endpointAddress[ZMQ_MAX_ENDPOINT_LENGTH +1];
-      sprintf(endpointAddress, "tcp://%s:*", impl->mPublishAddress);
-      CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_bindSocket(&impl->mZmqDataPub,  endpointAddress, &impl->mPubEndpoint,
-         impl->mNamingReconnect, impl->mNamingReconnectInterval));
-      MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Bound publish socket to:%s ", impl->mPubEndpoint);
+      for (int i = 0; (i < ZMQ_MAX_PUBLISH_ADDRESSES) && (impl->mPublishAddress[i] != NULL); ++i) {
+         sprintf(endpointAddress, "tcp://%s:*", impl->mPublishAddress[i]);
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_bindSocket(&impl->mZmqDataPub,  endpointAddress, &impl->mPubEndpoint[i],
+            impl->mNamingReconnect, impl->mNamingReconnectInterval));
+         MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Bound publish socket to:%s ", impl->mPubEndpoint[i]);
+      }
+      zmqBridgeMamaTransportImpl_getLocalNets(impl);
+
+      // partitions are bound on the first publish address only
+      for (int i = 1; i < impl->mPartitions; ++i) {
+         sprintf(endpointAddress, "tcp://%s:*", impl->mPublishAddress[0]);
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_bindSocket(&impl->mZmqPartitionPub[i -1],  endpointAddress, &impl->mPartitionEndpoint[i -1],
+            impl->mNamingReconnect, impl->mNamingReconnectInterval));
+         MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Bound publish socket partition %d to:%s ", i, impl->mPartitionEndpoint[i -1]);
+      }
+
+      // peers on the same host connect over ipc (see getPeerEndpoint) -- not fatal if that fails, since they can
+      // always use tcp
+      if (impl->mNamingIpc == 1) {
+         if (zmqBridgeMamaTransportImpl_bindSocket(&impl->mZmqDataPub, "ipc://*", &impl->mIpcEndpoint, 0, 0) == MAMA_STATUS_OK) {
+            MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Bound publish socket to:%s ", impl->mIpcEndpoint);
+         }
+         else {
+            MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Failed to bind publish socket to ipc endpoint -- peers on this host will use tcp");
+         }
+      }
+
+      // peers on the same host read msgs from our shm ring (see getPeerEndpoint) -- the ring is named for our pid, so
+      // that rings left behind by processes that crashed can be removed
+      if (impl->mNamingShm == 1) {
+         zmqShmRing_cleanup(ZMQ_SHM_NAMING_PREFIX);
+         sprintf(endpointAddress, "%s%s%ld.%s", ZMQ_SHM_PREFIX, ZMQ_SHM_NAMING_PREFIX, (long) getpid(), impl->mUuid);
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_openShmRing(impl, endpointAddress, ZMQ_TPORT_DIRECTION_OUTGOING));
+         impl->mShmEndpoint = strdup(endpointAddress);
+      }
+
+      // msgs from this transport to its own subscribers go over inproc (see getPeerEndpoint) -- remote peers see
+      // exactly the same msgs as before
+      if (impl->mNamingLoopback == 1) {
+         sprintf(endpointAddress, "inproc://loopback.%s", impl->mUuid);
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_bindSocket(&impl->mZmqDataPub, endpointAddress, NULL, 0, 0));
+         impl->mLoopbackEndpoint = strdup(endpointAddress);
+         MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Bound publish socket to:%s ", impl->mLoopbackEndpoint);
+      }
 
-      // connect sub socket to proxy
-      for (int i = 0; (i < ZMQ_MAX_NAMING_URIS) && (impl->mNamingAddress[i] != NULL); ++i) {
+      // connect sub socket to proxy -- w/failover, just the first one (see checkNamingFailover)
+      if (impl->mNamingFailover == 1) {
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_subscribe(impl->mZmqNamingSub.mSocket, ZMQ_NAMING_HEARTBEAT_TOPIC));
+         impl->mNamingActive = 0;
+         impl->mNamingLastHeard = getMillis();
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqNamingSub, impl->mNamingAddress[0],
+            impl->mNamingReconnect, impl->mNamingReconnectInterval));
+         MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Connecting naming subscriber to: %s", impl->mNamingAddress[0]);
+      }
+      for (int i = 0; (impl->mNamingFailover != 1) && (i < ZMQ_MAX_NAMING_URIS) && (impl->mNamingAddress[i] != NULL); ++i) {
          CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqNamingSub, impl->mNamingAddress[i],
             impl->mNamingReconnect, impl->mNamingReconnectInterval));
          MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Connecting naming subscriber to: %s", impl->mNamingAddress[i]);
@@ -359,6 +672,14 @@ mama_status zmqBridgeMamaTransportImpl_init(zmqTransportBridge* impl)
    else {
       // non-naming style
       for (int i = 0; (i < ZMQ_MAX_OUTGOING_URIS) && (NULL != impl->mOutgoingAddress[i]); i++) {
+         if (zmqBridgeMamaTransportImpl_isShmEndpoint(impl->mOutgoingAddress[i])) {
+            CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_openShmRing(impl, impl->mOutgoingAddress[i], ZMQ_TPORT_DIRECTION_OUTGOING));
+            continue;
+         }
+         if (zmqBridgeMamaTransportImpl_isRadioEndpoint(impl->mOutgoingAddress[i])) {
+            CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_openRadio(impl, impl->mOutgoingAddress[i], ZMQ_TPORT_DIRECTION_OUTGOING));
+            continue;
+         }
          CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_bindOrConnect(&impl->mZmqDataPub,
          impl->mOutgoingAddress[i], ZMQ_TPORT_DIRECTION_OUTGOING,
          impl->mDataReconnect, impl->mDataReconnectInterval));
@@ -367,6 +688,14 @@ mama_status zmqBridgeMamaTransportImpl_init(zmqTransportBridge* impl)
       }
 
       for (int i = 0; (i < ZMQ_MAX_INCOMING_URIS) && (NULL != impl->mIncomingAddress[i]); i++) {
+         if (zmqBridgeMamaTransportImpl_isShmEndpoint(impl->mIncomingAddress[i])) {
+            CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_openShmRing(impl, impl->mIncomingAddress[i], ZMQ_TPORT_DIRECTION_INCOMING));
+            continue;
+         }
+         if (zmqBridgeMamaTransportImpl_isRadioEndpoint(impl->mIncomingAddress[i])) {
+            CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_openRadio(impl, impl->mIncomingAddress[i], ZMQ_TPORT_DIRECTION_INCOMING));
+            continue;
+         }
          CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_bindOrConnect(&impl->mZmqDataSub,
             impl->mIncomingAddress[i], ZMQ_TPORT_DIRECTION_INCOMING,
             impl->mDataReconnect, impl->mDataReconnectInterval));
@@ -381,6 +710,12 @@ mama_status zmqBridgeMamaTransportImpl_init(zmqTransportBridge* impl)
 // starts the main dispatch thread
 mama_status zmqBridgeMamaTransportImpl_start(zmqTransportBridge* impl)
 {
+   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_startSender(impl));
+
+   wlock_lock(impl->mConsumersLock);
+   impl->mCheckConsumers = 1;
+   wlock_unlock(impl->mConsumersLock);
+
    /* Initialize dispatch thread */
    int rc = wthread_create(&(impl->mOmzmqDispatchThread), NULL, zmqBridgeMamaTransportImpl_dispatchThread, impl);
    if (0 != rc) {
@@ -391,10 +726,16 @@ mama_status zmqBridgeMamaTransportImpl_start(zmqTransportBridge* impl)
    // dont proceed until we are connected to proxy?
    if ( (impl->mIsNaming == 1) && (impl->mNamingWaitForConnect == 1) ) {
       // wait for welcome msg from proxy to trigger publishEndpoints, which in turn
-      // causes mNamingConnected to be set on receipt of our naming msg
-      int retries = impl->mNamingConnectRetries;
-      while ((--retries > 0) && (wInterlocked_read(&impl->mNamingConnected) != 1)) {
-         usleep(impl->mNamingConnectInterval);
+      // causes mNamingConnectedSem to be posted on receipt of our naming msg -- a welcome from another nsd starts
+      // over (resetting mNamingConnected), so keep waiting until the deadline rather than giving up after one post
+      uint64_t timeout = ((uint64_t) impl->mNamingConnectRetries * impl->mNamingConnectInterval) / 1000;   // millis
+      uint64_t deadline = getMillis() + timeout;
+      while (wInterlocked_read(&impl->mNamingConnected) != 1) {
+         uint64_t now = getMillis();
+         if (now >= deadline) {
+            break;
+         }
+         wsem_timedwait(&impl->mNamingConnectedSem, (unsigned int) (deadline - now));
       }
       if (wInterlocked_read(&impl->mNamingConnected) != 1) {
          MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "Failed connecting to naming service after %d retries", impl->mNamingConnectRetries);
@@ -415,6 +756,26 @@ mama_status zmqBridgeMamaTransportImpl_stop(zmqTransportBridge* impl)
    // (prevents a race condition on mIsDispatching)
    wsem_wait(&impl->mIsReady);
 
+   // stop monitor thread checking for slow consumers (data pub socket is about to go away)
+   wlock_lock(impl->mConsumersLock);
+   impl->mCheckConsumers = 0;
+   wlock_unlock(impl->mConsumersLock);
+
+   // stop re-sending endpoint msg -- a scheduled re-send can't be cancelled safely (its callback may already be
+   // waiting for the lock), so wait for it to run, which it does within mNamingConnectInterval
+   wlock_lock(impl->mPublishLock);
+   impl->mPublishStopping = 1;
+   while (impl->mPublishTimer != NULL) {
+      wlock_unlock(impl->mPublishLock);
+      usleep(1000);
+      wlock_lock(impl->mPublishLock);
+   }
+   wlock_unlock(impl->mPublishLock);
+
+   // flush any queued msgs
+   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_stopRateLimit(impl));
+   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_stopSender(impl));
+
    // send disconnect msg to peers
    if (impl->mIsNaming == 1) {
       CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_sendEndpointsMsg(impl, 'D'));
@@ -464,6 +825,20 @@ void* zmqBridgeMamaTransportImpl_dispatchThread(void* closure)
       wlock_lock(impl->mZmqNamingSub.mLock);
    }
 
+   // connect to peers from the cache right away, rather than waiting to hear from them over naming
+   uint64_t peerCacheDeadline = 0;
+   uint64_t nextPeerCacheSave = 0;
+   if ((impl->mIsNaming == 1) && (impl->mPeerCache != NULL)) {
+      int loaded = zmqPeerCache_load(impl->mPeerCache, impl->mPeerCacheMaxAge, zmqBridgeMamaTransportImpl_addCachedPeer, impl);
+      if (loaded > 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Connected to %lu of %d peers from cache %s", (unsigned long) wtable_get_count(impl->mCachedPeers), loaded, impl->mPeerCache);
+         peerCacheDeadline = getMillis() + impl->mPeerCacheTimeout;
+      }
+      if (impl->mPeerCacheInterval > 0) {
+         nextPeerCacheSave = getMillis() + impl->mPeerCacheInterval;
+      }
+   }
+
    // set next beacon time
    uint64_t lastBeacon = 0;
    uint64_t nextBeacon = -1;
@@ -473,14 +848,43 @@ void* zmqBridgeMamaTransportImpl_dispatchThread(void* closure)
 
    // The naming socket is defined last so it can be excluded from the list if we're not running a
    // "naming" transport.
+   // If we're tracking interest, the data pub socket's fd is polled after that (the socket itself can't be polled
+   // directly, since it is also used by publishing threads), followed by the dish socket, if there is one.
    #define CONTROL_SOCKET  0
    #define NAMING_SOCKET   2
    #define DATA_SOCKET     1
    zmq_pollitem_t items[] = {
       { impl->mZmqControlSub.mSocket, 0, ZMQ_POLLIN , 0},
       { impl->mZmqDataSub.mSocket,    0, ZMQ_POLLIN , 0},
-      { impl->mZmqNamingSub.mSocket,  0, ZMQ_POLLIN , 0}
+      { impl->mZmqNamingSub.mSocket,  0, ZMQ_POLLIN , 0},
+      { NULL,                         0, ZMQ_POLLIN , 0},
+      { NULL,                         0, ZMQ_POLLIN , 0}
    };
+   int itemCount = (impl->mIsNaming == 1) ? 3 : 2;
+   if (impl->mInterest == 1) {
+      size_t fdSize = sizeof(items[itemCount].fd);
+      wlock_lock(impl->mZmqDataPub.mLock);
+      int rc = zmq_getsockopt(impl->mZmqDataPub.mSocket, ZMQ_FD, &items[itemCount].fd, &fdSize);
+      wlock_unlock(impl->mZmqDataPub.mLock);
+      if (rc == 0) {
+         items[itemCount++].socket = NULL;
+      }
+      else {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_getsockopt(ZMQ_FD) failed for data pub socket %d(%s)", zmq_errno(), zmq_strerror(zmq_errno()));
+      }
+   }
+   int radioItem = -1;
+   if (impl->mZmqDish.mSocket != NULL) {
+      radioItem = itemCount;
+      items[itemCount++].socket = impl->mZmqDish.mSocket;
+   }
+
+   int shmMore = 0;
+   uint64_t nextDeltaPrune = getMillis() + ZMQ_DELTA_IDLE_MILLIS;
+   uint64_t nextAliasRefresh = 0;
+   if ((impl->mTopicAlias == 1) && (impl->mAliasRefreshInterval > 0)) {
+      nextAliasRefresh = getMillis() + impl->mAliasRefreshInterval;
+   }
 
    // Following is the transport's main dispatch loop -- it runs "forever"
    // i.e., until mIsDispatching is set to zero, in dispatchControlMsg, on receipt of an exit ("X") command.
@@ -491,7 +895,31 @@ void* zmqBridgeMamaTransportImpl_dispatchThread(void* closure)
       if (wInterlocked_read(&impl->mBeaconInterval) > 0) {
          timeout = nextBeacon - lastBeacon;
       }
-      int rc = zmq_poll(items, (impl->mIsNaming == 1) ? 3 : 2, timeout);
+      // The fd only signals edge-triggered, and publishing threads can consume the signal, so subscription msgs
+      // are also checked for periodically.
+      if ((impl->mInterest == 1) && ((timeout < 0) || (timeout > ZMQ_INTEREST_POLL_MILLIS))) {
+         timeout = ZMQ_INTEREST_POLL_MILLIS;
+      }
+      if (((peerCacheDeadline > 0) || (nextPeerCacheSave > 0)) && ((timeout < 0) || (timeout > ZMQ_PEER_CACHE_POLL_MILLIS))) {
+         timeout = ZMQ_PEER_CACHE_POLL_MILLIS;
+      }
+      if ((wtable_get_count(impl->mDeltaStreams) > 0) && ((timeout < 0) || (timeout > ZMQ_DELTA_IDLE_MILLIS))) {
+         timeout = ZMQ_DELTA_IDLE_MILLIS;
+      }
+      if ((nextAliasRefresh > 0) && ((timeout < 0) || (timeout > impl->mAliasRefreshInterval))) {
+         timeout = impl->mAliasRefreshInterval;
+      }
+      if ((impl->mNamingFailover == 1) && ((timeout < 0) || (timeout > impl->mNamingHeartbeatInterval))) {
+         timeout = impl->mNamingHeartbeatInterval;
+      }
+      // shm rings can't be polled, so are checked periodically (or immediately, if there's more to read)
+      if (impl->mShmReaderCount > 0) {
+         long shmTimeout = (shmMore != 0) ? 0 : impl->mShmPollInterval;
+         if ((timeout < 0) || (timeout > shmTimeout)) {
+            timeout = shmTimeout;
+         }
+      }
+      int rc = zmq_poll(items, itemCount, timeout);
       if ((rc < 0) && (errno != EINTR)) {
          MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "zmq_poll failed  %d(%s)", errno, zmq_strerror(errno));
          continue;
@@ -514,6 +942,42 @@ void* zmqBridgeMamaTransportImpl_dispatchThread(void* closure)
          }
       }
 
+      // switch to the next nsd if we haven't heard from this one
+      if (impl->mNamingFailover == 1) {
+         zmqBridgeMamaTransportImpl_checkNamingFailover(impl, getMillis());
+      }
+
+      // drop cached peers that haven't shown up over naming, and/or save the cache
+      if ((peerCacheDeadline > 0) || (nextPeerCacheSave > 0)) {
+         uint64_t now = getMillis();
+         if ((peerCacheDeadline > 0) && (now >= peerCacheDeadline)) {
+            zmqBridgeMamaTransportImpl_pruneCachedPeers(impl);
+            peerCacheDeadline = 0;
+         }
+         if ((nextPeerCacheSave > 0) && (now >= nextPeerCacheSave)) {
+            zmqPeerCache_save(impl->mPeerCache, impl->mPeers, impl->mUuid);
+            nextPeerCacheSave = now + impl->mPeerCacheInterval;
+         }
+      }
+
+      // drop incoming delta streams from publishers that have gone away
+      if (wtable_get_count(impl->mDeltaStreams) > 0) {
+         uint64_t now = getMillis();
+         if (now >= nextDeltaPrune) {
+            zmqBridgeMamaTransportImpl_pruneDeltaStreams(impl);
+            nextDeltaPrune = now + ZMQ_DELTA_IDLE_MILLIS;
+         }
+      }
+
+      // periodically re-define outgoing aliases, for subscribers whose subscriptions we don't see
+      if (nextAliasRefresh > 0) {
+         uint64_t now = getMillis();
+         if (now >= nextAliasRefresh) {
+            zmqBridgeMamaTransportImpl_refreshAliases(impl, NULL);
+            nextAliasRefresh = now + impl->mAliasRefreshInterval;
+         }
+      }
+
       // This implementation drains each of the sockets (control, naming and data) in turn before reading from
       // the next -- that is, it is not "fair", and it is theoretically possible for an earlier socket to starve
       // later socket(s).  In practice this should not be a problem, as there should be little traffic on the
@@ -535,7 +999,7 @@ void* zmqBridgeMamaTransportImpl_dispatchThread(void* closure)
       }
 
       // drain naming msgs
-      while (items[NAMING_SOCKET].revents & ZMQ_POLLIN) {
+      while ((impl->mIsNaming == 1) && (items[NAMING_SOCKET].revents & ZMQ_POLLIN)) {
          int size = zmq_msg_recv(&zmsg, impl->mZmqNamingSub.mSocket, ZMQ_DONTWAIT);
          if (size <= 0) {
             items[NAMING_SOCKET].revents = 0;
@@ -557,10 +1021,36 @@ void* zmqBridgeMamaTransportImpl_dispatchThread(void* closure)
                MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_poll returned w/ZMQ_POLLIN, but no normal msg - errorno %d(%s)", zmq_errno(), zmq_strerror(zmq_errno()));
             }
          }
-         else {
+         else if (zmqBridgeMamaTransportImpl_recvParts(impl, &zmsg) == MAMA_STATUS_OK) {
             zmqBridgeMamaTransportImpl_dispatchNormalMsg(impl, &zmsg);
          }
       }
+
+      // read radio msgs -- unlike the other sockets, this can carry a lot of traffic from many publishers, so reads
+      // are capped per poll (zmq_poll is level-triggered, so any remaining msgs are picked up on the next poll)
+      int radioMsgs = 0;
+      while ((radioItem >= 0) && (items[radioItem].revents & ZMQ_POLLIN) && (radioMsgs++ < ZMQ_RADIO_READ_BATCH)) {
+         int size = zmq_msg_recv(&zmsg, impl->mZmqDish.mSocket, ZMQ_DONTWAIT);
+         if (size < 0) {
+            items[radioItem].revents = 0;
+            if (errno != EAGAIN) {
+               MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_poll returned w/ZMQ_POLLIN, but no radio msg - errorno %d(%s)", zmq_errno(), zmq_strerror(zmq_errno()));
+            }
+         }
+         else {
+            zmqBridgeMamaTransportImpl_dispatchRadioMsg(impl, &zmsg);
+         }
+      }
+
+      // read msgs from shm rings
+      if (impl->mShmReaderCount > 0) {
+         shmMore = zmqBridgeMamaTransportImpl_readShmRings(impl);
+      }
+
+      // process subscription msgs from peers
+      if (impl->mInterest == 1) {
+         zmqBridgeMamaTransportImpl_readInterest(impl);
+      }
    }
 
    zmq_msg_close(&zmsg);
@@ -590,10 +1080,18 @@ mama_status zmqBridgeMamaTransportImpl_dispatchControlMsg(zmqTransportBridge* im
 
    if (pMsg->command == 'S') {
       // subscribe
+      if (impl->mZmqDish.mSocket != NULL) {
+         zmqBridgeMamaTransportImpl_joinRadioGroup(impl, pMsg->arg1);
+      }
+      zmqBridgeMamaTransportImpl_addSubTopic(impl, pMsg->arg1);
       return zmqBridgeMamaTransportImpl_subscribe(impl->mZmqDataSub.mSocket, pMsg->arg1);
    }
    else if (pMsg->command == 'U') {
       // unsubscribe
+      if (impl->mZmqDish.mSocket != NULL) {
+         zmqBridgeMamaTransportImpl_leaveRadioGroup(impl, pMsg->arg1);
+      }
+      zmqBridgeMamaTransportImpl_removeSubTopic(impl, pMsg->arg1);
       return zmqBridgeMamaTransportImpl_unsubscribe(impl->mZmqDataSub.mSocket, pMsg->arg1);
    }
    else if (pMsg->command == 'X') {
@@ -603,6 +1101,10 @@ mama_status zmqBridgeMamaTransportImpl_dispatchControlMsg(zmqTransportBridge* im
    else if (pMsg->command == 'N') {
       // no-op
    }
+   else if (pMsg->command == 'P') {
+      // new publisher namespace -- peers that subscribe to it may now be relevant
+      zmqBridgeMamaTransportImpl_checkIdlePeers(impl);
+   }
    else {
       MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unknown command=%c", pMsg->command);
    }
@@ -615,40 +1117,70 @@ mama_status zmqBridgeMamaTransportImpl_dispatchControlMsg(zmqTransportBridge* im
 mama_status zmqBridgeMamaTransportImpl_dispatchNamingMsg(zmqTransportBridge* impl, zmq_msg_t* zmsg)
 {
    impl->mNamingMessages++;
+   impl->mNamingLastHeard = getMillis();
+
+   // heartbeats from nsd (w/naming.failover) have done their job just by arriving
+   if ((zmq_msg_size(zmsg) >= sizeof(ZMQ_NAMING_HEARTBEAT_TOPIC))
+      && (memcmp(zmq_msg_data(zmsg), ZMQ_NAMING_HEARTBEAT_TOPIC, sizeof(ZMQ_NAMING_HEARTBEAT_TOPIC)) == 0)) {
+      return MAMA_STATUS_OK;
+   }
+
+   // msgs may be in either encoding, and msgs from older peers don't have all the fields
+   zmqNamingMsg fullMsg;
+   if (zmqNaming_decode(zmq_msg_data(zmsg), zmq_msg_size(zmsg), &fullMsg) != 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unable to decode naming msg of size %lu", (unsigned long) zmq_msg_size(zmsg));
+      return MAMA_STATUS_OK;
+   }
+
+   return zmqBridgeMamaTransportImpl_handleNamingMsg(impl, &fullMsg);
+}
 
-   zmqNamingMsg* pMsg = zmq_msg_data(zmsg);
 
+// processes a (decoded) naming msg
+mama_status zmqBridgeMamaTransportImpl_handleNamingMsg(zmqTransportBridge* impl, const zmqNamingMsg* pMsg)
+{
    MAMA_LOG(getNamingLogLevel(pMsg->mType), "Received endpoint msg: type=%c prog=%s host=%s uuid=%s pid=%ld topic=%s pub=%s", pMsg->mType, pMsg->mProgName, pMsg->mHost, pMsg->mUuid, pMsg->mPid, pMsg->mTopic, pMsg->mEndPointAddr);
 
    if ((pMsg->mType == 'C') || (pMsg->mType == 'c')) {
       // connect
 
       zmqNamingMsg* pOrigMsg = wtable_lookup(impl->mPeers, pMsg->mUuid);
+      if ((pOrigMsg != NULL) && (wtable_remove(impl->mCachedPeers, pMsg->mUuid) != NULL)) {
+         // peer from the cache (see naming.peer_cache) is still alive
+         MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Confirmed cached peer: prog=%s host=%s uuid=%s pid=%ld", pMsg->mProgName, pMsg->mHost, pMsg->mUuid, pMsg->mPid);
+      }
       if (pOrigMsg == NULL) {
          if (pMsg->mType == 'c') {
             // found peer via beacon message
             MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Received endpoint msg: type=%c prog=%s host=%s uuid=%s pid=%ld topic=%s pub=%s", pMsg->mType, pMsg->mProgName, pMsg->mHost, pMsg->mUuid, pMsg->mPid, pMsg->mTopic, pMsg->mEndPointAddr);
          }
 
-         // we've never seen this peer before, so connect (sub => pub)
-         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqDataSub, pMsg->mEndPointAddr, impl->mDataReconnect, impl->mDataReconnectInterval));
-
-         // send a discovery msg whenever we see a peer we haven't seen before
-         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_sendEndpointsMsg(impl, 'C'));
+         // we've never seen this peer before, so connect (sub => pub), unless it doesn't publish anything we want
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_addPeer(impl, pMsg));
 
-         // save peer in table
-         pOrigMsg = malloc(sizeof(zmqNamingMsg));
-         if (NULL == pOrigMsg) return MAMA_STATUS_NOMEM;
+         // send a discovery msg whenever we see a peer we haven't seen before -- unless nsd will have sent it a
+         // snapshot that includes us
+         if (impl->mNamingSnapshot != 1) {
+            CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_sendEndpointsMsg(impl, 'C'));
+         }
+      }
+      else if ((wtable_lookup(impl->mIdlePeers, pMsg->mUuid) != NULL)
+         && ((memcmp(pOrigMsg->mTopicBloom, pMsg->mTopicBloom, sizeof(pMsg->mTopicBloom)) != 0)
+            || (memcmp(pOrigMsg->mSubBloom, pMsg->mSubBloom, sizeof(pMsg->mSubBloom)) != 0)
+            || (pOrigMsg->mFlags != pMsg->mFlags))) {
+         // idle peer has advertised new topics
          memcpy(pOrigMsg, pMsg, sizeof(zmqNamingMsg));
-         wtable_insert(impl->mPeers, pOrigMsg->mUuid, pOrigMsg);
-
-         MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Connecting to publisher at endpoint:%s", pMsg->mEndPointAddr);
+         if (zmqBridgeMamaTransportImpl_isPeerRelevant(impl, pOrigMsg)) {
+            wtable_remove(impl->mIdlePeers, pOrigMsg->mUuid);
+            CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectPeer(impl, pOrigMsg));
+         }
       }
 
       // is this our msg? if so, we know we're connected to proxy
       if ((wInterlocked_read(&impl->mNamingConnected) != 1) && (strcmp(pMsg->mUuid, impl->mUuid) == 0)) {
          MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Got own endpoint msg -- signaling");
          wInterlocked_set(1, &impl->mNamingConnected);
+         wsem_post(&impl->mNamingConnectedSem);
       }
    }
    else if (pMsg->mType == 'D') {
@@ -666,6 +1198,8 @@ mama_status zmqBridgeMamaTransportImpl_dispatchNamingMsg(zmqTransportBridge* imp
       #endif
 
       // remove endpoint from the table
+      int wasIdle = (wtable_remove(impl->mIdlePeers, pMsg->mUuid) != NULL);
+      wtable_remove(impl->mCachedPeers, pMsg->mUuid);
       zmqNamingMsg* pOrigMsg = wtable_remove(impl->mPeers, pMsg->mUuid);
       if (pOrigMsg != NULL) {
          free(pOrigMsg);
@@ -676,7 +1210,16 @@ mama_status zmqBridgeMamaTransportImpl_dispatchNamingMsg(zmqTransportBridge* imp
       // disconnected and will *not* ignore a subsequent request to connect to it
       // Note that we ignore the return value -- any errors are reported in disconnectSocket
       // (which will happen if peer has already exited, for example)
-      zmqBridgeMamaTransportImpl_disconnectSocket(&impl->mZmqDataSub, pMsg->mEndPointAddr);
+      const char* endpoint = zmqBridgeMamaTransportImpl_getPeerEndpoint(impl, pMsg);
+      if (wasIdle) {
+         // never connected
+      }
+      else if (zmqBridgeMamaTransportImpl_isShmEndpoint(endpoint)) {
+         zmqBridgeMamaTransportImpl_closeShmRing(impl, endpoint);
+      }
+      else if (zmqBridgeMamaTransportImpl_removePartitionPeer(impl, pMsg->mUuid) == MAMA_STATUS_NOT_FOUND) {
+         zmqBridgeMamaTransportImpl_disconnectSocket(&impl->mZmqDataSub, endpoint);
+      }
 
       // TODO: do we even need this?  only matters for transports that *never* publish data
       #define KICK_DATAPUB
@@ -691,10 +1234,25 @@ mama_status zmqBridgeMamaTransportImpl_dispatchNamingMsg(zmqTransportBridge* imp
       wlock_unlock(impl->mZmqDataPub.mLock);
       #endif
 
-      MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Disconnecting data sockets from publisher:%s", pMsg->mEndPointAddr);
+      MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Disconnecting data sockets from publisher:%s", endpoint);
    }
    else if (pMsg->mType == 'W') {
       // welcome msg - naming subscriber is connected
+      if ((pMsg->mFlags & ZMQ_NAMING_FLAG_SNAPSHOT) == 0) {
+         impl->mNamingSnapshot = -1;
+      }
+      else if (impl->mNamingSnapshot == 0) {
+         impl->mNamingSnapshot = 1;
+      }
+      if (impl->mNamingFailover == 1) {
+         impl->mNamingHeartbeats = (pMsg->mFlags & ZMQ_NAMING_FLAG_HEARTBEAT) ? 1 : -1;
+         impl->mNamingHeartbeatInterval = (pMsg->mHeartbeatInterval > 0) ? pMsg->mHeartbeatInterval : ZMQ_NAMING_HEARTBEAT_MILLIS;
+         if (impl->mNamingHeartbeats == -1) {
+            MAMA_LOG(MAMA_LOG_LEVEL_WARN, "nsd at %s does not send heartbeats -- naming.failover is disabled while connected to it", impl->mNamingAddress[impl->mNamingActive]);
+         }
+         free((void*) impl->mNamingProxyEndpoint);
+         impl->mNamingProxyEndpoint = strdup(pMsg->mEndPointAddr);
+      }
 
       // connect to proxy
       mama_status status = zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqNamingPub, pMsg->mEndPointAddr,
@@ -704,13 +1262,8 @@ mama_status zmqBridgeMamaTransportImpl_dispatchNamingMsg(zmqTransportBridge* imp
          return MAMA_STATUS_PLATFORM;
       }
 
-      // start thread to publish naming msg
-      wthread_t publishThread;
-      int rc = wthread_create(&publishThread, NULL, zmqBridgeMamaTransportImpl_publishEndpoints, impl);
-      if (0 != rc) {
-         MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "create of endpoint publish thread failed %d(%s)", rc, strerror(rc));
-         return MAMA_STATUS_PLATFORM;
-      }
+      // publish naming msg (until we get it back)
+      CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_publishEndpoints(impl));
    }
    else {
       MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unknown naming msg type=%c", pMsg->mType);
@@ -721,97 +1274,605 @@ mama_status zmqBridgeMamaTransportImpl_dispatchNamingMsg(zmqTransportBridge* imp
 }
 
 
-// "normal" (data) messages are enqueued on the dispatch thread of the inbox or subscription
-mama_status zmqBridgeMamaTransportImpl_dispatchNormalMsg(zmqTransportBridge* impl, zmq_msg_t* zmsg)
+// adds a peer we haven't seen before to mPeers, and connects to it, unless it doesn't publish anything we want
+mama_status zmqBridgeMamaTransportImpl_addPeer(zmqTransportBridge* impl, const zmqNamingMsg* pMsg)
 {
-   const char* subject = (char*) zmq_msg_data(zmsg);
-   MAMA_LOG(MAMA_LOG_LEVEL_FINER, "Got msg with subject %s", subject);
+   int isIdle = !zmqBridgeMamaTransportImpl_isPeerRelevant(impl, pMsg);
+   if (!isIdle) {
+      CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectPeer(impl, pMsg));
+   }
 
-   impl->mNormalMessages++;
+   // save peer in table
+   zmqNamingMsg* pOrigMsg = malloc(sizeof(zmqNamingMsg));
+   if (NULL == pOrigMsg) return MAMA_STATUS_NOMEM;
+   memcpy(pOrigMsg, pMsg, sizeof(zmqNamingMsg));
+   wtable_insert(impl->mPeers, pOrigMsg->mUuid, pOrigMsg);
+   if (isIdle) {
+      wtable_insert(impl->mIdlePeers, pOrigMsg->mUuid, pOrigMsg);
+      MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Not connecting to publisher at endpoint:%s (no matching topics)", pMsg->mEndPointAddr);
+   }
 
-   if (memcmp(subject, ZMQ_REPLYHANDLE_PREFIX, strlen(ZMQ_REPLYHANDLE_PREFIX)) == 0) {
-      return zmqBridgeMamaTransportImpl_dispatchInboxMsg(impl, subject, zmsg);
+   return MAMA_STATUS_OK;
+}
+
+
+// connects the data sub socket (or shm ring reader) to the peer that sent a naming msg
+mama_status zmqBridgeMamaTransportImpl_connectPeer(zmqTransportBridge* impl, const zmqNamingMsg* pMsg)
+{
+   const char* endpoint = zmqBridgeMamaTransportImpl_getPeerEndpoint(impl, pMsg);
+   if (zmqBridgeMamaTransportImpl_isShmEndpoint(endpoint)) {
+      CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_openShmRing(impl, endpoint, ZMQ_TPORT_DIRECTION_INCOMING));
+   }
+   else if (pMsg->mPartitionEndPointAddrs[0][0] != '\0') {
+      CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_addPartitionPeer(impl, pMsg, endpoint));
    }
    else {
-      return zmqBridgeMamaTransportImpl_dispatchSubMsg(impl, subject, zmsg);
+      CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqDataSub, endpoint, impl->mDataReconnect, impl->mDataReconnectInterval));
    }
+
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Connecting to publisher at endpoint:%s", endpoint);
+
+   return MAMA_STATUS_OK;
 }
 
 
-// enqueue msg to the (one and only) inbox
-mama_status zmqBridgeMamaTransportImpl_dispatchInboxMsg(zmqTransportBridge* impl, const char* subject, zmq_msg_t* zmsg)
+// returns the endpoint to connect to for the peer that sent a naming msg -- i.e., the endpoint in the msg, except for
+// our own msg, where we connect to our data pub socket over inproc (if enabled), and msgs from peers on the same
+// host, where we read the peer's shm ring, or connect over ipc (if the peer has one)
+const char* zmqBridgeMamaTransportImpl_getPeerEndpoint(zmqTransportBridge* impl, const zmqNamingMsg* pMsg)
 {
-   impl->mInboxMessages++;
-
-   // index directly into subject to pick up inbox name (last part)
-   const char* inboxName = &subject[ZMQ_REPLYHANDLE_INBOXNAME_INDEX];
-   wlock_lock(impl->mInboxesLock);
-   zmqInboxImpl* inbox = wtable_lookup(impl->mInboxes, inboxName);
-   if (inbox == NULL) {
-      wlock_unlock(impl->mInboxesLock);
-      MAMA_LOG(MAMA_LOG_LEVEL_FINER, "discarding uninteresting message for subject %s", subject);
-      return MAMA_STATUS_NOT_FOUND;
+   if ((impl->mLoopbackEndpoint != NULL) && (strcmp(pMsg->mUuid, impl->mUuid) == 0)) {
+      return impl->mLoopbackEndpoint;
+   }
+
+   int hasShm = (impl->mNamingShm == 1) && (pMsg->mShmEndPointAddr[0] != '\0');
+   int hasIpc = (impl->mNamingIpc == 1) && (pMsg->mIpcEndPointAddr[0] != '\0');
+   if ((hasShm != 0) || (hasIpc != 0)) {
+      char host[MAXHOSTNAMELEN + 1];
+      memset(host, '\0', sizeof(host));
+      gethostname(host, sizeof(host) -1);
+      if (strcmp(pMsg->mHost, host) == 0) {
+         return (hasShm != 0) ? pMsg->mShmEndPointAddr : pMsg->mIpcEndPointAddr;
+      }
    }
 
-   void* queue = inbox->mZmqQueue;
-   // at this point, we dont care if the inbox is deleted (as long as the queue remains)
-   wlock_unlock(impl->mInboxesLock);
-
-   // queue up message, callback will free
-   zmqTransportMsg tmsg;
-   tmsg.mTransport = impl;
-   strcpy(tmsg.mEndpointIdentifier, inboxName);
-   zmq_msg_init(&tmsg.mZmsg);
-   zmq_msg_copy(&tmsg.mZmsg, zmsg);
-   zmqBridgeMamaQueue_enqueueMsg(queue, zmqBridgeMamaTransportImpl_inboxCallback, &tmsg);
+   // the peer may publish on several interfaces -- prefer those on the same subnet as one of ours, and spread
+   // connections across the remaining candidates by our uuid (which must give the same answer every time for a given
+   // peer, so that we disconnect from the endpoint we connected to)
+   const char* candidates[ZMQ_MAX_PUBLISH_ADDRESSES];
+   int count = 0;
+   int local = 0;
+   for (int i = -1; i < ZMQ_MAX_PUBLISH_ADDRESSES -1; ++i) {
+      const char* endpoint = (i < 0) ? pMsg->mEndPointAddr : pMsg->mAltEndPointAddrs[i];
+      if (endpoint[0] == '\0') {
+         break;
+      }
+      int isLocal = zmqBridgeMamaTransportImpl_isLocalNet(impl, endpoint);
+      if (isLocal > local) {
+         // first candidate on a local subnet -- discard the others
+         local = 1;
+         count = 0;
+      }
+      if (isLocal == local) {
+         candidates[count++] = endpoint;
+      }
+   }
+   if (count > 1) {
+      return candidates[zmqBridge_hashString(impl->mUuid) % count];
+   }
 
-   return MAMA_STATUS_OK;
+   return pMsg->mEndPointAddr;
 }
 
 
-// enqueue msg to all matching subscribers
-// (both regular and wildcard subscribers)
-mama_status zmqBridgeMamaTransportImpl_dispatchSubMsg(zmqTransportBridge* impl, const char* subject, zmq_msg_t* zmsg)
+// saves the subnets of local (ipv4) interfaces
+void zmqBridgeMamaTransportImpl_getLocalNets(zmqTransportBridge* impl)
 {
-   impl->mSubMessages++;
-
-   // process wildcard subscriptions
-   zmqWildcardClosure wcClosure;
-   wcClosure.subject = subject;
-   wcClosure.zmsg = zmsg;
-   wcClosure.found = 0;
-   wlock_lock(impl->mWcsLock);
-   list_for_each(impl->mWcEndpoints, (wListCallback) zmqBridgeMamaTransportImpl_matchWildcards, &wcClosure);
-   wlock_unlock(impl->mWcsLock);
-   MAMA_LOG(MAMA_LOG_LEVEL_FINEST, "Found %d wildcard matches for %s", wcClosure.found, subject);
+   impl->mLocalNetCount = 0;
 
-   // process regular (non-wildcard) subscriptions
-   endpoint_t* subs = NULL;
-   size_t subCount = 0;
-   wlock_lock(impl->mSubsLock);
-   mama_status status = endpointPool_getRegistered(impl->mSubEndpoints, subject, &subs, &subCount);
-   if (MAMA_STATUS_OK != status) {
-      wlock_unlock(impl->mSubsLock);
-      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Error %d(%s) querying registration table for subject %s", status, mamaStatus_stringForStatus(status), subject);
-      return MAMA_STATUS_SYSTEM_ERROR;
+   struct ifaddrs* ifaddrs;
+   if (getifaddrs(&ifaddrs) != 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "getifaddrs failed %d(%s)", errno, strerror(errno));
+      return;
    }
-   if (0 == subCount) {
-      wlock_unlock(impl->mSubsLock);
-      if (wcClosure.found == 0) {
-         MAMA_LOG(MAMA_LOG_LEVEL_FINER, "discarding uninteresting message for subject %s", subject);
+   for (struct ifaddrs* ifa = ifaddrs; (ifa != NULL) && (impl->mLocalNetCount < ZMQ_MAX_LOCAL_NETS); ifa = ifa->ifa_next) {
+      if ((ifa->ifa_addr == NULL) || (ifa->ifa_netmask == NULL) || (ifa->ifa_addr->sa_family != AF_INET)) {
+         continue;
       }
-      return MAMA_STATUS_NOT_FOUND;
+      zmqLocalNet* net = &impl->mLocalNets[impl->mLocalNetCount++];
+      net->mAddr = ((struct sockaddr_in*) ifa->ifa_addr)->sin_addr.s_addr;
+      net->mMask = ((struct sockaddr_in*) ifa->ifa_netmask)->sin_addr.s_addr;
    }
-   MAMA_LOG(MAMA_LOG_LEVEL_FINEST, "Found %d non-wildcard matches for %s", subCount, subject);
+   freeifaddrs(ifaddrs);
+}
 
-   // process each subscriber
-   for (size_t subInc = 0; subInc < subCount; subInc++) {
-      zmqSubscription*  subscription = (zmqSubscription*)subs[subInc];
 
-      // TODO: what is the purpose of this?
-      if (1 == subscription->mIsTportDisconnected) {
-         subscription->mIsTportDisconnected = 0;
-      }
+// returns non-zero if the address of a "tcp://a.b.c.d:port" endpoint is on the same subnet as a local interface
+int zmqBridgeMamaTransportImpl_isLocalNet(zmqTransportBridge* impl, const char* endpoint)
+{
+   if (strncmp(endpoint, "tcp://", 6) != 0) {
+      return 0;
+   }
+   char address[ZMQ_MAX_ENDPOINT_LENGTH +1];
+   wmStrSizeCpy(address, endpoint + 6, sizeof(address));
+   char* colon = strrchr(address, ':');
+   if (colon != NULL) {
+      *colon = '\0';
+   }
+   struct in_addr addr;
+   if (inet_pton(AF_INET, address, &addr) != 1) {
+      return 0;
+   }
+
+   for (int i = 0; i < impl->mLocalNetCount; ++i) {
+      if ((addr.s_addr & impl->mLocalNets[i].mMask) == (impl->mLocalNets[i].mAddr & impl->mLocalNets[i].mMask)) {
+         return 1;
+      }
+   }
+
+   return 0;
+}
+
+
+// msgs sent to multiple subjects arrive in two parts (header and payload), which are joined back together here
+mama_status zmqBridgeMamaTransportImpl_recvParts(zmqTransportBridge* impl, zmq_msg_t* zmsg)
+{
+   mama_status status = MAMA_STATUS_OK;
+   int more = zmq_msg_more(zmsg);
+   for (int partNo = 1; more != 0; ++partNo) {
+      zmq_msg_t part;
+      zmq_msg_init(&part);
+      // remaining parts are delivered atomically w/the first, so this doesn't block
+      if (zmq_msg_recv(&part, impl->mZmqDataSub.mSocket, 0) < 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_recv failed for msg part %d(%s)", zmq_errno(), zmq_strerror(zmq_errno()));
+         zmq_msg_close(&part);
+         return MAMA_STATUS_PLATFORM;
+      }
+      more = zmq_msg_more(&part);
+      if (partNo == 1) {
+         status = zmqBridgeMamaMsgImpl_joinParts(zmsg, &part);
+      }
+      else {
+         // not something we sent -- discard rest of msg
+         status = MAMA_STATUS_SYSTEM_ERROR;
+      }
+      zmq_msg_close(&part);
+   }
+
+   return status;
+}
+
+
+// "normal" (data) messages are enqueued on the dispatch thread of the inbox or subscription
+mama_status zmqBridgeMamaTransportImpl_dispatchNormalMsg(zmqTransportBridge* impl, zmq_msg_t* zmsg)
+{
+   const char* subject = (char*) zmq_msg_data(zmsg);
+   MAMA_LOG(MAMA_LOG_LEVEL_FINER, "Got msg with subject %s", subject);
+
+   impl->mNormalMessages++;
+
+   if (memcmp(subject, ZMQ_REPLYHANDLE_PREFIX, strlen(ZMQ_REPLYHANDLE_PREFIX)) == 0) {
+      return zmqBridgeMamaTransportImpl_dispatchInboxMsg(impl, subject, zmsg);
+   }
+
+   // resolve aliased subject
+   zmqAliasEntry* aliasEntry = NULL;
+   if (subject[0] == ZMQ_ALIAS_PREFIX) {
+      aliasEntry = zmqBridgeMamaTransportImpl_findAlias(impl, subject, 1);
+      if ((aliasEntry == NULL) || (aliasEntry->mSubject == NULL)) {
+         impl->mAliasDropped++;
+         if ((aliasEntry != NULL) && (aliasEntry->mIsRequested == 0)) {
+            // ask for the definition -- w/interest tracking, the publisher re-sends it when it sees the subscription
+            // (otherwise we have to wait for it to be re-sent anyway)
+            MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Dropping msgs w/unknown alias %s until it is defined", &subject[1]);
+            aliasEntry->mIsRequested = 1;
+            if ((aliasEntry->mIsSubscribed == 0) && (zmqBridgeMamaTransportImpl_subscribe(impl->mZmqDataSub.mSocket, subject) == MAMA_STATUS_OK)) {
+               aliasEntry->mIsSubscribed = 1;
+            }
+         }
+         else {
+            MAMA_LOG(MAMA_LOG_LEVEL_FINER, "Dropping msg w/unknown alias %s", &subject[1]);
+         }
+         return MAMA_STATUS_NOT_FOUND;
+      }
+      subject = aliasEntry->mSubject;
+   }
+
+   // delta frames must be decoded here, in the order received, regardless of whether anyone is
+   // subscribed -- replaces zmsg w/the reconstructed msg
+   mama_status status = zmqBridgeMamaMsgImpl_applyDelta(impl, subject, zmsg);
+   if (status != MAMA_STATUS_OK) {
+      return status;
+   }
+   if (aliasEntry == NULL) {
+      subject = (char*) zmq_msg_data(zmsg);
+   }
+
+   status = zmqBridgeMamaTransportImpl_dispatchSubMsg(impl, subject, zmsg);
+
+   if (aliasEntry != NULL) {
+      // stop listening to the alias once no-one is interested in the subject
+      if ((status == MAMA_STATUS_NOT_FOUND) && (aliasEntry->mIsSubscribed == 1)) {
+         zmqBridgeMamaTransportImpl_unsubscribe(impl->mZmqDataSub.mSocket, (const char*) zmq_msg_data(zmsg));
+         aliasEntry->mIsSubscribed = 0;
+      }
+   }
+   else {
+      const char* aliasDefinition = zmqBridgeMamaMsgImpl_getAliasDefinition(zmsg);
+      if (aliasDefinition != NULL) {
+         zmqBridgeMamaTransportImpl_defineAlias(impl, aliasDefinition, subject, (status == MAMA_STATUS_OK));
+      }
+   }
+
+   return status;
+}
+
+
+// called from wtable_for_each to free incoming alias tables
+void zmqBridgeMamaTransportImpl_destroyAliasTable(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqAliasTable* aliasTable = (zmqAliasTable*) data;
+   for (size_t i = 0; i < aliasTable->mSize; ++i) {
+      free(aliasTable->mEntries[i].mSubject);
+   }
+   free(aliasTable->mEntries);
+   free(aliasTable);
+}
+
+
+// finds incoming alias (optionally creating an empty entry for it)
+zmqAliasEntry* zmqBridgeMamaTransportImpl_findAlias(zmqTransportBridge* impl, const char* alias, int create)
+{
+   if ((alias[0] != ZMQ_ALIAS_PREFIX) || (strlen(alias) != ZMQ_ALIAS_SIZE)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Malformed alias %s", alias);
+      return NULL;
+   }
+
+   char tag[ZMQ_ALIAS_TAG_SIZE +1];
+   memcpy(tag, &alias[1], ZMQ_ALIAS_TAG_SIZE);
+   tag[ZMQ_ALIAS_TAG_SIZE] = '\0';
+   size_t id = strtoul(&alias[1 + ZMQ_ALIAS_TAG_SIZE], NULL, 16);
+
+   zmqAliasTable* aliasTable = wtable_lookup(impl->mAliasTables, tag);
+   if (aliasTable == NULL) {
+      if (create == 0) {
+         return NULL;
+      }
+      aliasTable = calloc(1, sizeof(zmqAliasTable));
+      if ((aliasTable == NULL) || (wtable_insert(impl->mAliasTables, tag, aliasTable) < 0)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create alias table for tag %s", tag);
+         free(aliasTable);
+         return NULL;
+      }
+   }
+
+   if (id >= aliasTable->mSize) {
+      if (create == 0) {
+         return NULL;
+      }
+      size_t newSize = (aliasTable->mSize == 0) ? 64 : aliasTable->mSize;
+      while (newSize <= id) {
+         newSize *= 2;
+      }
+      zmqAliasEntry* temp = realloc(aliasTable->mEntries, newSize * sizeof(zmqAliasEntry));
+      if (temp == NULL) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to grow alias table for tag %s", tag);
+         return NULL;
+      }
+      memset(&temp[aliasTable->mSize], 0, (newSize - aliasTable->mSize) * sizeof(zmqAliasEntry));
+      aliasTable->mEntries = temp;
+      aliasTable->mSize = newSize;
+   }
+
+   return &aliasTable->mEntries[id];
+}
+
+
+// processes an alias definition -- subscribes to the alias if anyone is interested in the subject, and
+// unsubscribes from the alias if not
+void zmqBridgeMamaTransportImpl_defineAlias(zmqTransportBridge* impl, const char* alias, const char* subject, int isInterested)
+{
+   zmqAliasEntry* aliasEntry = zmqBridgeMamaTransportImpl_findAlias(impl, alias, 1);
+   if (aliasEntry == NULL) {
+      return;
+   }
+
+   // aliases are never re-used, so the subject should never change
+   if (aliasEntry->mSubject == NULL) {
+      aliasEntry->mSubject = strdup(subject);
+      MAMA_LOG(MAMA_LOG_LEVEL_FINER, "Defined alias %s for subject %s", &alias[1], subject);
+   }
+   else if (strcmp(aliasEntry->mSubject, subject) != 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Alias %s already defined for subject %s (not %s)", &alias[1], aliasEntry->mSubject, subject);
+      return;
+   }
+
+   if ((isInterested == 1) && (aliasEntry->mIsSubscribed == 0)) {
+      if (zmqBridgeMamaTransportImpl_subscribe(impl->mZmqDataSub.mSocket, alias) == MAMA_STATUS_OK) {
+         aliasEntry->mIsSubscribed = 1;
+      }
+   }
+   else if ((isInterested == 0) && (aliasEntry->mIsSubscribed == 1)) {
+      zmqBridgeMamaTransportImpl_unsubscribe(impl->mZmqDataSub.mSocket, alias);
+      aliasEntry->mIsSubscribed = 0;
+   }
+}
+
+
+// returns the outgoing alias for a subject, creating it if necessary
+zmqTopicAlias* zmqBridgeMamaTransportImpl_getTopicAlias(zmqTransportBridge* impl, const char* subject)
+{
+   wlock_lock(impl->mAliasesLock);
+   zmqTopicAlias* alias = wtable_lookup(impl->mAliases, subject);
+   if (alias == NULL) {
+      uint32_t id = ++impl->mAliasUid;
+      if (id > ZMQ_ALIAS_MAX_ID) {
+         wlock_unlock(impl->mAliasesLock);
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Too many topic aliases -- not aliasing subject %s", subject);
+         return NULL;
+      }
+      alias = calloc(1, sizeof(zmqTopicAlias));
+      if (alias == NULL) {
+         wlock_unlock(impl->mAliasesLock);
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to allocate alias for subject %s", subject);
+         return NULL;
+      }
+      sprintf(alias->mAlias, "%c%s%06x", ZMQ_ALIAS_PREFIX, impl->mAliasTag, id);
+      wtable_insert(impl->mAliases, subject, alias);
+   }
+   wlock_unlock(impl->mAliasesLock);
+
+   return alias;
+}
+
+
+// wtable_for_each callback -- flags alias to be re-defined if it matches the closure's topic
+static void zmqBridgeMamaTransportImpl_refreshAlias(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqAliasRefreshClosure* pClosure = (zmqAliasRefreshClosure*) closure;
+   zmqTopicAlias* alias = (zmqTopicAlias*) data;
+   if ((pClosure->topic == NULL) || (strncmp(key, pClosure->topic, pClosure->size) == 0)
+      || (strcmp(alias->mAlias, pClosure->topic) == 0)) {
+      __atomic_store_n(&alias->mDefine, 1, __ATOMIC_RELAXED);
+   }
+}
+
+
+void zmqBridgeMamaTransportImpl_refreshAliases(zmqTransportBridge* impl, const char* topic)
+{
+   zmqAliasRefreshClosure closure;
+   closure.topic = topic;
+   closure.size = (topic != NULL) ? strlen(topic) : 0;
+
+   wlock_lock(impl->mAliasesLock);
+   wtable_for_each(impl->mAliases, zmqBridgeMamaTransportImpl_refreshAlias, &closure);
+   wlock_unlock(impl->mAliasesLock);
+}
+
+
+// reads subscription msgs on the (XPUB) data pub socket, and updates the interest table accordingly
+// (XPUB only reports the first subscription to, and last unsubscription from, a topic)
+void zmqBridgeMamaTransportImpl_readInterest(zmqTransportBridge* impl)
+{
+   zmq_msg_t zmsg;
+   zmq_msg_init(&zmsg);
+   while (1) {
+      // lock only while reading from the socket -- the callback is free to publish
+      int events = 0;
+      size_t eventsSize = sizeof(events);
+      int size = -1;
+      wlock_lock(impl->mZmqDataPub.mLock);
+      if ((zmq_getsockopt(impl->mZmqDataPub.mSocket, ZMQ_EVENTS, &events, &eventsSize) == 0) && (events & ZMQ_POLLIN)) {
+         size = zmq_msg_recv(&zmsg, impl->mZmqDataPub.mSocket, ZMQ_DONTWAIT);
+      }
+      wlock_unlock(impl->mZmqDataPub.mLock);
+      if (size < 1) {
+         break;
+      }
+
+      const char* data = (const char*) zmq_msg_data(&zmsg);
+      int isInterested = (data[0] == 1);
+      char topic[MAX_SUBJECT_LENGTH +1];
+      size_t topicSize = ((size_t) size - 1 < MAX_SUBJECT_LENGTH) ? (size_t) size - 1 : MAX_SUBJECT_LENGTH;
+      memcpy(topic, &data[1], topicSize);
+      topic[topicSize] = '\0';
+      MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Peer %s %s", isInterested ? "subscribed to" : "unsubscribed from", topic);
+
+      wlock_lock(impl->mInterestLock);
+      if (topic[0] == '\0') {
+         impl->mInterestAll = isInterested;
+      }
+      else if (isInterested) {
+         if (wtable_lookup(impl->mInterestTable, topic) == NULL) {
+            wtable_insert(impl->mInterestTable, topic, impl);
+         }
+      }
+      else {
+         wtable_remove(impl->mInterestTable, topic);
+      }
+      __sync_add_and_fetch(&impl->mInterestGen, 1);
+      wlock_unlock(impl->mInterestLock);
+
+      // new subscribers need to know our aliases for the subject(s)
+      if ((impl->mTopicAlias == 1) && isInterested) {
+         zmqBridgeMamaTransportImpl_refreshAliases(impl, topic);
+      }
+
+      if (impl->mInterestCallback != NULL) {
+         impl->mInterestCallback(topic, isInterested, impl->mInterestClosure);
+      }
+   }
+   zmq_msg_close(&zmsg);
+}
+
+
+// returns non-zero if any peer is subscribed to a prefix of subject
+int zmqBridgeMamaTransportImpl_hasInterest(zmqTransportBridge* impl, const char* subject)
+{
+   // readers of shm rings and dish sockets don't report their subscriptions
+   if ((impl->mInterest == 0) || (impl->mShmWriterCount > 0) || (impl->mZmqRadio.mSocket != NULL)) {
+      return 1;
+   }
+
+   char prefix[MAX_SUBJECT_LENGTH +1];
+   size_t subjectSize = strlen(subject);
+   if (subjectSize > MAX_SUBJECT_LENGTH) {
+      return 1;
+   }
+   memcpy(prefix, subject, subjectSize +1);
+
+   int result = 0;
+   wlock_lock(impl->mInterestLock);
+   if (impl->mInterestAll != 0) {
+      result = 1;
+   }
+   for (size_t i = subjectSize; (result == 0) && (i > 0); --i) {
+      prefix[i] = '\0';
+      if (wtable_lookup(impl->mInterestTable, prefix) != NULL) {
+         result = 1;
+      }
+      prefix[i] = subject[i];
+   }
+   wlock_unlock(impl->mInterestLock);
+
+   return result;
+}
+
+
+// called from wtable_for_each to free incoming delta streams
+void zmqBridgeMamaTransportImpl_destroyDeltaStream(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqDeltaStream_destroy((zmqDeltaStream*) data);
+}
+
+
+// wtable_for_each callback -- collects streams that haven't been used since the last check, and clears the flag on
+// the others
+static void zmqBridgeMamaTransportImpl_collectIdleStreams(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqIdleStreamsClosure* pClosure = (zmqIdleStreamsClosure*) closure;
+   zmqDeltaStream* stream = (zmqDeltaStream*) data;
+   if (stream->mIsActive == 1) {
+      stream->mIsActive = 0;
+   }
+   else if (pClosure->count < pClosure->size) {
+      pClosure->keys[pClosure->count++] = strdup(key);
+   }
+}
+
+
+void zmqBridgeMamaTransportImpl_pruneDeltaStreams(zmqTransportBridge* impl)
+{
+   uint32_t size = wtable_get_count(impl->mDeltaStreams);
+   if (size == 0) {
+      return;
+   }
+
+   zmqIdleStreamsClosure closure;
+   closure.keys = calloc(size, sizeof(char*));
+   closure.size = size;
+   closure.count = 0;
+   if (closure.keys == NULL) {
+      return;
+   }
+   wtable_for_each(impl->mDeltaStreams, zmqBridgeMamaTransportImpl_collectIdleStreams, &closure);
+
+   for (uint32_t i = 0; i < closure.count; ++i) {
+      if (closure.keys[i] != NULL) {
+         zmqDeltaStream_destroy(wtable_remove(impl->mDeltaStreams, closure.keys[i]));
+         free(closure.keys[i]);
+      }
+   }
+   if (closure.count > 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Dropped %u idle delta streams", closure.count);
+   }
+   free(closure.keys);
+}
+
+
+// enqueue msg to the (one and only) inbox
+mama_status zmqBridgeMamaTransportImpl_dispatchInboxMsg(zmqTransportBridge* impl, const char* subject, zmq_msg_t* zmsg)
+{
+   impl->mInboxMessages++;
+
+   // inbox names are only unique within a transport, so msgs for other transports' inboxes (e.g., replies read from
+   // a shared shm ring, or on a radio group) must be dropped before looking up the name
+   if (strncmp(subject, impl->mInboxSubject, ZMQ_INBOX_SUBJECT_SIZE) != 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_FINER, "discarding message for another transport's inbox %s", subject);
+      return MAMA_STATUS_NOT_FOUND;
+   }
+
+   // index directly into subject to pick up inbox name (last part)
+   const char* inboxName = &subject[ZMQ_REPLYHANDLE_INBOXNAME_INDEX];
+   wlock_lock(impl->mInboxesLock);
+   zmqInboxImpl* inbox = wtable_lookup(impl->mInboxes, inboxName);
+   if (inbox == NULL) {
+      wlock_unlock(impl->mInboxesLock);
+      MAMA_LOG(MAMA_LOG_LEVEL_FINER, "discarding uninteresting message for subject %s", subject);
+      return MAMA_STATUS_NOT_FOUND;
+   }
+
+   void* queue = inbox->mZmqQueue;
+   // at this point, we dont care if the inbox is deleted (as long as the queue remains)
+   wlock_unlock(impl->mInboxesLock);
+
+   // queue up message, callback will free
+   zmqTransportMsg tmsg;
+   tmsg.mTransport = impl;
+   strcpy(tmsg.mEndpointIdentifier, inboxName);
+   tmsg.mSubject = NULL;
+   zmq_msg_init(&tmsg.mZmsg);
+   zmq_msg_copy(&tmsg.mZmsg, zmsg);
+   zmqBridgeMamaQueue_enqueueMsg(queue, zmqBridgeMamaTransportImpl_inboxCallback, &tmsg);
+
+   return MAMA_STATUS_OK;
+}
+
+
+// enqueue msg to all matching subscribers
+// (both regular and wildcard subscribers)
+mama_status zmqBridgeMamaTransportImpl_dispatchSubMsg(zmqTransportBridge* impl, const char* subject, zmq_msg_t* zmsg)
+{
+   impl->mSubMessages++;
+
+   // process wildcard subscriptions
+   zmqWildcardClosure wcClosure;
+   wcClosure.subject = subject;
+   wcClosure.zmsg = zmsg;
+   wcClosure.found = 0;
+   wlock_lock(impl->mWcsLock);
+   list_for_each(impl->mWcEndpoints, (wListCallback) zmqBridgeMamaTransportImpl_matchWildcards, &wcClosure);
+   wlock_unlock(impl->mWcsLock);
+   MAMA_LOG(MAMA_LOG_LEVEL_FINEST, "Found %d wildcard matches for %s", wcClosure.found, subject);
+
+   // process regular (non-wildcard) subscriptions
+   endpoint_t* subs = NULL;
+   size_t subCount = 0;
+   wlock_lock(impl->mSubsLock);
+   mama_status status = endpointPool_getRegistered(impl->mSubEndpoints, subject, &subs, &subCount);
+   if (MAMA_STATUS_OK != status) {
+      wlock_unlock(impl->mSubsLock);
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Error %d(%s) querying registration table for subject %s", status, mamaStatus_stringForStatus(status), subject);
+      return MAMA_STATUS_SYSTEM_ERROR;
+   }
+   if (0 == subCount) {
+      wlock_unlock(impl->mSubsLock);
+      if (wcClosure.found == 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_FINER, "discarding uninteresting message for subject %s", subject);
+         return MAMA_STATUS_NOT_FOUND;
+      }
+      return MAMA_STATUS_OK;
+   }
+   MAMA_LOG(MAMA_LOG_LEVEL_FINEST, "Found %d non-wildcard matches for %s", subCount, subject);
+
+   // process each subscriber
+   for (size_t subInc = 0; subInc < subCount; subInc++) {
+      zmqSubscription*  subscription = (zmqSubscription*)subs[subInc];
+
+      // TODO: what is the purpose of this?
+      if (1 == subscription->mIsTportDisconnected) {
+         subscription->mIsTportDisconnected = 0;
+      }
 
       if (1 != subscription->mIsNotMuted) {
          MAMA_LOG(MAMA_LOG_LEVEL_WARN, "muted - not queueing update for symbol %s", subject);
@@ -821,6 +1882,7 @@ mama_status zmqBridgeMamaTransportImpl_dispatchSubMsg(zmqTransportBridge* impl,
          zmqTransportMsg tmsg;
          tmsg.mTransport = impl;
          strcpy(tmsg.mEndpointIdentifier, subscription->mEndpointIdentifier);
+         tmsg.mSubject = (subject != (const char*) zmq_msg_data(zmsg)) ? subject : NULL;
          zmq_msg_init(&tmsg.mZmsg);
          zmq_msg_copy(&tmsg.mZmsg, zmsg);
          zmqBridgeMamaQueue_enqueueMsg(subscription->mZmqQueue, zmqBridgeMamaTransportImpl_subCallback, &tmsg);
@@ -855,6 +1917,7 @@ void zmqBridgeMamaTransportImpl_matchWildcards(wList dummy, zmqSubscription** pS
    zmqTransportMsg tmsg;
    tmsg.mTransport = subscription->mTransport;
    strcpy(tmsg.mEndpointIdentifier, subscription->mEndpointIdentifier);
+   tmsg.mSubject = (closure->subject != (const char*) zmq_msg_data(closure->zmsg)) ? closure->subject : NULL;
    zmq_msg_init(&tmsg.mZmsg);
    zmq_msg_copy(&tmsg.mZmsg, closure->zmsg);
    zmqBridgeMamaQueue_enqueueMsg(subscription->mZmqQueue, zmqBridgeMamaTransportImpl_wcCallback, &tmsg);
@@ -900,7 +1963,7 @@ void MAMACALLTYPE  zmqBridgeMamaTransportImpl_inboxCallback(mamaQueue queue, voi
    }
 
    /* Unpack this bridge message into a MAMA msg implementation */
-   status = zmqBridgeMamaMsgImpl_deserialize(bridgeMsg, &tmsg->mZmsg, tmpMsg);
+   status = zmqBridgeMamaMsgImpl_deserialize(bridgeMsg, &tmsg->mZmsg, tmsg->mTransport, tmpMsg);
    if (MAMA_STATUS_OK != status) {
       MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmqBridgeMamaMsgImpl_deserialize() failed. [%s]", mamaStatus_stringForStatus(status));
       goto exit;
@@ -924,7 +1987,7 @@ exit:
 void MAMACALLTYPE  zmqBridgeMamaTransportImpl_subCallback(mamaQueue queue, void* closure)
 {
    zmqTransportMsg* tmsg = (zmqTransportMsg*) closure;
-   const char *subject = (const char*) zmq_msg_data(&tmsg->mZmsg);
+   const char *subject = (tmsg->mSubject != NULL) ? tmsg->mSubject : (const char*) zmq_msg_data(&tmsg->mZmsg);
 
    // find the subscription based on its identifier
    zmqSubscription* subscription = NULL;
@@ -959,7 +2022,7 @@ void MAMACALLTYPE  zmqBridgeMamaTransportImpl_subCallback(mamaQueue queue, void*
    }
 
    /* Unpack this bridge message into a MAMA msg implementation */
-   status = zmqBridgeMamaMsgImpl_deserialize(bridgeMsg, &tmsg->mZmsg, tmpMsg);
+   status = zmqBridgeMamaMsgImpl_deserialize(bridgeMsg, &tmsg->mZmsg, tmsg->mTransport, tmpMsg);
    if (MAMA_STATUS_OK != status) {
       MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmqBridgeMamaMsgImpl_deserialize() failed. [%s]", mamaStatus_stringForStatus(status));
    }
@@ -987,7 +2050,7 @@ exit:
 void MAMACALLTYPE  zmqBridgeMamaTransportImpl_wcCallback(mamaQueue queue, void* closure)
 {
    zmqTransportMsg* tmsg = (zmqTransportMsg*) closure;
-   const char *subject = (const char*) zmq_msg_data(&tmsg->mZmsg);
+   const char *subject = (tmsg->mSubject != NULL) ? tmsg->mSubject : (const char*) zmq_msg_data(&tmsg->mZmsg);
 
    // is this subscription still in the list?
    zmqFindWildcardClosure findClosure;
@@ -1024,7 +2087,7 @@ void MAMACALLTYPE  zmqBridgeMamaTransportImpl_wcCallback(mamaQueue queue, void*
    }
 
    /* Unpack this bridge message into a MAMA msg implementation */
-   status = zmqBridgeMamaMsgImpl_deserialize(bridgeMsg, &tmsg->mZmsg, tmpMsg);
+   status = zmqBridgeMamaMsgImpl_deserialize(bridgeMsg, &tmsg->mZmsg, tmsg->mTransport, tmpMsg);
    if (MAMA_STATUS_OK != status) {
       MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmqBridgeMamaMsgImpl_deserialize() failed. [%s]", mamaStatus_stringForStatus(status));
    }
@@ -1133,6 +2196,15 @@ mama_status zmqBridgeMamaTransportImpl_createSocket(void* zmqContext, zmqSocket*
    if ((socket->mMonitor != 0) && (name != NULL)) {
       char endpoint[ZMQ_MAX_ENDPOINT_LENGTH +1];
       sprintf(endpoint, "inproc://%s", name);
+#if ZMQ_MONITOR_PEERS > 1
+      if (socket->mMonitor == ZMQ_MONITOR_PEERS) {
+         // always need connects/disconnects to track peers, regardless of log level
+         uint64_t events = get_zmqEventMask(gMamaLogLevel) | ZMQ_EVENT_ACCEPTED | ZMQ_EVENT_CONNECTED | ZMQ_EVENT_DISCONNECTED
+            | ZMQ_EVENT_PIPES_STATS;
+         CALL_ZMQ_FUNC(zmq_socket_monitor_versioned(socket->mSocket, endpoint, events, 2, ZMQ_PAIR));
+      }
+      else
+#endif
       CALL_ZMQ_FUNC(zmq_socket_monitor(socket->mSocket, endpoint, get_zmqEventMask(gMamaLogLevel)));
    }
 
@@ -1512,11 +2584,49 @@ mama_status zmqBridgeMamaTransportImpl_sendEndpointsMsg(zmqTransportBridge* impl
    gethostname(msg.mHost, sizeof(msg.mHost));
    msg.mPid = getpid();
    strcpy(msg.mUuid, impl->mUuid);
-   strcpy(msg.mEndPointAddr, impl->mPubEndpoint);
+   strcpy(msg.mEndPointAddr, impl->mPubEndpoint[0]);
+   for (int i = 1; (i < ZMQ_MAX_PUBLISH_ADDRESSES) && (impl->mPubEndpoint[i] != NULL); ++i) {
+      strcpy(msg.mAltEndPointAddrs[i -1], impl->mPubEndpoint[i]);
+   }
+   for (int i = 1; i < impl->mPartitions; ++i) {
+      strcpy(msg.mPartitionEndPointAddrs[i -1], impl->mPartitionEndpoint[i -1]);
+   }
+   if (impl->mTopicFilter > 0) {
+      msg.mTopicFilter = impl->mTopicFilter;
+      // wildcard subscriptions can match any namespace, so then we don't advertise a subscription filter
+      wlock_lock(impl->mWcsLock);
+      size_t wildcards = list_get_size(impl->mWcEndpoints);
+      wlock_unlock(impl->mWcsLock);
+      wlock_lock(impl->mPubNamespacesLock);
+      memcpy(msg.mTopicBloom, impl->mTopicBloom, sizeof(msg.mTopicBloom));
+      if (wildcards == 0) {
+         msg.mFlags |= ZMQ_NAMING_FLAG_SUB_FILTER;
+         memcpy(msg.mSubBloom, impl->mSubBloom, sizeof(msg.mSubBloom));
+      }
+      wlock_unlock(impl->mPubNamespacesLock);
+   }
+   if (impl->mIpcEndpoint != NULL) {
+      strcpy(msg.mIpcEndPointAddr, impl->mIpcEndpoint);
+   }
+   if (impl->mShmEndpoint != NULL) {
+      strcpy(msg.mShmEndPointAddr, impl->mShmEndpoint);
+   }
+
+   const void* data = &msg;
+   size_t size = sizeof(msg);
+   char compactMsg[ZMQ_NAMING_COMPACT_MAX_SIZE];
+   if (impl->mNamingCompact == 1) {
+      size = zmqNaming_encode(&msg, compactMsg, sizeof(compactMsg));
+      if (size == 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to encode endpoints: prog=%s host=%s pid=%ld pub=%s", msg.mProgName, msg.mHost, msg.mPid, msg.mEndPointAddr);
+         return MAMA_STATUS_PLATFORM;
+      }
+      data = compactMsg;
+   }
 
    wlock_lock(impl->mZmqNamingPub.mLock);
-   int i = zmq_send(impl->mZmqNamingPub.mSocket, &msg, sizeof(msg), 0);
-   if (i != sizeof(msg)) {
+   int i = zmq_send(impl->mZmqNamingPub.mSocket, data, size, 0);
+   if (i != (int) size) {
       MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to publish endpoints: prog=%s host=%s pid=%ld pub=%s", msg.mProgName, msg.mHost, msg.mPid, msg.mEndPointAddr);
       status = MAMA_STATUS_PLATFORM;
    }
@@ -1530,24 +2640,70 @@ mama_status zmqBridgeMamaTransportImpl_sendEndpointsMsg(zmqTransportBridge* impl
 }
 
 
-// publishes endpoint message continuously until we get it back
-void* zmqBridgeMamaTransportImpl_publishEndpoints(void* closure)
+static void zmqBridgeMamaTransportImpl_publishTimerCallback(timerElement timer, void* closure);
+
+// arranges for endpoint msg to be re-sent after mNamingConnectInterval (called w/mPublishLock held)
+static void zmqBridgeMamaTransportImpl_schedulePublish(zmqTransportBridge* impl)
+{
+   struct timeval timeout;
+   timeout.tv_sec  = impl->mNamingConnectInterval / ONE_MILLION;
+   timeout.tv_usec = impl->mNamingConnectInterval % ONE_MILLION;
+
+   lockTimerHeap(gOmzmqTimerHeap);
+   int rc = createTimer((timerElement*) &impl->mPublishTimer, gOmzmqTimerHeap, zmqBridgeMamaTransportImpl_publishTimerCallback, &timeout, impl);
+   unlockTimerHeap(gOmzmqTimerHeap);
+   if (0 != rc) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create endpoint publish timer [%d].", rc);
+      impl->mPublishTimer = NULL;
+   }
+}
+
+
+// called on the timer thread -- the timer is only ever destroyed here (once its callback can no longer be
+// running), and stop waits for it
+static void zmqBridgeMamaTransportImpl_publishTimerCallback(timerElement timer, void* closure)
 {
    zmqTransportBridge* impl = (zmqTransportBridge*) closure;
 
-   wInterlocked_set(0, &impl->mNamingConnected);
-   int retries = impl->mNamingConnectRetries;
-   while ( (--retries > 0) && (1 == wInterlocked_read(&impl->mIsDispatching)) ) {
+   wlock_lock(impl->mPublishLock);
+
+   // timers are single-shot
+   lockTimerHeap(gOmzmqTimerHeap);
+   destroyTimer(gOmzmqTimerHeap, timer);
+   unlockTimerHeap(gOmzmqTimerHeap);
+   impl->mPublishTimer = NULL;
+
+   if (wInterlocked_read(&impl->mNamingConnected) == 1) {
+      MAMA_LOG(MAMA_LOG_LEVEL_FINER, "Successfully connected to proxy");
+   }
+   else if ((impl->mPublishStopping == 0) && (--impl->mPublishRetries > 0) && (1 == wInterlocked_read(&impl->mIsDispatching))) {
       zmqBridgeMamaTransportImpl_sendEndpointsMsg(impl, 'C');
-      if (wInterlocked_read(&impl->mNamingConnected) == 1) {
-         MAMA_LOG(MAMA_LOG_LEVEL_FINER, "Successfully connected to proxy");
-         return NULL;
-      }
+      zmqBridgeMamaTransportImpl_schedulePublish(impl);
+   }
+   wlock_unlock(impl->mPublishLock);
+}
+
+
+// publishes endpoint message, and re-sends it from the timer thread until we get it back
+// (called on the dispatch thread, on receipt of a welcome msg)
+mama_status zmqBridgeMamaTransportImpl_publishEndpoints(zmqTransportBridge* impl)
+{
+   mama_status status = MAMA_STATUS_OK;
 
-      usleep(impl->mNamingConnectInterval);
+   wlock_lock(impl->mPublishLock);
+   if (impl->mPublishStopping == 0) {
+      // start over, if already re-sending (e.g., welcome from another nsd) -- the pending timer is left to fire, and
+      // carries on re-sending w/the reset retry count
+      wInterlocked_set(0, &impl->mNamingConnected);
+      impl->mPublishRetries = impl->mNamingConnectRetries;
+      status = zmqBridgeMamaTransportImpl_sendEndpointsMsg(impl, 'C');
+      if (impl->mPublishTimer == NULL) {
+         zmqBridgeMamaTransportImpl_schedulePublish(impl);
+      }
    }
+   wlock_unlock(impl->mPublishLock);
 
-   return NULL;
+   return status;
 }
 
 
@@ -1566,6 +2722,10 @@ void* zmqBridgeMamaTransportImpl_monitorThread(void* closure)
    void* namingSubMonitor = zmq_socket(impl->mZmqContext, ZMQ_PAIR);
    zmq_connect(namingSubMonitor, "inproc://namingSub");
 
+   // w/slow consumer detection, wake up periodically to ask data pub socket for per-peer stats
+   long timeout = (impl->mSlowConsumerMax > 0) ? impl->mSlowConsumerInterval : -1;
+   uint64_t nextCheck = getMicros() + (timeout * 1000);
+
    while (1 == wInterlocked_read(&impl->mIsMonitoring)) {
       zmq_pollitem_t items[] = {
          { dataPubMonitor,                   0, ZMQ_POLLIN , 0},
@@ -1574,14 +2734,19 @@ void* zmqBridgeMamaTransportImpl_monitorThread(void* closure)
          { namingSubMonitor,                 0, ZMQ_POLLIN , 0},
          { impl->mZmqMonitorSub.mSocket,     0, ZMQ_POLLIN , 0},
       };
-      int rc = zmq_poll(items, 5, -1);
+      int rc = zmq_poll(items, 5, timeout);
       if ((rc < 0) && (errno != EINTR)) {
          MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "zmq_poll failed  %d(%s)", errno, zmq_strerror(errno));
          continue;
       }
 
       if (items[0].revents & ZMQ_POLLIN) {
-         zmqBridgeMamaTransportImpl_monitorEvent(dataPubMonitor, "dataPub");
+         if (impl->mZmqDataPub.mMonitor > 1) {
+            zmqBridgeMamaTransportImpl_monitorPeerEvent(impl, dataPubMonitor, "dataPub");
+         }
+         else {
+            zmqBridgeMamaTransportImpl_monitorEvent(dataPubMonitor, "dataPub");
+         }
       }
       if (items[1].revents & ZMQ_POLLIN) {
          zmqBridgeMamaTransportImpl_monitorEvent(dataSubMonitor, "dataSub");
@@ -1595,6 +2760,11 @@ void* zmqBridgeMamaTransportImpl_monitorThread(void* closure)
       if (items[4].revents & ZMQ_POLLIN) {
          // nothing to do -- just loop around and check mIsMonitoring flag
       }
+
+      if ((timeout > 0) && (getMicros() >= nextCheck)) {
+         zmqBridgeMamaTransportImpl_checkConsumers(impl);
+         nextCheck = getMicros() + (timeout * 1000);
+      }
    }
 
    zmq_close(dataPubMonitor);
@@ -1608,7 +2778,10 @@ void* zmqBridgeMamaTransportImpl_monitorThread(void* closure)
 
 mama_status zmqBridgeMamaTransportImpl_startMonitor(zmqTransportBridge* impl)
 {
-
+#if !defined(ZMQ_CLIENT) || !defined(ZMQ_SERVER)
+   MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Socket monitor requires libzmq w/draft API");
+   return MAMA_STATUS_NOT_IMPLEMENTED;
+#else
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqMonitorSub, ZMQ_SERVER, "monitorSub", 0));
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_bindSocket(&impl->mZmqMonitorSub,  ZMQ_MONITOR_ENDPOINT, NULL, 0, 0));
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqMonitorPub, ZMQ_CLIENT, "monitorPub", 0));
@@ -1626,6 +2799,7 @@ mama_status zmqBridgeMamaTransportImpl_startMonitor(zmqTransportBridge* impl)
    }
 
    return MAMA_STATUS_OK;
+#endif
 }
 
 
@@ -1661,6 +2835,23 @@ typedef struct __attribute__ ((packed)) zmq_monitor_frame1 {
    uint32_t    value;
 } zmq_monitor_frame1;
 
+static void zmqBridgeMamaTransportImpl_logMonitorEvent(void *socket, const char* socketName, int event, int value, const char* endpoint)
+{
+   const char* eventName = get_zmqEventName(event);
+
+   // how should this be logged?
+   int logLevel = get_zmqEventLogLevel(event);
+   // only log msgs w/port=":0" when MAMA's log level is MAMA_LOG_LEVEL_FINE or above,
+   // regardless of the msg's log level
+   // Note use of MAMA global variable gMamaLogLevel
+   const char* port = strrchr(endpoint, ':');
+   if (((port == NULL) || (strcmp(port+1, "0") == 0)) && (gMamaLogLevel <= MAMA_LOG_LEVEL_NORMAL)) {
+      return;
+   }
+
+   MAMA_LOG(logLevel, "socket:%p name:%s value:%d event:%d desc:%s endpoint:%s", socket, socketName, value, event, eventName, endpoint);
+}
+
 int zmqBridgeMamaTransportImpl_monitorEvent(void *socket, const char* socketName)
 {
    // First frame in message contains event number and value
@@ -1672,7 +2863,6 @@ int zmqBridgeMamaTransportImpl_monitorEvent(void *socket, const char* socketName
    zmq_monitor_frame1* pFrame1 = (zmq_monitor_frame1*) zmq_msg_data (&msg);
    int event = pFrame1->event;
    int value = pFrame1->value;
-   const char* eventName = get_zmqEventName(event);
 
    // Second frame in message contains event address
    zmq_msg_init (&msg);
@@ -1685,17 +2875,966 @@ int zmqBridgeMamaTransportImpl_monitorEvent(void *socket, const char* socketName
    memset(endpoint, '\0', sizeof(endpoint));
    memcpy(endpoint, data, size);
 
-   // how should this be logged?
-   int logLevel = get_zmqEventLogLevel(event);
-   // only log msgs w/port=":0" when MAMA's log level is MAMA_LOG_LEVEL_FINE or above,
-   // regardless of the msg's log level
-   // Note use of MAMA global variable gMamaLogLevel
-   char* port = strrchr(endpoint, ':');
-   if (((port == NULL) || (strcmp(port+1, "0") == 0)) && (gMamaLogLevel <= MAMA_LOG_LEVEL_NORMAL)) {
-      return 0;
+   zmqBridgeMamaTransportImpl_logMonitorEvent(socket, socketName, event, value, endpoint);
+
+   return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// shm rings
+//
+// "shm://name" endpoints are shared memory rings (see shmring.h) rather than zmq endpoints -- an outgoing endpoint is
+// a ring that all msgs sent on the data pub socket are also written to (see sender.c), and an incoming endpoint is a
+// ring that the dispatch thread reads msgs from, as if they had arrived on the data sub socket.  Note that a ring
+// carries all msgs sent by its writer, so readers see msgs that a zmq subscriber would have filtered out (these are
+// discarded in dispatchSubMsg).
+
+int zmqBridgeMamaTransportImpl_isShmEndpoint(const char* uri)
+{
+   return (strncmp(uri, ZMQ_SHM_PREFIX, strlen(ZMQ_SHM_PREFIX)) == 0);
+}
+
+
+mama_status zmqBridgeMamaTransportImpl_openShmRing(zmqTransportBridge* impl, const char* uri, zmqTransportDirection direction)
+{
+   const char* name = uri + strlen(ZMQ_SHM_PREFIX);
+   int isWriter = (direction == ZMQ_TPORT_DIRECTION_OUTGOING);
+   zmqShmRing** rings = isWriter ? impl->mShmWriters : impl->mShmReaders;
+   int* count = isWriter ? &impl->mShmWriterCount : &impl->mShmReaderCount;
+
+   if (*count >= ZMQ_MAX_SHM_RINGS) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Too many shm rings -- can't open %s", uri);
+      return MAMA_STATUS_NOMEM;
    }
 
-   MAMA_LOG(logLevel, "socket:%p name:%s value:%d event:%d desc:%s endpoint:%s", socket, socketName, value, event, eventName, endpoint);
+   zmqShmRing* ring = isWriter ? zmqShmRing_create(name, impl->mShmSize, impl->mShmMode) : zmqShmRing_open(name);
+   if (ring == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to open shm ring %s", uri);
+      return MAMA_STATUS_PLATFORM;
+   }
+
+   // writers are used w/the data pub socket's lock held
+   if (isWriter) {
+      wlock_lock(impl->mZmqDataPub.mLock);
+   }
+   rings[(*count)++] = ring;
+   if (isWriter) {
+      wlock_unlock(impl->mZmqDataPub.mLock);
+   }
+
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Opened shm ring %s for %s", uri, isWriter ? "writing" : "reading");
+
+   return MAMA_STATUS_OK;
+}
+
+
+// closes a ring opened for reading (dispatch thread only)
+mama_status zmqBridgeMamaTransportImpl_closeShmRing(zmqTransportBridge* impl, const char* uri)
+{
+   const char* name = uri + strlen(ZMQ_SHM_PREFIX);
+   for (int i = 0; i < impl->mShmReaderCount; ++i) {
+      zmqShmRing* ring = impl->mShmReaders[i];
+      if (strcmp(zmqShmRing_getName(ring), name) == 0) {
+         impl->mShmLost += zmqShmRing_getLost(ring);
+         zmqShmRing_destroy(ring);
+         impl->mShmReaders[i] = impl->mShmReaders[--impl->mShmReaderCount];
+         MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Closed shm ring %s", uri);
+         return MAMA_STATUS_OK;
+      }
+   }
+
+   return MAMA_STATUS_NOT_FOUND;
+}
+
+
+void zmqBridgeMamaTransportImpl_closeShmRings(zmqTransportBridge* impl)
+{
+   for (int i = 0; i < impl->mShmReaderCount; ++i) {
+      impl->mShmLost += zmqShmRing_getLost(impl->mShmReaders[i]);
+      zmqShmRing_destroy(impl->mShmReaders[i]);
+   }
+   impl->mShmReaderCount = 0;
+
+   for (int i = 0; i < impl->mShmWriterCount; ++i) {
+      zmqShmRing_destroy(impl->mShmWriters[i]);
+   }
+   impl->mShmWriterCount = 0;
+}
+
+
+// dispatches msgs from all rings -- returns non-zero if there may be more to read
+int zmqBridgeMamaTransportImpl_readShmRings(zmqTransportBridge* impl)
+{
+   int more = 0;
+
+   for (int i = 0; i < impl->mShmReaderCount; ++i) {
+      zmqShmRing* ring = impl->mShmReaders[i];
+      int n = 0;
+      size_t size;
+      const void* data;
+      while ((n < ZMQ_SHM_READ_BATCH) && ((data = zmqShmRing_peek(ring, &size)) != NULL)) {
+         // msgs are queued to subscribers asynchronously, so have to be copied out of the ring
+         zmq_msg_t zmsg;
+         if (0 != zmq_msg_init_size(&zmsg, size)) {
+            MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_init_size failed %d(%s)", zmq_errno(), zmq_strerror(errno));
+            break;
+         }
+         memcpy(zmq_msg_data(&zmsg), data, size);
+         if (zmqShmRing_release(ring) != 0) {
+            impl->mShmMessages++;
+            zmqBridgeMamaTransportImpl_dispatchNormalMsg(impl, &zmsg);
+         }
+         zmq_msg_close(&zmsg);
+         ++n;
+      }
+      if (n == ZMQ_SHM_READ_BATCH) {
+         more = 1;
+      }
+   }
+
+   return more;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// partitions
+//
+// With naming.partitions set, a publisher hashes subjects across several data pub sockets (see sender.c), each w/its
+// own endpoint and io thread.  Subscribers connect only to the partitions of each peer that their subscriptions (and
+// inbox) hash to -- or to all of them, once there are any wildcard subscriptions, which can match any subject.
+// Connections are kept when subscriptions are removed, until the peer disconnects.
+
+// wtable_for_each callback -- adds the partition of a subscribed topic to the mask
+static void zmqBridgeMamaTransportImpl_addTopicToMask(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqPartitionClosure* pClosure = (zmqPartitionClosure*) closure;
+   if (*((int*) data) > 0) {
+      pClosure->mask |= 1U << zmqBridgeMamaTransportImpl_getPartition(key, pClosure->count);
+   }
+}
+
+
+// returns the partitions (of a peer w/count partitions) that our subscriptions need
+uint32_t zmqBridgeMamaTransportImpl_getPartitionMask(zmqTransportBridge* impl, int count)
+{
+   wlock_lock(impl->mWcsLock);
+   size_t wildcards = list_get_size(impl->mWcEndpoints);
+   wlock_unlock(impl->mWcsLock);
+   if (wildcards > 0) {
+      return (1U << count) - 1;
+   }
+
+   zmqPartitionClosure closure;
+   closure.impl = impl;
+   closure.topic = NULL;
+   closure.count = count;
+   closure.mask = 1U << zmqBridgeMamaTransportImpl_getPartition(impl->mInboxSubject, count);
+   closure.all = 0;
+   wtable_for_each(impl->mSubTopics, zmqBridgeMamaTransportImpl_addTopicToMask, &closure);
+
+   return closure.mask;
+}
+
+
+mama_status zmqBridgeMamaTransportImpl_connectPartitions(zmqTransportBridge* impl, zmqPartitionPeer* peer, uint32_t mask)
+{
+   for (int i = 0; i < peer->mCount; ++i) {
+      uint32_t bit = 1U << i;
+      if (((mask & bit) != 0) && ((peer->mConnected & bit) == 0)) {
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqDataSub, peer->mEndpoints[i], impl->mDataReconnect, impl->mDataReconnectInterval));
+         peer->mConnected |= bit;
+         MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Connecting to publisher partition %d at endpoint:%s", i, peer->mEndpoints[i]);
+      }
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+// endpoint is the one chosen for partition 0 (see getPeerEndpoint)
+mama_status zmqBridgeMamaTransportImpl_addPartitionPeer(zmqTransportBridge* impl, const zmqNamingMsg* pMsg, const char* endpoint)
+{
+   zmqPartitionPeer* peer = calloc(1, sizeof(zmqPartitionPeer));
+   if (peer == NULL) {
+      return MAMA_STATUS_NOMEM;
+   }
+   wmStrSizeCpy(peer->mEndpoints[0], endpoint, sizeof(peer->mEndpoints[0]));
+   peer->mCount = 1;
+   while ((peer->mCount < ZMQ_MAX_PARTITIONS) && (pMsg->mPartitionEndPointAddrs[peer->mCount -1][0] != '\0')) {
+      wmStrSizeCpy(peer->mEndpoints[peer->mCount], pMsg->mPartitionEndPointAddrs[peer->mCount -1], sizeof(peer->mEndpoints[0]));
+      peer->mCount++;
+   }
+
+   if (wtable_insert(impl->mPartitionPeers, pMsg->mUuid, peer) < 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to add partitioned peer %s", pMsg->mUuid);
+      free(peer);
+      return MAMA_STATUS_NOMEM;
+   }
+
+   return zmqBridgeMamaTransportImpl_connectPartitions(impl, peer, zmqBridgeMamaTransportImpl_getPartitionMask(impl, peer->mCount));
+}
+
+
+// returns MAMA_STATUS_NOT_FOUND if the peer isn't partitioned
+mama_status zmqBridgeMamaTransportImpl_removePartitionPeer(zmqTransportBridge* impl, const char* uuid)
+{
+   zmqPartitionPeer* peer = wtable_remove(impl->mPartitionPeers, uuid);
+   if (peer == NULL) {
+      return MAMA_STATUS_NOT_FOUND;
+   }
+
+   for (int i = 0; i < peer->mCount; ++i) {
+      if ((peer->mConnected & (1U << i)) != 0) {
+         zmqBridgeMamaTransportImpl_disconnectSocket(&impl->mZmqDataSub, peer->mEndpoints[i]);
+      }
+   }
+   free(peer);
+
+   return MAMA_STATUS_OK;
+}
+
+
+// wtable_for_each callback -- connects to the partition(s) of a peer needed for a new subscription
+static void zmqBridgeMamaTransportImpl_connectPeerPartitions(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqPartitionClosure* pClosure = (zmqPartitionClosure*) closure;
+   zmqPartitionPeer* peer = (zmqPartitionPeer*) data;
+   uint32_t mask = (pClosure->all != 0) ? (1U << peer->mCount) - 1 : 1U << zmqBridgeMamaTransportImpl_getPartition(pClosure->topic, peer->mCount);
+   zmqBridgeMamaTransportImpl_connectPartitions(pClosure->impl, peer, mask);
+}
+
+
+// connects to the partition(s) of each peer needed for a new subscription
+void zmqBridgeMamaTransportImpl_connectTopicPartitions(zmqTransportBridge* impl, const char* topic)
+{
+   if (wtable_get_count(impl->mPartitionPeers) == 0) {
+      return;
+   }
+
+   wlock_lock(impl->mWcsLock);
+   size_t wildcards = list_get_size(impl->mWcEndpoints);
+   wlock_unlock(impl->mWcsLock);
+   zmqPartitionClosure closure;
+   closure.impl = impl;
+   closure.topic = topic;
+   closure.count = 0;
+   closure.mask = 0;
+   closure.all = (wildcards > 0);
+   wtable_for_each(impl->mPartitionPeers, zmqBridgeMamaTransportImpl_connectPeerPartitions, &closure);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// topic filters
+//
+// With naming.topic_filter set, a transport advertises the namespaces (the first topic_filter components of the
+// subject) of its publishers and of its subscriptions as Bloom filters in its naming msgs.  It only connects to peers
+// that publish on the namespace of one of its subscriptions, or that subscribe to the namespace of one of its
+// publishers (the latter so that replies to our requests, which are published on our inbox topics, are seen).
+// Peers that don't advertise a filter (or use a different depth) are always connected to, as is any peer once there
+// are wildcard subscriptions, which can match any namespace.  For the same reason a transport w/wildcard subscriptions
+// doesn't advertise a subscription filter, and peers treat that (and older peers that don't send one) as subscribing
+// to everything.  Peers that don't match are kept as idle, and connected to when a matching subscription or publisher
+// is added, or their filters change.  Connections are kept when subscriptions are removed, until the peer disconnects.
+
+// subscriptions are counted per topic, on the dispatch thread
+mama_status zmqBridgeMamaTransportImpl_addSubTopic(zmqTransportBridge* impl, const char* topic)
+{
+   int* count = wtable_lookup(impl->mSubTopics, topic);
+   if (count == NULL) {
+      count = calloc(1, sizeof(int));
+      if ((count == NULL) || (wtable_insert(impl->mSubTopics, topic, count) < 0)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to add subscription topic %s", topic);
+         free(count);
+         return MAMA_STATUS_NOMEM;
+      }
+   }
+   int isNew = 0;
+   if (((*count)++ == 0) && (impl->mTopicFilter > 0)) {
+      char ns[MAX_SUBJECT_LENGTH +1];
+      zmqBridge_getNamespace(topic, impl->mTopicFilter, ns, sizeof(ns));
+      wlock_lock(impl->mPubNamespacesLock);
+      isNew = !zmqBridge_bloomTest(impl->mSubBloom, sizeof(impl->mSubBloom), ns);
+      zmqBridge_bloomAdd(impl->mSubBloom, sizeof(impl->mSubBloom), ns);
+      wlock_unlock(impl->mPubNamespacesLock);
+   }
+
+   zmqBridgeMamaTransportImpl_connectTopicPartitions(impl, topic);
+   zmqBridgeMamaTransportImpl_checkIdlePeers(impl);
+
+   // let peers that publish on the namespace know about it now, rather than on our next beacon -- likewise when we
+   // start (or stop) advertising a subscription filter
+   if (impl->mTopicFilter > 0) {
+      wlock_lock(impl->mWcsLock);
+      int wildcards = (list_get_size(impl->mWcEndpoints) > 0);
+      wlock_unlock(impl->mWcsLock);
+      if ((isNew || (wildcards != impl->mSubWildcards)) && (wInterlocked_read(&impl->mNamingConnected) == 1)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Advertising subscription namespaces for topic %s", topic);
+         zmqBridgeMamaTransportImpl_sendEndpointsMsg(impl, 'c');
+      }
+      impl->mSubWildcards = wildcards;
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+// wtable_for_each callback -- adds the namespace of a subscribed topic to the transport's subscription filter
+static void zmqBridgeMamaTransportImpl_addSubTopicToBloom(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqTransportBridge* impl = (zmqTransportBridge*) closure;
+   if (*((int*) data) > 0) {
+      char ns[MAX_SUBJECT_LENGTH +1];
+      zmqBridge_getNamespace(key, impl->mTopicFilter, ns, sizeof(ns));
+      zmqBridge_bloomAdd(impl->mSubBloom, sizeof(impl->mSubBloom), ns);
+   }
+}
+
+
+// Bloom filters don't support removal, so the filter is rebuilt once a topic has no subscriptions
+mama_status zmqBridgeMamaTransportImpl_removeSubTopic(zmqTransportBridge* impl, const char* topic)
+{
+   int* count = wtable_lookup(impl->mSubTopics, topic);
+   if ((count == NULL) || (*count == 0)) {
+      return MAMA_STATUS_NOT_FOUND;
+   }
+   if ((--(*count) == 0) && (impl->mTopicFilter > 0)) {
+      wlock_lock(impl->mPubNamespacesLock);
+      memset(impl->mSubBloom, '\0', sizeof(impl->mSubBloom));
+      wtable_for_each(impl->mSubTopics, zmqBridgeMamaTransportImpl_addSubTopicToBloom, impl);
+      wlock_unlock(impl->mPubNamespacesLock);
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+// publishers are counted per namespace, from any thread -- the transport's filter is re-advertised whenever a new
+// namespace is added, and idle peers are re-checked (on the dispatch thread)
+mama_status zmqBridgeMamaTransportImpl_addPubNamespace(zmqTransportBridge* impl, const char* subject)
+{
+   char ns[MAX_SUBJECT_LENGTH +1];
+   zmqBridge_getNamespace(subject, impl->mTopicFilter, ns, sizeof(ns));
+
+   wlock_lock(impl->mPubNamespacesLock);
+   int* count = wtable_lookup(impl->mPubNamespaces, ns);
+   if (count == NULL) {
+      count = calloc(1, sizeof(int));
+      if ((count == NULL) || (wtable_insert(impl->mPubNamespaces, ns, count) < 0)) {
+         wlock_unlock(impl->mPubNamespacesLock);
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to add publisher namespace %s", ns);
+         free(count);
+         return MAMA_STATUS_NOMEM;
+      }
+   }
+   int isNew = ((*count)++ == 0);
+   if (isNew) {
+      zmqBridge_bloomAdd(impl->mTopicBloom, sizeof(impl->mTopicBloom), ns);
+   }
+   wlock_unlock(impl->mPubNamespacesLock);
+
+   if (isNew && (wInterlocked_read(&impl->mNamingConnected) == 1)) {
+      // peers will see the new namespace in our next beacon anyway, so this is not fatal if it fails
+      MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Advertising publisher namespace %s", ns);
+      zmqBridgeMamaTransportImpl_sendEndpointsMsg(impl, 'c');
+   }
+   if (isNew) {
+      zmqControlMsg msg;
+      memset(&msg, '\0', sizeof(msg));
+      msg.command = 'P';
+      CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_sendCommand(impl, &msg, sizeof(msg)));
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+// wtable_for_each callback -- adds a namespace to the transport's filter
+static void zmqBridgeMamaTransportImpl_addNamespaceToBloom(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqTransportBridge* impl = (zmqTransportBridge*) closure;
+   if (*((int*) data) > 0) {
+      zmqBridge_bloomAdd(impl->mTopicBloom, sizeof(impl->mTopicBloom), key);
+   }
+}
+
+
+// Bloom filters don't support removal, so the filter is rebuilt once a namespace has no publishers
+mama_status zmqBridgeMamaTransportImpl_removePubNamespace(zmqTransportBridge* impl, const char* subject)
+{
+   char ns[MAX_SUBJECT_LENGTH +1];
+   zmqBridge_getNamespace(subject, impl->mTopicFilter, ns, sizeof(ns));
+
+   wlock_lock(impl->mPubNamespacesLock);
+   int* count = wtable_lookup(impl->mPubNamespaces, ns);
+   if ((count != NULL) && (*count > 0) && (--(*count) == 0)) {
+      memset(impl->mTopicBloom, '\0', sizeof(impl->mTopicBloom));
+      wtable_for_each(impl->mPubNamespaces, zmqBridgeMamaTransportImpl_addNamespaceToBloom, impl);
+   }
+   wlock_unlock(impl->mPubNamespacesLock);
+
+   return MAMA_STATUS_OK;
+}
+
+
+// wtable_for_each callback -- checks whether the namespace of a subscribed topic (or publisher namespace) is in one of
+// a peer's filters
+static void zmqBridgeMamaTransportImpl_matchTopicFilter(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqTopicFilterClosure* pClosure = (zmqTopicFilterClosure*) closure;
+   if ((pClosure->found == 0) && (*((int*) data) > 0)) {
+      char ns[MAX_SUBJECT_LENGTH +1];
+      zmqBridge_getNamespace(key, pClosure->msg->mTopicFilter, ns, sizeof(ns));
+      if ((pClosure->bloom == NULL) || zmqBridge_bloomTest(pClosure->bloom, ZMQ_TOPIC_BLOOM_SIZE, ns)) {
+         pClosure->found = 1;
+      }
+   }
+}
+
+
+// returns non-zero if we should connect to the peer that sent a naming msg (dispatch thread only)
+int zmqBridgeMamaTransportImpl_isPeerRelevant(zmqTransportBridge* impl, const zmqNamingMsg* pMsg)
+{
+   if ((impl->mTopicFilter == 0) || (pMsg->mTopicFilter != impl->mTopicFilter) || (strcmp(pMsg->mUuid, impl->mUuid) == 0)) {
+      return 1;
+   }
+
+   wlock_lock(impl->mWcsLock);
+   size_t wildcards = list_get_size(impl->mWcEndpoints);
+   wlock_unlock(impl->mWcsLock);
+   if (wildcards > 0) {
+      return 1;
+   }
+
+   // does the peer publish anything we subscribe to?
+   zmqTopicFilterClosure closure;
+   closure.msg = pMsg;
+   closure.bloom = pMsg->mTopicBloom;
+   closure.found = 0;
+   wtable_for_each(impl->mSubTopics, zmqBridgeMamaTransportImpl_matchTopicFilter, &closure);
+   // ... or subscribe to anything we publish? (it may reply to our requests)
+   if (closure.found == 0) {
+      closure.bloom = (pMsg->mFlags & ZMQ_NAMING_FLAG_SUB_FILTER) ? pMsg->mSubBloom : NULL;
+      wlock_lock(impl->mPubNamespacesLock);
+      wtable_for_each(impl->mPubNamespaces, zmqBridgeMamaTransportImpl_matchTopicFilter, &closure);
+      wlock_unlock(impl->mPubNamespacesLock);
+   }
+
+   return closure.found;
+}
+
+
+// wtable_for_each callback -- collects idle peers that have become relevant
+static void zmqBridgeMamaTransportImpl_collectIdlePeers(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqIdlePeersClosure* pClosure = (zmqIdlePeersClosure*) closure;
+   zmqNamingMsg* pMsg = (zmqNamingMsg*) data;
+   if ((pClosure->count < pClosure->size) && zmqBridgeMamaTransportImpl_isPeerRelevant(pClosure->impl, pMsg)) {
+      pClosure->peers[pClosure->count++] = pMsg;
+   }
+}
+
+
+// connects to any idle peers that have become relevant (dispatch thread only)
+void zmqBridgeMamaTransportImpl_checkIdlePeers(zmqTransportBridge* impl)
+{
+   uint32_t size = wtable_get_count(impl->mIdlePeers);
+   if (size == 0) {
+      return;
+   }
+
+   zmqIdlePeersClosure closure;
+   closure.impl = impl;
+   closure.peers = calloc(size, sizeof(zmqNamingMsg*));
+   closure.size = size;
+   closure.count = 0;
+   if (closure.peers == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to allocate idle peers");
+      return;
+   }
+   wtable_for_each(impl->mIdlePeers, zmqBridgeMamaTransportImpl_collectIdlePeers, &closure);
+
+   for (uint32_t i = 0; i < closure.count; ++i) {
+      wtable_remove(impl->mIdlePeers, closure.peers[i]->mUuid);
+      zmqBridgeMamaTransportImpl_connectPeer(impl, closure.peers[i]);
+   }
+   free(closure.peers);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// radio/dish
+//
+// "udp://" endpoints use zmq's (draft) radio/dish sockets rather than the data pub/sub sockets -- an outgoing endpoint
+// is connected to by a radio socket that all msgs sent on the data pub socket are also sent on (see sender.c), and an
+// incoming endpoint is bound to by a dish socket that the dispatch thread reads msgs from.  Delivery is unreliable,
+// so each msg carries a per-group seq (see zmqRadioTrailer), and receivers count (and log) any gaps.
+// Dish sockets filter msgs by exact match on group, rather than by prefix, so each subscription joins the group for
+// its topic (see getRadioGroup) -- wildcard subscriptions only see msgs whose group matches their prefix exactly.
+// Topic aliases are not supported, since the group has to be derived from the actual subject.
+
+int zmqBridgeMamaTransportImpl_isRadioEndpoint(const char* uri)
+{
+   return (strncmp(uri, ZMQ_UDP_PREFIX, strlen(ZMQ_UDP_PREFIX)) == 0);
+}
+
+
+mama_status zmqBridgeMamaTransportImpl_openRadio(zmqTransportBridge* impl, const char* uri, zmqTransportDirection direction)
+{
+#if defined(ZMQ_RADIO) && defined(ZMQ_DISH)
+   if (direction == ZMQ_TPORT_DIRECTION_OUTGOING) {
+      if (impl->mZmqRadio.mSocket == NULL) {
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqRadio, ZMQ_RADIO, "dataRadio", impl->mSocketMonitor));
+         if (impl->mTopicAlias != 0) {
+            MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Topic aliases are not supported w/radio sockets -- disabling topic_alias");
+            impl->mTopicAlias = 0;
+         }
+      }
+      CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqRadio, uri, 0, 0));
+      MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Connecting radio socket to:%s", uri);
+   }
+   else {
+      if (impl->mZmqDish.mSocket == NULL) {
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqDish, ZMQ_DISH, "dataDish", impl->mSocketMonitor));
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_joinRadioGroup(impl, impl->mInboxSubject));
+      }
+      CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_bindSocket(&impl->mZmqDish, uri, NULL, 0, 0));
+      MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Bound dish socket to:%s", uri);
+   }
+
+   return MAMA_STATUS_OK;
+#else
+   MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Radio/dish sockets require libzmq w/draft API -- can't open %s", uri);
+   return MAMA_STATUS_NOT_IMPLEMENTED;
+#endif
+}
+
+
+// joins the group for topic on the dish socket, if not already joined (dispatch thread only)
+mama_status zmqBridgeMamaTransportImpl_joinRadioGroup(zmqTransportBridge* impl, const char* topic)
+{
+   char group[ZMQ_RADIO_GROUP_SIZE +1];
+   zmqBridgeMamaTransportImpl_getRadioGroup(impl, topic, group);
+
+   int* count = wtable_lookup(impl->mRadioGroups, group);
+   if (count == NULL) {
+      count = calloc(1, sizeof(int));
+      if ((count == NULL) || (wtable_insert(impl->mRadioGroups, group, count) < 0)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create radio group %s", group);
+         free(count);
+         return MAMA_STATUS_NOMEM;
+      }
+   }
+   if ((*count)++ == 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Joining radio group %s", group);
+#if defined(ZMQ_RADIO) && defined(ZMQ_DISH)
+      CALL_ZMQ_FUNC(zmq_join(impl->mZmqDish.mSocket, group));
+#endif
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+// leaves the group for topic on the dish socket, once there are no more subscriptions to it (dispatch thread only)
+mama_status zmqBridgeMamaTransportImpl_leaveRadioGroup(zmqTransportBridge* impl, const char* topic)
+{
+   char group[ZMQ_RADIO_GROUP_SIZE +1];
+   zmqBridgeMamaTransportImpl_getRadioGroup(impl, topic, group);
+
+   int* count = wtable_lookup(impl->mRadioGroups, group);
+   if ((count == NULL) || (*count == 0)) {
+      return MAMA_STATUS_NOT_FOUND;
+   }
+   if (--(*count) == 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Leaving radio group %s", group);
+#if defined(ZMQ_RADIO) && defined(ZMQ_DISH)
+      CALL_ZMQ_FUNC(zmq_leave(impl->mZmqDish.mSocket, group));
+#endif
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+// checks the msg's seq against the one expected from its sender, strips the trailer and dispatches the msg
+mama_status zmqBridgeMamaTransportImpl_dispatchRadioMsg(zmqTransportBridge* impl, zmq_msg_t* zmsg)
+{
+   impl->mRadioMessages++;
+
+   size_t size = zmq_msg_size(zmsg);
+   if (size < sizeof(zmqRadioTrailer) + 2) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Discarding radio msg w/invalid size %lu", size);
+      return MAMA_STATUS_INVALID_ARG;
+   }
+   size -= sizeof(zmqRadioTrailer);
+   zmqRadioTrailer trailer;
+   memcpy(&trailer, (const char*) zmq_msg_data(zmsg) + size, sizeof(trailer));
+
+   // seqs are tracked per sender & group
+#if defined(ZMQ_RADIO) && defined(ZMQ_DISH)
+   const char* group = zmq_msg_group(zmsg);
+#else
+   const char* group = NULL;
+#endif
+   char key[ZMQ_RADIO_GROUP_SIZE + 10];
+   sprintf(key, "%08x.%s", trailer.mTag, (group != NULL) ? group : "");
+   uint32_t* expected = wtable_lookup(impl->mRadioRecvSeqs, key);
+   if (expected == NULL) {
+      expected = calloc(1, sizeof(uint32_t));
+      if ((expected == NULL) || (wtable_insert(impl->mRadioRecvSeqs, key, expected) < 0)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create radio seq for %s", key);
+         free(expected);
+         expected = NULL;
+      }
+   }
+   else if (trailer.mSeq != *expected) {
+      // seqs are unsigned 32-bit, so wrap
+      uint32_t lost = trailer.mSeq - *expected;
+      if (lost < UINT32_MAX / 2) {
+         impl->mRadioLost += lost;
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Lost %u radio msg(s) from %s (expected seq %u, received %u)", lost, key, *expected, trailer.mSeq);
+      }
+      else {
+         MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Received out-of-order radio msg from %s (expected seq %u, received %u)", key, *expected, trailer.mSeq);
+         return MAMA_STATUS_OK;
+      }
+   }
+   if (expected != NULL) {
+      *expected = trailer.mSeq + 1;
+   }
+
+   // msgs are queued to subscribers asynchronously, so need their own copy w/o the trailer
+   zmq_msg_t copy;
+   if (0 != zmq_msg_init_size(&copy, size)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_init_size failed %d(%s)", zmq_errno(), zmq_strerror(errno));
+      return MAMA_STATUS_NOMEM;
+   }
+   memcpy(zmq_msg_data(&copy), zmq_msg_data(zmsg), size);
+   mama_status status = zmqBridgeMamaTransportImpl_dispatchNormalMsg(impl, &copy);
+   zmq_msg_close(&copy);
+
+   return status;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// slow consumers
+//
+// Peers connected to the data pub socket are tracked (by their remote endpoint) from the connect/disconnect events
+// reported by the socket monitor.  With slow_consumer_max_msgs set, the monitor thread periodically asks the socket
+// for per-peer stats, and reports (or disconnects) any peer w/more msgs queued than that.  Note that zmq only
+// reports msg counts, so there is no equivalent limit on bytes queued.
+
+// v2 monitor events are multi-part: event id, # of values, values, local endpoint, remote endpoint
+int zmqBridgeMamaTransportImpl_monitorPeerEvent(zmqTransportBridge* impl, void *socket, const char* socketName)
+{
+#if ZMQ_MONITOR_PEERS > 1
+   uint64_t event = 0;
+   uint64_t count = 0;
+   uint64_t values[ZMQ_MONITOR_MAX_VALUES];
+   memset(values, 0, sizeof(values));
+   char local[ZMQ_MAX_ENDPOINT_LENGTH +1];
+   memset(local, '\0', sizeof(local));
+   char remote[ZMQ_MAX_ENDPOINT_LENGTH +1];
+   memset(remote, '\0', sizeof(remote));
+
+   zmq_msg_t msg;
+   zmq_msg_init(&msg);
+   uint64_t frame = 0;
+   int more = 1;
+   while (more) {
+      if (zmq_msg_recv(&msg, socket, 0) == -1) {
+         zmq_msg_close(&msg);
+         return -1; // Interrupted, presumably
+      }
+      more = zmq_msg_more(&msg);
+
+      const void* data = zmq_msg_data(&msg);
+      size_t size = zmq_msg_size(&msg);
+      if (size > ZMQ_MAX_ENDPOINT_LENGTH) {
+         size = ZMQ_MAX_ENDPOINT_LENGTH;
+      }
+      if ((frame == 0) && (size == sizeof(event))) {
+         memcpy(&event, data, size);
+      }
+      else if ((frame == 1) && (size == sizeof(count))) {
+         memcpy(&count, data, size);
+      }
+      else if ((frame >= 2) && (frame < count + 2)) {
+         if ((frame - 2 < ZMQ_MONITOR_MAX_VALUES) && (size == sizeof(uint64_t))) {
+            memcpy(&values[frame - 2], data, size);
+         }
+      }
+      else if (frame == count + 2) {
+         memcpy(local, data, size);
+      }
+      else if (frame == count + 3) {
+         memcpy(remote, data, size);
+      }
+      ++frame;
+   }
+   zmq_msg_close(&msg);
+
+   switch(event) {
+      case ZMQ_EVENT_ACCEPTED:
+      case ZMQ_EVENT_CONNECTED:
+         // value is the peer's fd
+         zmqBridgeMamaTransportImpl_addConsumer(impl, remote, (int) values[0]);
+         break;
+
+      case ZMQ_EVENT_DISCONNECTED:
+         zmqBridgeMamaTransportImpl_removeConsumer(impl, remote);
+         break;
+
+      case ZMQ_EVENT_PIPES_STATS:
+         // values are msgs queued outbound & inbound -- only outbound matters for a pub socket
+         // (not logged -- one of these for every peer, every slow_consumer_interval)
+         zmqBridgeMamaTransportImpl_checkConsumer(impl, remote, values[0]);
+         return 0;
+   }
+
+   zmqBridgeMamaTransportImpl_logMonitorEvent(socket, socketName, (int) event, (int) values[0], local);
+#endif
 
    return 0;
 }
+
+
+// asks data pub socket to report stats for each peer (as ZMQ_EVENT_PIPES_STATS events on its monitor socket)
+void zmqBridgeMamaTransportImpl_checkConsumers(zmqTransportBridge* impl)
+{
+#if ZMQ_MONITOR_PEERS > 1
+   wlock_lock(impl->mConsumersLock);
+   if (impl->mCheckConsumers != 0) {
+      wlock_lock(impl->mZmqDataPub.mLock);
+      int rc = zmq_socket_monitor_pipes_stats(impl->mZmqDataPub.mSocket);
+      wlock_unlock(impl->mZmqDataPub.mLock);
+      // EAGAIN just means there are no peers
+      if ((rc != 0) && (zmq_errno() != EAGAIN)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_socket_monitor_pipes_stats failed %d(%s)", zmq_errno(), zmq_strerror(zmq_errno()));
+      }
+   }
+   wlock_unlock(impl->mConsumersLock);
+#endif
+}
+
+
+void zmqBridgeMamaTransportImpl_addConsumer(zmqTransportBridge* impl, const char* endpoint, int fd)
+{
+   if (endpoint[0] == '\0') {
+      return;
+   }
+
+   wlock_lock(impl->mConsumersLock);
+   zmqConsumer* consumer = wtable_lookup(impl->mConsumers, endpoint);
+   if (consumer == NULL) {
+      consumer = calloc(1, sizeof(zmqConsumer));
+      if (consumer == NULL) {
+         wlock_unlock(impl->mConsumersLock);
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to allocate consumer for %s", endpoint);
+         return;
+      }
+      wtable_insert(impl->mConsumers, endpoint, consumer);
+   }
+   consumer->mFd = fd;
+   consumer->mQueued = 0;
+   consumer->mIsSlow = 0;
+   wlock_unlock(impl->mConsumersLock);
+}
+
+
+void zmqBridgeMamaTransportImpl_removeConsumer(zmqTransportBridge* impl, const char* endpoint)
+{
+   wlock_lock(impl->mConsumersLock);
+   zmqConsumer* consumer = wtable_remove(impl->mConsumers, endpoint);
+   wlock_unlock(impl->mConsumersLock);
+   free(consumer);
+}
+
+
+void zmqBridgeMamaTransportImpl_checkConsumer(zmqTransportBridge* impl, const char* endpoint, uint64_t queued)
+{
+   int isSlow = 0;
+
+   wlock_lock(impl->mConsumersLock);
+   zmqConsumer* consumer = wtable_lookup(impl->mConsumers, endpoint);
+   if (consumer != NULL) {
+      consumer->mQueued = queued;
+      if (queued <= impl->mSlowConsumerMax) {
+         // caught up -- will be reported again if it falls behind again
+         consumer->mIsSlow = 0;
+      }
+      else if (consumer->mIsSlow == 0) {
+         consumer->mIsSlow = 1;
+         isSlow = 1;
+         impl->mSlowConsumers++;
+      }
+   }
+   wlock_unlock(impl->mConsumersLock);
+
+   if (isSlow == 0) {
+      return;
+   }
+
+   MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Slow consumer on transport %s: peer %s has %llu msgs queued (max %llu)", impl->mName, endpoint,
+      (unsigned long long) queued, (unsigned long long) impl->mSlowConsumerMax);
+
+   if (impl->mSlowConsumerPolicy == ZMQ_SLOW_CONSUMER_DISCONNECT) {
+      if (zmqBridgeMamaTransportImpl_disconnectConsumer(impl, endpoint) == MAMA_STATUS_OK) {
+         __sync_add_and_fetch(&impl->mSlowConsumersEvicted, 1);
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Slow consumer on transport %s: disconnected peer %s", impl->mName, endpoint);
+      }
+   }
+}
+
+
+// zmq doesn't provide a way to drop a single peer from a bound socket, so we do it by shutting down its connection
+// (zmq then sees an error on the connection, closes it and discards any msgs queued to it)
+mama_status zmqBridgeMamaTransportImpl_disconnectConsumer(zmqTransportBridge* impl, const char* endpoint)
+{
+   mama_status status = MAMA_STATUS_NOT_FOUND;
+
+   wlock_lock(impl->mConsumersLock);
+   zmqConsumer* consumer = wtable_lookup(impl->mConsumers, endpoint);
+   if (consumer != NULL) {
+      if (shutdown(consumer->mFd, SHUT_RDWR) == 0) {
+         status = MAMA_STATUS_OK;
+      }
+      else {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "shutdown of connection to %s failed %d(%s)", endpoint, errno, strerror(errno));
+         status = MAMA_STATUS_PLATFORM;
+      }
+   }
+   wlock_unlock(impl->mConsumersLock);
+
+   return status;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// naming failover
+
+// switches to the next nsd once we've missed ZMQ_NAMING_FAILOVER_HEARTBEATS heartbeats from the current one (called on
+// the dispatch thread at least once per heartbeat interval)
+void zmqBridgeMamaTransportImpl_checkNamingFailover(zmqTransportBridge* impl, uint64_t now)
+{
+   if ((impl->mNamingHeartbeats == -1)
+      || (now - impl->mNamingLastHeard <= (uint64_t) impl->mNamingHeartbeatInterval * ZMQ_NAMING_FAILOVER_HEARTBEATS)) {
+      return;
+   }
+
+   int next = impl->mNamingActive + 1;
+   if ((next >= ZMQ_MAX_NAMING_URIS) || (impl->mNamingAddress[next] == NULL)) {
+      next = 0;
+   }
+   MAMA_LOG(MAMA_LOG_LEVEL_WARN, "No msgs from nsd at %s for %lums -- switching to %s", impl->mNamingAddress[impl->mNamingActive],
+      (unsigned long) (now - impl->mNamingLastHeard), impl->mNamingAddress[next]);
+
+   // Note that we ignore the return values -- any errors are reported in disconnectSocket
+   zmqBridgeMamaTransportImpl_disconnectSocket(&impl->mZmqNamingSub, impl->mNamingAddress[impl->mNamingActive]);
+   if (impl->mNamingProxyEndpoint != NULL) {
+      zmqBridgeMamaTransportImpl_disconnectSocket(&impl->mZmqNamingPub, impl->mNamingProxyEndpoint);
+      free((void*) impl->mNamingProxyEndpoint);
+      impl->mNamingProxyEndpoint = NULL;
+   }
+
+   // the new nsd's welcome msg connects the naming pub socket, and republishes our endpoints
+   impl->mNamingActive = next;
+   impl->mNamingHeartbeats = 0;
+   impl->mNamingLastHeard = now;
+   impl->mNamingFailovers++;
+   zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqNamingSub, impl->mNamingAddress[next],
+      impl->mNamingReconnect, impl->mNamingReconnectInterval);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// peer cache
+
+// zmqPeerCache_load callback -- connects to a peer from the cache, as if we'd heard from it over naming
+void zmqBridgeMamaTransportImpl_addCachedPeer(const zmqNamingMsg* pMsg, void* closure)
+{
+   zmqTransportBridge* impl = closure;
+   if (wtable_lookup(impl->mPeers, pMsg->mUuid) != NULL) {
+      return;
+   }
+   // that's us, from before the restart
+   for (int i = 0; (i < ZMQ_MAX_PUBLISH_ADDRESSES) && (impl->mPubEndpoint[i] != NULL); ++i) {
+      if (strcmp(pMsg->mEndPointAddr, impl->mPubEndpoint[i]) == 0) {
+         return;
+      }
+   }
+
+   if (zmqBridgeMamaTransportImpl_addPeer(impl, pMsg) == MAMA_STATUS_OK) {
+      wtable_insert(impl->mCachedPeers, pMsg->mUuid, wtable_lookup(impl->mPeers, pMsg->mUuid));
+   }
+}
+
+
+// wtable_for_each callback -- collects all cached peers
+static void zmqBridgeMamaTransportImpl_collectCachedPeers(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqIdlePeersClosure* pClosure = (zmqIdlePeersClosure*) closure;
+   if (pClosure->count < pClosure->size) {
+      pClosure->peers[pClosure->count++] = (zmqNamingMsg*) data;
+   }
+}
+
+
+// wtable_for_each callback -- checks whether another peer has the same endpoint
+static void zmqBridgeMamaTransportImpl_findEndpoint(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqEndpointClosure* pClosure = closure;
+   const zmqNamingMsg* pMsg = data;
+   if ((strcmp(pMsg->mUuid, pClosure->uuid) != 0) && (wtable_lookup(pClosure->impl->mCachedPeers, pMsg->mUuid) == NULL)
+      && (strcmp(zmqBridgeMamaTransportImpl_getPeerEndpoint(pClosure->impl, pMsg), pClosure->endpoint) == 0)) {
+      pClosure->found = 1;
+   }
+}
+
+
+// disconnects from cached peers that we haven't heard from over naming by now
+void zmqBridgeMamaTransportImpl_pruneCachedPeers(zmqTransportBridge* impl)
+{
+   uint32_t size = wtable_get_count(impl->mCachedPeers);
+   if (size == 0) {
+      return;
+   }
+
+   zmqIdlePeersClosure closure;
+   closure.impl = impl;
+   closure.peers = calloc(size, sizeof(zmqNamingMsg*));
+   closure.size = size;
+   closure.count = 0;
+   if (closure.peers == NULL) {
+      return;
+   }
+   wtable_for_each(impl->mCachedPeers, zmqBridgeMamaTransportImpl_collectCachedPeers, &closure);
+
+   for (uint32_t i = 0; i < closure.count; ++i) {
+      zmqNamingMsg msg;
+      memcpy(&msg, closure.peers[i], sizeof(msg));
+      MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Dropping cached peer: prog=%s host=%s uuid=%s pid=%ld", msg.mProgName, msg.mHost, msg.mUuid, msg.mPid);
+
+      // a peer that restarted on the same endpoint may have replaced this one, in which case just forget it
+      zmqEndpointClosure endpointClosure;
+      endpointClosure.impl = impl;
+      endpointClosure.uuid = msg.mUuid;
+      endpointClosure.endpoint = zmqBridgeMamaTransportImpl_getPeerEndpoint(impl, &msg);
+      endpointClosure.found = 0;
+      wtable_for_each(impl->mPeers, zmqBridgeMamaTransportImpl_findEndpoint, &endpointClosure);
+      if (endpointClosure.found) {
+         wtable_remove(impl->mCachedPeers, msg.mUuid);
+         wtable_remove(impl->mIdlePeers, msg.mUuid);
+         free(wtable_remove(impl->mPeers, msg.mUuid));
+         continue;
+      }
+
+      // otherwise, as if the peer had sent a disconnect msg
+      msg.mType = 'D';
+      zmqBridgeMamaTransportImpl_handleNamingMsg(impl, &msg);
+   }
+   free(closure.peers);
+}
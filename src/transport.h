@@ -77,6 +77,13 @@ mama_status zmqBridgeMamaTransportImpl_bindOrConnect(void* socket, const char* u
 static void* zmqBridgeMamaTransportImpl_dispatchThread(void* closure);
 //
 mama_status MAMACALLTYPE  zmqBridgeMamaTransportImpl_dispatchNamingMsg(zmqTransportBridge* zmqTransport, zmq_msg_t* zmsg);
+mama_status zmqBridgeMamaTransportImpl_handleNamingMsg(zmqTransportBridge* impl, const zmqNamingMsg* pMsg);
+mama_status zmqBridgeMamaTransportImpl_addPeer(zmqTransportBridge* impl, const zmqNamingMsg* pMsg);
+mama_status zmqBridgeMamaTransportImpl_connectPeer(zmqTransportBridge* impl, const zmqNamingMsg* pMsg);
+const char* zmqBridgeMamaTransportImpl_getPeerEndpoint(zmqTransportBridge* impl, const zmqNamingMsg* pMsg);
+void zmqBridgeMamaTransportImpl_getLocalNets(zmqTransportBridge* impl);
+int zmqBridgeMamaTransportImpl_isLocalNet(zmqTransportBridge* impl, const char* endpoint);
+mama_status zmqBridgeMamaTransportImpl_recvParts(zmqTransportBridge* impl, zmq_msg_t* zmsg);
 mama_status MAMACALLTYPE  zmqBridgeMamaTransportImpl_dispatchNormalMsg(zmqTransportBridge* zmqTransport, zmq_msg_t* zmsg);
 mama_status MAMACALLTYPE zmqBridgeMamaTransportImpl_dispatchControlMsg(zmqTransportBridge* impl, zmq_msg_t* zmsg);
 mama_status MAMACALLTYPE zmqBridgeMamaTransportImpl_dispatchSubMsg(zmqTransportBridge* impl, const char* subject, zmq_msg_t* zmsg);
@@ -92,7 +99,7 @@ mama_status MAMACALLTYPE zmqBridgeMamaTransportImpl_subscribe(void* socket, cons
 mama_status MAMACALLTYPE zmqBridgeMamaTransportImpl_unsubscribe(void* socket, const char* topic);
 
 // naming-style transports publish their endpoints so peers can connect
-void* MAMACALLTYPE zmqBridgeMamaTransportImpl_publishEndpoints(void* closure);
+mama_status zmqBridgeMamaTransportImpl_publishEndpoints(zmqTransportBridge* impl);
 mama_status zmqBridgeMamaTransportImpl_sendEndpointsMsg(zmqTransportBridge* impl, char command);
 
 mama_status MAMACALLTYPE zmqBridgeMamaTransportImpl_kickSocket(void* socket);
@@ -103,6 +110,85 @@ typedef struct zmqWildcardClosure {
    zmq_msg_t*  zmsg;
    int         found;
 } zmqWildcardClosure;
+
+// partition support
+typedef struct zmqPartitionClosure {
+   zmqTransportBridge*  impl;
+   const char*          topic;
+   int                  count;
+   uint32_t             mask;
+   int                  all;
+} zmqPartitionClosure;
+
+uint32_t zmqBridgeMamaTransportImpl_getPartitionMask(zmqTransportBridge* impl, int count);
+mama_status zmqBridgeMamaTransportImpl_connectPartitions(zmqTransportBridge* impl, zmqPartitionPeer* peer, uint32_t mask);
+mama_status zmqBridgeMamaTransportImpl_addPartitionPeer(zmqTransportBridge* impl, const zmqNamingMsg* pMsg, const char* endpoint);
+mama_status zmqBridgeMamaTransportImpl_removePartitionPeer(zmqTransportBridge* impl, const char* uuid);
+void zmqBridgeMamaTransportImpl_connectTopicPartitions(zmqTransportBridge* impl, const char* topic);
+
+// topic filter support
+typedef struct zmqTopicFilterClosure {
+   const zmqNamingMsg*  msg;
+   const uint8_t*       bloom;         // peer's filter to match against (NULL matches anything)
+   int                  found;
+} zmqTopicFilterClosure;
+
+typedef struct zmqIdlePeersClosure {
+   zmqTransportBridge*  impl;
+   zmqNamingMsg**       peers;
+   uint32_t             size;
+   uint32_t             count;
+} zmqIdlePeersClosure;
+
+mama_status zmqBridgeMamaTransportImpl_addSubTopic(zmqTransportBridge* impl, const char* topic);
+mama_status zmqBridgeMamaTransportImpl_removeSubTopic(zmqTransportBridge* impl, const char* topic);
+mama_status zmqBridgeMamaTransportImpl_addPubNamespace(zmqTransportBridge* impl, const char* subject);
+mama_status zmqBridgeMamaTransportImpl_removePubNamespace(zmqTransportBridge* impl, const char* subject);
+int zmqBridgeMamaTransportImpl_isPeerRelevant(zmqTransportBridge* impl, const zmqNamingMsg* pMsg);
+void zmqBridgeMamaTransportImpl_checkIdlePeers(zmqTransportBridge* impl);
+
+// peer cache (see naming.peer_cache)
+typedef struct zmqEndpointClosure {
+   zmqTransportBridge*  impl;
+   const char*          uuid;
+   const char*          endpoint;
+   int                  found;
+} zmqEndpointClosure;
+
+void zmqBridgeMamaTransportImpl_addCachedPeer(const zmqNamingMsg* pMsg, void* closure);
+void zmqBridgeMamaTransportImpl_pruneCachedPeers(zmqTransportBridge* impl);
+
+// w/naming.failover, switches to the next nsd if we haven't heard from the current one for a beacon interval
+void zmqBridgeMamaTransportImpl_checkNamingFailover(zmqTransportBridge* impl, uint64_t now);
+void zmqBridgeMamaTransportImpl_destroyDeltaStream(wtable_t table, void* data, const char* key, void* closure);
+
+typedef struct zmqIdleStreamsClosure {
+   char**               keys;
+   uint32_t             size;
+   uint32_t             count;
+} zmqIdleStreamsClosure;
+
+// drops incoming delta streams that haven't been used since the last call
+void zmqBridgeMamaTransportImpl_pruneDeltaStreams(zmqTransportBridge* impl);
+
+void zmqBridgeMamaTransportImpl_destroyAliasTable(wtable_t table, void* data, const char* key, void* closure);
+zmqAliasEntry* zmqBridgeMamaTransportImpl_findAlias(zmqTransportBridge* impl, const char* alias, int create);
+void zmqBridgeMamaTransportImpl_defineAlias(zmqTransportBridge* impl, const char* alias, const char* subject, int isInterested);
+zmqTopicAlias* zmqBridgeMamaTransportImpl_getTopicAlias(zmqTransportBridge* impl, const char* subject);
+
+// flags outgoing aliases to be (re-)defined w/the next msg sent on them -- either all of them (topic is NULL), or
+// those whose subject starts w/topic, or whose alias is topic
+typedef struct zmqAliasRefreshClosure {
+   const char*          topic;
+   size_t               size;
+} zmqAliasRefreshClosure;
+
+void zmqBridgeMamaTransportImpl_refreshAliases(zmqTransportBridge* impl, const char* topic);
+
+// subscriber interest
+void zmqBridgeMamaTransportImpl_readInterest(zmqTransportBridge* impl);
+int zmqBridgeMamaTransportImpl_hasInterest(zmqTransportBridge* impl, const char* subject);
+
 void zmqBridgeMamaTransportImpl_matchWildcards(wList dummy, zmqSubscription** pSubscription, zmqWildcardClosure* closure);
 
 typedef struct zmqFindWildcardClosure {
@@ -127,6 +213,27 @@ mama_status zmqBridgeMamaTransportImpl_startMonitor(zmqTransportBridge* impl);
 mama_status zmqBridgeMamaTransportImpl_stopMonitor(zmqTransportBridge* impl);
 int zmqBridgeMamaTransportImpl_monitorEvent(void *socket, const char* socketName);
 
+// shm rings
+int zmqBridgeMamaTransportImpl_isShmEndpoint(const char* uri);
+mama_status zmqBridgeMamaTransportImpl_openShmRing(zmqTransportBridge* impl, const char* uri, zmqTransportDirection direction);
+mama_status zmqBridgeMamaTransportImpl_closeShmRing(zmqTransportBridge* impl, const char* uri);
+void zmqBridgeMamaTransportImpl_closeShmRings(zmqTransportBridge* impl);
+int zmqBridgeMamaTransportImpl_readShmRings(zmqTransportBridge* impl);
+
+int zmqBridgeMamaTransportImpl_isRadioEndpoint(const char* uri);
+mama_status zmqBridgeMamaTransportImpl_openRadio(zmqTransportBridge* impl, const char* uri, zmqTransportDirection direction);
+mama_status zmqBridgeMamaTransportImpl_joinRadioGroup(zmqTransportBridge* impl, const char* topic);
+mama_status zmqBridgeMamaTransportImpl_leaveRadioGroup(zmqTransportBridge* impl, const char* topic);
+mama_status zmqBridgeMamaTransportImpl_dispatchRadioMsg(zmqTransportBridge* impl, zmq_msg_t* zmsg);
+
+// slow consumers (peers connected to data pub socket)
+int zmqBridgeMamaTransportImpl_monitorPeerEvent(zmqTransportBridge* impl, void *socket, const char* socketName);
+void zmqBridgeMamaTransportImpl_checkConsumers(zmqTransportBridge* impl);
+void zmqBridgeMamaTransportImpl_addConsumer(zmqTransportBridge* impl, const char* endpoint, int fd);
+void zmqBridgeMamaTransportImpl_removeConsumer(zmqTransportBridge* impl, const char* endpoint);
+void zmqBridgeMamaTransportImpl_checkConsumer(zmqTransportBridge* impl, const char* endpoint, uint64_t queued);
+mama_status zmqBridgeMamaTransportImpl_disconnectConsumer(zmqTransportBridge* impl, const char* endpoint);
+
 
 #if defined(__cplusplus)
 }
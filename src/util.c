@@ -154,3 +154,63 @@ uint64_t getMillis(void)
     gettimeofday(&tv, NULL);
     return ((tv.tv_sec * (uint64_t) 1000) + (tv.tv_usec / 1000));
 }
+
+
+uint64_t getMicros(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return ((tv.tv_sec * (uint64_t) 1000000) + tv.tv_usec);
+}
+
+
+// FNV-1a
+uint32_t zmqBridge_hashString(const char* str)
+{
+   uint32_t hash = 2166136261u;
+   for (const char* p = str; *p != '\0'; ++p) {
+      hash = (hash ^ (uint8_t) *p) * 16777619u;
+   }
+   return hash;
+}
+
+
+void zmqBridge_getNamespace(const char* subject, int depth, char* ns, size_t size)
+{
+   size_t i = 0;
+   for (; (i < size -1) && (subject[i] != '\0'); ++i) {
+      if ((subject[i] == '.') && (--depth <= 0)) {
+         break;
+      }
+      ns[i] = subject[i];
+   }
+   ns[i] = '\0';
+}
+
+
+// bits are set/tested w/double hashing, from the one hash of the key
+#define BLOOM_HASHES 4
+
+void zmqBridge_bloomAdd(uint8_t* bloom, size_t size, const char* key)
+{
+   uint32_t h1 = zmqBridge_hashString(key);
+   uint32_t h2 = ((h1 >> 17) | (h1 << 15)) | 1;
+   for (int i = 0; i < BLOOM_HASHES; ++i) {
+      uint32_t bit = (h1 + i * h2) % (size * 8);
+      bloom[bit / 8] |= 1 << (bit % 8);
+   }
+}
+
+
+int zmqBridge_bloomTest(const uint8_t* bloom, size_t size, const char* key)
+{
+   uint32_t h1 = zmqBridge_hashString(key);
+   uint32_t h2 = ((h1 >> 17) | (h1 << 15)) | 1;
+   for (int i = 0; i < BLOOM_HASHES; ++i) {
+      uint32_t bit = (h1 + i * h2) % (size * 8);
+      if ((bloom[bit / 8] & (1 << (bit % 8))) == 0) {
+         return 0;
+      }
+   }
+   return 1;
+}
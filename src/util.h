@@ -38,5 +38,14 @@ int get_zmqEventMask(int logLevel);
 MamaLogLevel getNamingLogLevel(const char mType);
 
 uint64_t getMillis(void);
+uint64_t getMicros(void);
+
+uint32_t zmqBridge_hashString(const char* str);
+
+// copies the first depth (dot-separated) components of subject to ns
+void zmqBridge_getNamespace(const char* subject, int depth, char* ns, size_t size);
+// Bloom filter of size bytes
+void zmqBridge_bloomAdd(uint8_t* bloom, size_t size, const char* key);
+int zmqBridge_bloomTest(const uint8_t* bloom, size_t size, const char* key);
 
 #endif
\ No newline at end of file
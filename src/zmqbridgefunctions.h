@@ -294,6 +294,14 @@ extern mama_status
 zmqBridgeMamaTransport_getNativeTransportNamingCtx(transportBridge transport,
                                                    void**          result);
 
+typedef void (*zmqBridgeInterestCallback)(const char* topic, int isInterested, void* closure);
+
+MAMAExpDLL
+extern mama_status
+zmqBridgeMamaTransport_setInterestCallback(transportBridge           transport,
+                                           zmqBridgeInterestCallback callback,
+                                           void*                     closure);
+
 MAMAExpDLL
 extern mama_status zmqBridgeMamaSubscription_create
 (subscriptionBridge* subscriber,
@@ -414,6 +422,24 @@ MAMAExpDLL
 extern mama_status
 zmqBridgeMamaPublisher_send(publisherBridge publisher, mamaMsg msg);
 
+MAMAExpDLL
+extern mama_status
+zmqBridgeMamaPublisher_hasInterest(publisherBridge publisher, int* result);
+
+MAMAExpDLL
+extern mama_status
+zmqBridgeMamaPublisher_sendSubjects(publisherBridge publisher,
+                                    mamaMsg         msg,
+                                    const char**    subjects,
+                                    size_t          count);
+
+MAMAExpDLL
+extern mama_status
+zmqBridgeMamaPublisher_sendBatch(publisherBridge* publishers,
+                                 mamaMsg*         msgs,
+                                 mama_status*     statuses,
+                                 size_t           count);
+
 MAMAExpDLL
 extern mama_status
 zmqBridgeMamaPublisher_sendReplyToInbox(publisherBridge publisher,
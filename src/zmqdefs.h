@@ -44,6 +44,20 @@
 
 #define     PEER_TABLE_SIZE                  1024
 
+#define     DELTA_TABLE_SIZE                 1024
+
+#define     ALIAS_TABLE_SIZE                 1024
+
+#define     INTEREST_TABLE_SIZE              1024
+
+#define     CONSUMER_TABLE_SIZE              1024
+
+#define     RADIO_TABLE_SIZE                 1024
+
+#define     PARTITION_TABLE_SIZE             1024
+
+#define     TOPIC_TABLE_SIZE                 1024
+
 
 // zmq has two ways to manage subscriptions
 // w/XSUB subscriptions messages can be made visible to the application
@@ -61,8 +75,25 @@
 // TODO: is 256 enough? what happens if exceeded?
 #define     ZMQ_MAX_INCOMING_URIS            256         // incoming connections from other processes
 #define     ZMQ_MAX_OUTGOING_URIS            256         // outgoing connections to other processes
+#define     ZMQ_MAX_PUBLISH_ADDRESSES        8           // interfaces the data pub socket binds to (naming)
+#define     ZMQ_MAX_LOCAL_NETS               32          // local (ipv4) subnets, for choosing between peer endpoints
+#define     ZMQ_MAX_PARTITIONS               8           // data pub sockets that topics are hashed across (naming)
+#define     ZMQ_TOPIC_BLOOM_SIZE             128         // bytes in Bloom filter of topic namespaces (naming)
 //#define     ZMQ_MAX_ENDPOINT_LENGTH          sizeof("tcp://255.255.255.255:65536")
 #define     ZMQ_MAX_ENDPOINT_LENGTH          256
+#define     ZMQ_MAX_SEND_RINGS               256         // publishing threads w/their own send ring
+#define     ZMQ_MAX_SHM_RINGS                16          // shm rings read (or written) by a transport
+#define     ZMQ_SHM_READ_BATCH               256         // max msgs read from a single shm ring before checking sockets
+#define     ZMQ_RADIO_READ_BATCH             256         // max msgs read from the dish socket per poll
+#define     ZMQ_SHM_PREFIX                   "shm://"
+#define     ZMQ_SHM_NAMING_PREFIX            "oz."       // naming.shm rings are named <prefix><pid>.<uuid>
+#define     ZMQ_UDP_PREFIX                   "udp://"
+#define     ZMQ_INTEREST_POLL_MILLIS         100         // max interval between checks for subscription msgs on data pub socket
+#define     ZMQ_PEER_CACHE_POLL_MILLIS       1000        // max interval between checks for cached peers to drop/save
+#define     ZMQ_NAMING_HEARTBEAT_MILLIS      500         // nsd heartbeat interval, if its welcome msg doesn't say
+#define     ZMQ_NAMING_FAILOVER_HEARTBEATS   3           // missed nsd heartbeats before switching to the next nsd
+#define     ZMQ_MAX_MSG_SIZE                 64          // default max size (MB) of a payload rebuilt from a delta (or compressed) frame
+#define     ZMQ_DELTA_IDLE_MILLIS            60000       // incoming delta streams not used for this long (or up to twice as long) are dropped
 ///////////////////////////////////////////////////////////////////////
 
 /*=========================================================================
@@ -81,14 +112,34 @@
 #include <wombat/mempool.h>
 #include <mama/integration/types.h>
 
-// required for definition of ZMQ_CLIENT, ZMQ_SERVER
-#define ZMQ_BUILD_DRAFT_API
+// ZMQ_CLIENT, ZMQ_SERVER, ZMQ_RADIO & ZMQ_DISH are only defined w/ZMQ_BUILD_DRAFT_API (see the ZMQ_DRAFT_API
+// option in CMakeLists.txt) -- code that uses them must check that they are defined
 #include <zmq.h>
 
 // zmq bridge includes
 #include "queue.h"
 #include "util.h"
 #include "uqueue.h"
+#include "codec.h"
+#include "delta.h"
+#include "bufpool.h"
+#include "ratelimit.h"
+#include "shmring.h"
+
+// the data pub socket is monitored w/v2 events if available, which report per-peer queue sizes
+#ifdef ZMQ_EVENT_PIPES_STATS
+#define ZMQ_MONITOR_PEERS           2
+#define ZMQ_MONITOR_MAX_VALUES      4           // values in a v2 monitor event that we look at
+#else
+#define ZMQ_MONITOR_PEERS           1
+#endif
+
+// max length of a group on radio/dish sockets (topics are truncated to this)
+#ifdef ZMQ_GROUP_MAX_LENGTH
+#define ZMQ_RADIO_GROUP_SIZE        ZMQ_GROUP_MAX_LENGTH
+#else
+#define ZMQ_RADIO_GROUP_SIZE        15
+#endif
 
 #if defined(__cplusplus)
 extern "C" {
@@ -107,6 +158,39 @@ typedef enum zmqMsgType_ {
    ZMQ_MSG_INBOX_RESPONSE,
 } zmqMsgType;
 
+// The msg type is sent as a single byte in the bridge header -- the low bits hold the zmqMsgType, and the
+// high bits are flags that describe how the remainder of the msg is encoded
+#define ZMQ_MSG_TYPE_MASK           0x0f
+#define ZMQ_MSG_FLAG_COMPRESSED     0x80        // payload is preceded by a codec header (see codec.h)
+#define ZMQ_MSG_FLAG_DELTA          0x40        // payload is delta-encoded (see delta.h)
+#define ZMQ_MSG_FLAG_ALIAS          0x20        // header includes alias for the subject (see below)
+
+// Topic aliases replace the subject in the header of msgs sent by publishers, and have the form
+// <prefix><tag><id>, where tag identifies the sending transport and id identifies the subject, both in hex.
+// Aliases must be fixed-length, since zmq filters by prefix.
+// Each alias is defined by a msg sent on the full subject w/ZMQ_MSG_FLAG_ALIAS set, which is re-sent
+// periodically (every n msgs, and every so often) so that late-joining subscribers can pick it up.  W/interest
+// tracking, it is also re-sent as soon as a peer subscribes to the subject, or to the alias itself (which is
+// how a subscriber asks for the definition of an alias it doesn't know).
+#define ZMQ_ALIAS_PREFIX            '\x01'
+#define ZMQ_ALIAS_TAG_SIZE          8
+#define ZMQ_ALIAS_ID_SIZE           6
+#define ZMQ_ALIAS_SIZE              (1 + ZMQ_ALIAS_TAG_SIZE + ZMQ_ALIAS_ID_SIZE)
+#define ZMQ_ALIAS_MAX_ID            0xffffff
+
+// What to do w/msgs sent by a publisher that is over its rate limit
+typedef enum zmqRatePolicy_ {
+   ZMQ_RATE_POLICY_QUEUE = 0,       // queue the msg, to be sent when the rate allows
+   ZMQ_RATE_POLICY_CONFLATE,        // as above, but only the latest queued msg for each subject is kept
+   ZMQ_RATE_POLICY_REJECT           // fail the send w/MAMA_STATUS_QUEUE_FULL
+} zmqRatePolicy;
+
+// What to do w/a peer that has more than slow_consumer_max_msgs queued on the data pub socket
+typedef enum zmqSlowConsumerPolicy_ {
+   ZMQ_SLOW_CONSUMER_LOG = 0,       // just report it
+   ZMQ_SLOW_CONSUMER_DISCONNECT     // close the peer's connection (discarding everything queued to it)
+} zmqSlowConsumerPolicy;
+
 typedef enum zmqTransportType_ {
    ZMQ_TPORT_TYPE_UNKNOWN = 0,
    ZMQ_TPORT_TYPE_TCP,
@@ -131,6 +215,12 @@ typedef struct zmqSocket_ {
    int         mMonitor;       // if non-zero, socket is to be monitored
 } zmqSocket;
 
+// ipv4 subnet (network byte order)
+typedef struct zmqLocalNet_ {
+   uint32_t    mAddr;
+   uint32_t    mMask;
+} zmqLocalNet;
+
 
 /*=========================================================================
   =                Typedefs, structs, enums and globals                   =
@@ -142,11 +232,13 @@ typedef struct zmqTransportBridge_ {
    const char*             mName;               // select from mama.properties: mama.<middleware>.transport.<name>.<property>
    wsem_t                  mIsReady;            // prevents shutdown from proceeding until startup has completed
    uint32_t                mNamingConnected;    // signals that we've received our own discovery msg
+   wsem_t                  mNamingConnectedSem; // posted (by dispatch thread) whenever mNamingConnected is set
+   int                     mNamingSnapshot;     // 1 if all nsd's send snapshots of known peers, -1 if any doesn't (0 = not known yet)
    int                     mIsValid;            // required by Mama API
    mamaTransport           mTransport;          // parent Mama transport
    void*                   mZmqContext;
    int                     mIsNaming;           // whether transport is a "naming" transport
-   const char*             mPublishAddress;     // publish_address from mama.properties (e.g., "eth0")
+   const char*             mPublishAddress[ZMQ_MAX_PUBLISH_ADDRESSES];     // publish_address[_n] from mama.properties (e.g., "eth0")
    const char*             mUuid;               // unique id of this transport object
 
    // inproc socket for inter-thread commands
@@ -156,14 +248,50 @@ typedef struct zmqTransportBridge_ {
    // naming transports only
    zmqSocket               mZmqNamingPub;             // outgoing connections to proxy
    zmqSocket               mZmqNamingSub;             // incoming connections from proxy
-   const char*             mPubEndpoint;              // endpoint address for naming
+   const char*             mPubEndpoint[ZMQ_MAX_PUBLISH_ADDRESSES];   // endpoint addresses for naming (one per publish address)
+   zmqLocalNet             mLocalNets[ZMQ_MAX_LOCAL_NETS];            // subnets of local interfaces
+   int                     mLocalNetCount;
    const char*             mNamingAddress[ZMQ_MAX_NAMING_URIS];
    int                     mNamingReconnect;          // enable auto-reconnect for naming sockets?
    int                     mNamingReconnectInterval;
    int                     mNamingWaitForConnect;     // wait until connected to proxy at startup/abort if failed?
    int                     mNamingConnectRetries;     // max number of proxy connect attempts
    int                     mNamingConnectInterval;    // interval between proxy connect attempts (in micros, as per usleep)
+   wLock                   mPublishLock;              // protects the following
+   void*                   mPublishTimer;             // timerElement -- non-NULL while endpoint msg is to be re-sent
+   int                     mPublishRetries;           // remaining proxy connect attempts
+   int                     mPublishStopping;
    uint32_t                mBeaconInterval;           // interval between beacons (in millis, as per zmq_poll), or -1 to disable beaconing
+   int                     mNamingFailover;           // talk to one nsd at a time, switching to the next if it stops sending heartbeats?
+   int                     mNamingActive;             // index (in mNamingAddress) of nsd we're talking to (if mNamingFailover)
+   uint64_t                mNamingLastHeard;          // when we last got a msg from that nsd (dispatch thread only)
+   int                     mNamingHeartbeats;         // 1 if that nsd sends heartbeats, -1 if it doesn't (0 = not known yet)
+   uint32_t                mNamingHeartbeatInterval;  // interval between heartbeats from that nsd (millis)
+   const char*             mNamingProxyEndpoint;      // endpoint that naming pub socket is connected to (if mNamingFailover)
+   int                     mNamingLoopback;           // connect to own data pub socket over inproc (rather than tcp)?
+   const char*             mLoopbackEndpoint;         // inproc endpoint of data pub socket (if mNamingLoopback)
+   int                     mNamingIpc;                // also bind data pub socket to ipc endpoint, for peers on same host?
+   const char*             mIpcEndpoint;              // ipc endpoint of data pub socket (if mNamingIpc)
+   int                     mNamingShm;                // also publish to shm ring, and read from rings of peers on same host?
+   const char*             mShmEndpoint;              // shm ring written by this transport (if mNamingShm)
+   int                     mPartitions;               // # of data pub sockets that topics are hashed across
+   zmqSocket               mZmqPartitionPub[ZMQ_MAX_PARTITIONS -1];       // partitions 1..n-1 (partition 0 is mZmqDataPub)
+   const char*             mPartitionEndpoint[ZMQ_MAX_PARTITIONS -1];     // tcp endpoints of partitions 1..n-1
+   wtable_t                mPartitionPeers;           // peers w/partitioned data pub sockets, by uuid (dispatch thread only)
+   wtable_t                mSubTopics;                // # of subscriptions to each topic (dispatch thread only)
+   int                     mTopicFilter;              // # of leading subject components advertised as namespaces (0 = connect to all peers)
+   wtable_t                mPubNamespaces;            // # of publishers on each namespace
+   wLock                   mPubNamespacesLock;        // protects mPubNamespaces, mTopicBloom & mSubBloom
+   uint8_t                 mTopicBloom[ZMQ_TOPIC_BLOOM_SIZE];           // Bloom filter of mPubNamespaces
+   uint8_t                 mSubBloom[ZMQ_TOPIC_BLOOM_SIZE];             // Bloom filter of namespaces of mSubTopics
+   int                     mSubWildcards;             // did we have wildcard subscriptions when last advertised? (dispatch thread only)
+   wtable_t                mIdlePeers;                // peers not connected to (no matching topics), by uuid (dispatch thread only)
+   int                     mNamingCompact;            // send naming msgs in the compact encoding (see naming.h)?
+   const char*             mPeerCache;                // file that known peers are saved to, and connected to at startup (see peercache.h)
+   int                     mPeerCacheMaxAge;          // ignore cache file older than this (secs, 0 = any age)
+   uint64_t                mPeerCacheTimeout;         // disconnect from cached peers not heard from over naming in this long (millis)
+   uint64_t                mPeerCacheInterval;        // also save cache at this interval (millis, 0 = only at shutdown)
+   wtable_t                mCachedPeers;              // peers from cache not yet heard from over naming, by uuid (dispatch thread only)
 
    // "data" sockets for normal messaging
    zmqSocket               mZmqDataPub;
@@ -173,6 +301,95 @@ typedef struct zmqTransportBridge_ {
    int                     mDataReconnect;
    int                     mDataReconnectInterval;
 
+   // pool of send buffers
+   zmqBufferPool*          mSendPool;
+   int                     mSendPoolSize;         // max free buffers kept per size class
+
+   // sender thread (see sender.h)
+   int                     mSendThread;           // queue msgs to sender thread, rather than sending directly?
+   uint32_t                mSendRingSize;         // msgs per send ring (rounded up to power of 2)
+   wthread_t               mSenderThread;
+   uint32_t                mIsSending;
+   wsem_t                  mSenderSem;            // posted to wake sender thread
+   uint32_t                mSenderSleeping;       // sender thread is waiting on mSenderSem?
+   wthread_key_t           mSendRingKey;          // ring for current thread
+   struct zmqSendRing_*    mSendRings[ZMQ_MAX_SEND_RINGS];
+   uint32_t                mSendRingCount;
+   wLock                   mSendRingsLock;
+   uint32_t                mSendRingUsers;        // publishers currently using their send ring
+   wsem_t                  mSendRingUsersSem;     // posted when the last user releases its ring after stopSender
+
+   // payload compression
+   const zmqCodec*         mCodec;                // NULL if compression is disabled
+   size_t                  mCompressThreshold;    // only compress payloads at least this big
+
+   // payload delta encoding
+   int                     mDelta;                // delta-encode msgs sent by publishers?
+   uint32_t                mDeltaKeyInterval;     // send full payload every n msgs
+   uint32_t                mDeltaStreamUid;       // used to generate unique stream id for each publisher
+   wtable_t                mDeltaStreams;         // per-subject state for incoming msgs (dispatch thread only)
+   size_t                  mMaxMsgSize;           // frames that would rebuild a bigger payload than this are dropped
+   void*                   mDeltaBuffer;          // holds decompressed delta frames (dispatch thread only)
+   size_t                  mDeltaBufferSize;
+
+   // topic aliasing
+   int                     mTopicAlias;           // send publisher msgs on aliased topics?
+   uint32_t                mAliasRefresh;         // re-send alias definition every n msgs
+   uint32_t                mAliasRefreshInterval; // and every n millis (0 = never)
+   char                    mAliasTag[ZMQ_ALIAS_TAG_SIZE +1];   // identifies aliases defined by this transport
+   wtable_t                mAliases;              // outgoing aliases, by subject
+   wLock                   mAliasesLock;
+   uint32_t                mAliasUid;             // id of last alias defined
+   wtable_t                mAliasTables;          // incoming aliases, by tag (dispatch thread only)
+
+   // rate limiting (see sender.h)
+   double                  mRateLimit;            // max msgs/sec for transport (0 = unlimited)
+   double                  mRateBurst;
+   double                  mPublisherRateLimit;   // max msgs/sec for each publisher (0 = unlimited)
+   double                  mPublisherRateBurst;
+   zmqRatePolicy           mRatePolicy;
+   size_t                  mRateQueueMax;         // max msgs queued per publisher
+   zmqTokenBucket          mRateBucket;
+   struct zmqRateQueue_*   mPendingQueues;        // publishers w/queued msgs
+   wLock                   mRateLock;             // protects all of the above, and the rate queues
+   void*                   mRateTimer;            // timerElement -- non-NULL while flush is scheduled
+   int                     mRateStopping;
+   wsem_t                  mRateTimerSem;         // posted by rateTimerCallback once mRateStopping is set
+
+   // subscriber interest (data pub socket is XPUB, and reports subscriptions from peers)
+   int                     mInterest;             // skip sending msgs that no peer is subscribed to?
+   wtable_t                mInterestTable;        // prefixes subscribed to by peers
+   uint32_t                mInterestAll;          // a peer is subscribed to the empty prefix (i.e., everything)
+   wLock                   mInterestLock;
+   uint32_t                mInterestGen;          // incremented on every change in interest, so publishers can cache it
+   void                    (*mInterestCallback)(const char* topic, int isInterested, void* closure);
+   void*                   mInterestClosure;
+
+   // shared memory rings ("shm://name" endpoints -- see shmring.h)
+   size_t                  mShmSize;              // size of rings written by this transport
+   int                     mShmMode;              // permissions of rings written by this transport
+   long                    mShmPollInterval;      // max millis between checks for msgs in rings read by this transport
+   zmqShmRing*             mShmWriters[ZMQ_MAX_SHM_RINGS];   // written w/data pub socket's lock held
+   int                     mShmWriterCount;
+   zmqShmRing*             mShmReaders[ZMQ_MAX_SHM_RINGS];   // read by dispatch thread
+   int                     mShmReaderCount;
+
+   // radio/dish sockets ("udp://" endpoints), as a lossy alternative to the data pub/sub sockets
+   zmqSocket               mZmqRadio;             // sent to w/data pub socket's lock held
+   zmqSocket               mZmqDish;              // dispatch thread only
+   uint32_t                mRadioTag;             // identifies msgs sent by this transport
+   wtable_t                mRadioSendSeqs;        // seq of last msg sent, by group
+   wtable_t                mRadioRecvSeqs;        // seq of next msg expected, by sender tag & group
+   wtable_t                mRadioGroups;          // # of subscriptions to each group joined on dish socket
+
+   // slow consumers (peers connected to the data pub socket, tracked by the monitor thread)
+   uint64_t                mSlowConsumerMax;      // max msgs queued to a single peer (0 = don't check)
+   long                    mSlowConsumerInterval; // millis between checks
+   zmqSlowConsumerPolicy   mSlowConsumerPolicy;
+   wtable_t                mConsumers;            // zmqConsumer, by remote endpoint
+   wLock                   mConsumersLock;        // protects mConsumers, and mCheckConsumers
+   int                     mCheckConsumers;       // non-zero while data pub socket can be checked
+
    // main dispatch thread
    wthread_t               mOmzmqDispatchThread;
    uint32_t                mIsDispatching;
@@ -209,10 +426,91 @@ typedef struct zmqTransportBridge_ {
    long int                mSubMessages;           // subscription (as opposed to inbox) messages
    long int                mInboxMessages;         // inbox (as opposed to subscription) messages
    long int                mPolls;                 // msgs read after calling zmq_poll
+   long int                mNamingFailovers;       // switches to another nsd (w/naming.failover)
+   long int                mCompressedMessages;    // msgs sent w/compressed payload
+   long int                mDeltaMessages;         // msgs sent as delta (vs. key) frames
+   long int                mDeltaDropped;          // incoming delta frames w/o reference payload
+   long int                mAliasDropped;          // incoming msgs w/unknown alias
+   long int                mSendErrors;            // msgs that failed to send from sender thread
+   long int                mSendRingFull;          // sends that found send ring full (and were sent directly)
+   long int                mInterestSkipped;       // msgs not sent because no peer is subscribed
+   long int                mRateQueued;            // msgs queued because over rate limit
+   long int                mRateConflated;         // queued msgs replaced by a later msg on the same subject
+   long int                mRateRejected;          // msgs rejected because over rate limit (or queue full)
+   long int                mSlowConsumers;         // peers found over slow_consumer_max_msgs
+   long int                mSlowConsumersEvicted;  // slow consumers disconnected
+   long int                mShmMessages;           // msgs read from shm rings
+   long int                mShmTooBig;             // msgs too big to write to shm ring
+   long int                mShmLost;               // msgs lost by closed shm ring readers
+   long int                mRadioMessages;         // msgs received on dish socket
+   long int                mRadioLost;             // gaps in seq of msgs received on dish socket
 
 } zmqTransportBridge;
 
 
+// outgoing topic alias (one per subject per transport, shared by publishers)
+typedef struct zmqTopicAlias_ {
+   char                    mAlias[ZMQ_ALIAS_SIZE +1];
+   uint32_t                mSendCount;             // msgs sent -- used to decide when to re-send definition
+   uint32_t                mDefine;                // set to re-send definition w/the next msg
+} zmqTopicAlias;
+
+
+// incoming topic aliases for a single tag (i.e., sending transport), indexed by alias id
+typedef struct zmqAliasEntry_ {
+   char*                   mSubject;
+   int                     mIsSubscribed;          // are we subscribed to the alias?
+   int                     mIsRequested;           // have we asked for the definition of the alias?
+} zmqAliasEntry;
+
+typedef struct zmqAliasTable_ {
+   zmqAliasEntry*          mEntries;
+   size_t                  mSize;
+} zmqAliasTable;
+
+
+// msgs sent by a publisher while over its rate limit
+typedef struct zmqPendingMsg_ {
+   zmq_msg_t               mZmsg;
+   int                     mCanConflate;           // may be replaced by a later msg on the same subject?
+   struct zmqPendingMsg_*  mNext;
+} zmqPendingMsg;
+
+typedef struct zmqRateQueue_ {
+   zmqTokenBucket          mBucket;                // publisher's own rate limit
+   zmqPendingMsg*          mHead;
+   zmqPendingMsg*          mTail;
+   size_t                  mCount;
+   int                     mIsPending;             // on transport's list of queues w/pending msgs?
+   struct zmqRateQueue_*   mNextPending;
+} zmqRateQueue;
+
+
+#pragma pack(push, 1)
+// appended to msgs sent on the radio socket, so that receivers can detect lost msgs
+typedef struct zmqRadioTrailer_ {
+   uint32_t                mTag;                   // sending transport
+   uint32_t                mSeq;                   // per group
+} zmqRadioTrailer;
+#pragma pack(pop)
+
+
+// peer connected to the data pub socket
+typedef struct zmqConsumer_ {
+   int                     mFd;
+   uint64_t                mQueued;                // msgs queued to peer, as of last check
+   int                     mIsSlow;                // already reported as slow consumer?
+} zmqConsumer;
+
+
+// peer whose data pub socket is partitioned -- the data sub socket connects only to the partitions it needs
+typedef struct zmqPartitionPeer_ {
+   int                     mCount;                 // # of partitions
+   uint32_t                mConnected;             // bit mask of partitions connected to
+   char                    mEndpoints[ZMQ_MAX_PARTITIONS][ZMQ_MAX_ENDPOINT_LENGTH +1];
+} zmqPartitionPeer;
+
+
 // defines a subscriber (either "normal" or wildcard)
 typedef struct zmqSubscription_ {
    mamaMsgCallbacks        mMamaCallback;
@@ -246,6 +544,17 @@ typedef struct zmqQueueBridge {
 } zmqQueueBridge;
 
 #define ZMQ_NAMING_PREFIX            "_NAMING"
+// topic of msgs in the snapshot of known peers that nsd sends to each new subscriber -- nsd subscribes other
+// subscribers to ZMQ_NAMING_PREFIX *including* its trailing nul, so they don't see these
+#define ZMQ_NAMING_SNAPSHOT_TOPIC    ZMQ_NAMING_PREFIX ".snapshot"
+// msgs between the nsd's in a cluster
+#define ZMQ_NAMING_SYNC_TOPIC        ZMQ_NAMING_PREFIX ".sync"
+// periodic heartbeats from nsd (topic, followed by the nsd's endpoint) -- only subscribed to w/naming.failover
+#define ZMQ_NAMING_HEARTBEAT_TOPIC   ZMQ_NAMING_PREFIX ".hb"
+// mFlags in naming msgs
+#define ZMQ_NAMING_FLAG_SNAPSHOT     0x01        // (welcome) nsd sends a snapshot of known peers after the welcome msg
+#define ZMQ_NAMING_FLAG_HEARTBEAT    0x02        // (welcome) nsd sends heartbeats
+#define ZMQ_NAMING_FLAG_SUB_FILTER   0x04        // mSubBloom is valid (w/o it, peer may subscribe to anything)
 // Note: 0mq doesn't guarantee that messages will be aligned on any particular boundary, so use
 // pragma to ensure compiler knows that struct is unaligned
 #pragma pack(push, 1)
@@ -259,6 +568,15 @@ typedef struct zmqNamingMsg {
    long                    mPid;                                        // process ID
    char                    mUuid[UUID_STRING_SIZE +1];                  // uuid of transport
    char                    mEndPointAddr[ZMQ_MAX_ENDPOINT_LENGTH +1];   // dataSub socket connects to this endpoint
+   char                    mIpcEndPointAddr[ZMQ_MAX_ENDPOINT_LENGTH +1];   // ... or this one, from the same host (may be empty)
+   char                    mShmEndPointAddr[ZMQ_MAX_ENDPOINT_LENGTH +1];   // ... or this shm ring, from the same host (may be empty)
+   char                    mAltEndPointAddrs[ZMQ_MAX_PUBLISH_ADDRESSES -1][ZMQ_MAX_ENDPOINT_LENGTH +1];   // ... or these, on other interfaces (may be empty)
+   char                    mPartitionEndPointAddrs[ZMQ_MAX_PARTITIONS -1][ZMQ_MAX_ENDPOINT_LENGTH +1];  // partitions 1..n-1 of the data pub socket (may be empty)
+   unsigned char           mTopicFilter;                                // # of subject components in namespaces in mTopicBloom (0 = no filter)
+   uint8_t                 mTopicBloom[ZMQ_TOPIC_BLOOM_SIZE];           // Bloom filter of namespaces published by peer
+   unsigned char           mFlags;                                      // ZMQ_NAMING_FLAG_...
+   uint8_t                 mSubBloom[ZMQ_TOPIC_BLOOM_SIZE];             // Bloom filter of namespaces subscribed to by peer
+   uint32_t                mHeartbeatInterval;                          // (welcome) millis between nsd heartbeats (0 = not known)
 }  zmqNamingMsg;
 #pragma pack(pop)
 
@@ -302,16 +620,28 @@ typedef struct zmqInboxImpl {
 typedef struct zmqTransportMsg_ {
     zmqTransportBridge*     mTransport;
     char                    mEndpointIdentifier[ZMQ_REPLYHANDLE_INBOXNAME_SIZE+1];    // UUID that uniquely identifies a specific subscriber
+    const char*             mSubject;               // subject, if different from msg header (i.e., aliased), else NULL
     zmq_msg_t               mZmsg;
 } zmqTransportMsg;
 
 
+// serialized bridge header: [subject\0][msgType][replyHandle\0][alias\0 (alias definitions only)]
+#define ZMQ_MSG_HEADER_MAX_SIZE     ((MAX_SUBJECT_LENGTH +1) + 1 + (ZMQ_REPLYHANDLE_SIZE +1) + (ZMQ_ALIAS_SIZE +1))
+typedef struct zmqMsgHeader_ {
+   uint8_t             mData[ZMQ_MSG_HEADER_MAX_SIZE];
+   size_t              mSize;
+   size_t              mTypeOffset;                            // offset of msgType byte (flags are set per-msg)
+} zmqMsgHeader;
+
+
 // this is the internal msg structure implemented in msg.c
 typedef struct zmqBridgeMsgImpl {
    mamaMsg             mParent;
    uint8_t             mMsgType;                               // pub/sub, request or reply
    char                mReplyHandle[ZMQ_REPLYHANDLE_SIZE +1];  // for a request msg, unique identifier of the sending inbox
    char                mSendSubject[MAX_SUBJECT_LENGTH +1];    // topic on which the msg is sent
+   void*               mPayloadBuffer;                         // holds decompressed payload (re-used across msgs)
+   size_t              mPayloadBufferSize;
 } zmqBridgeMsgImpl;
 
 
@@ -0,0 +1,17 @@
+#!/bin/bash -x
+
+# request/reply over a partitioned transport (naming.partitions > 1) -- mamapublisherc replies to the inbox request
+# sent by mamainboxc, which fails (times out) if the reply is sent on a partition it isn't connected to
+# (nsd must be running, see nsd.sh)
+
+TPORT=${MAMA_TPORT_PARTITIONED:-ozp}
+
+`which mamapublisherc` -tport ${TPORT} -m ${MAMA_MW} &
+PUB_PID=$!
+sleep 2
+
+timeout 10 `which mamainboxc` -tport ${TPORT} -m ${MAMA_MW} $*
+RC=$?
+
+kill ${PUB_PID}
+exit ${RC}